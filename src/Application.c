@@ -38,6 +38,7 @@
 #include <X11/cursorfont.h>
 
 // Gnome library headers.
+#include <glib-unix.h>
 #include <gtk/gtk.h>
 
 // Spline library.
@@ -54,6 +55,7 @@
 #include "ClockHelper.h"
 #include "ColorCodes.h"
 #include "Fallen.h"
+#include "FallenSnapshot.h"
 #include "loadmeasure.h"
 #include "mainstub.h"
 #include "MainWindow.h"
@@ -62,14 +64,24 @@
 #include "Prefs.h"
 #include "safeMalloc.h"
 #include "Stars.h"
+#include "startupProfiler.h"
 #include "Storm.h"
 #include "StormWindow.h"
 #include "utils.h"
 #include "versionHelper.h"
 #include "Wind.h"
 #include "Windows.h"
+#include "x11AtomHelper.h"
+#include "x11EventHelper.h"
+#include "x11InputHelper.h"
+#include "x11RootHelper.h"
+#include "x11ScanHelper.h"
 #include "x11WindowHelper.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_APPLICATION
+#include "x11Stats.h"
+
 
 /** *********************************************************************
  ** Module globals and consts.
@@ -91,10 +103,15 @@ static int mX11ErrorCount = 0;
 int mX11LastErrorCode = 0;
 
 
+
 /** *********************************************************************
  ** Application start method. 
  **/
 int startApplication(int argc, char* argv[]) {
+    // Must precede every other Xlib call, GTK's included.
+    XInitThreads();
+    initStartupProfiler();
+
     // Log info, version checks.
     logAppVersion();
 
@@ -131,11 +148,19 @@ int startApplication(int argc, char* argv[]) {
 
     // Before starting GTK, ensure x11 backend is used.
     setenv("GDK_BACKEND", "x11", 1);
+    markStartupPhase("Version & session checks");
 
-    // Set app shutdown handlers.
-    signal(SIGINT, appShutdownHook);
-    signal(SIGTERM, appShutdownHook);
-    signal(SIGHUP, appShutdownHook);
+    // Set app shutdown handlers, run from the mainloop.
+    g_unix_signal_add(SIGINT, onAppShutdownSignal,
+        GINT_TO_POINTER(SIGINT));
+    g_unix_signal_add(SIGTERM, onAppShutdownSignal,
+        GINT_TO_POINTER(SIGTERM));
+    g_unix_signal_add(SIGHUP, onAppShutdownSignal,
+        GINT_TO_POINTER(SIGHUP));
+
+    // X11 traffic & startup profile dump on demand: kill -USR1 <pid>.
+    initX11Stats();
+    g_unix_signal_add(SIGUSR1, dumpStatsOnSignal, NULL);
 
     // Seed random generator.
     srand48((int) (fmod(wallcl() * 1.0e6, 1.0e8)));
@@ -144,7 +169,6 @@ int startApplication(int argc, char* argv[]) {
     memset(&mGlobal, 0, sizeof(mGlobal));
 
     mGlobal.windowsWereDraggedOrMapped = 0;
-    mGlobal.languageChangeRestart = false;
 
     mGlobal.StormWindow = None;
     mGlobal.MaxStormItemHeight = 0;
@@ -164,6 +188,7 @@ int startApplication(int argc, char* argv[]) {
     mGlobal.FallenFirst = NULL;
 
     mGlobal.cpufactor = 1.0;
+    mGlobal.frameTimeScale = 1.0;
     mGlobal.WindowScale = 1.0;
 
     mGlobal.visibleWorkspaceCount = 1;
@@ -179,6 +204,10 @@ int startApplication(int argc, char* argv[]) {
             "X11 Does not seem to be available - FATAL.");
         return 1;
     }
+    markStartupPhase("XOpenDisplay");
+
+    // Intern all our atoms up front.
+    initX11AtomTable(mGlobal.display);
 
     mGlobal.xdo = xdo_new_with_opened_display(
         mGlobal.display, NULL, 0);
@@ -189,9 +218,11 @@ int startApplication(int argc, char* argv[]) {
         XCloseDisplay(mGlobal.display);
         return 1;
     }
+    markStartupPhase("Atoms & xdo init");
 
     // Init flags module.
     initPrefsModule(argc, argv);
+    markStartupPhase("Prefs load");
 
     // Handle langauge localizations.
     // Language locale string bindings.
@@ -200,10 +231,12 @@ int startApplication(int argc, char* argv[]) {
     mybindtestdomain();
 
     initFallenSemaphores();
+    markStartupPhase("Language bindings");
 
     // Init it!
     gtk_init(&argc, &argv);
     writePrefstoLocalStorage();
+    markStartupPhase("gtk_init & prefs write");
 
     mGlobal.xdo->debug = 0;
     XSynchronize(mGlobal.display, 0);
@@ -213,61 +246,26 @@ int startApplication(int argc, char* argv[]) {
     setStormShapeColor(getRGBFromString(Flags.StormItemColor1));
 
     createStormWindow();
+    markStartupPhase("StormWindow sizing");
 
     mPrevStormWindowWidth = mGlobal.StormWindowWidth;
     mPrevStormWindowHeight = mGlobal.StormWindowHeight;
 
-    // Init all Global Flags.
-    OldFlags.shutdownRequested = Flags.shutdownRequested;
-    OldFlags.mHaveFlagsChanged = Flags.mHaveFlagsChanged;
-
-    OldFlags.Language = strdup(Flags.Language);
-
-    OldFlags.ShowStormItems = Flags.ShowStormItems;
-    OldFlags.StormItemColor1 = strdup(Flags.StormItemColor1);
-    OldFlags.StormItemColor2 = strdup(Flags.StormItemColor2);
-    OldFlags.ShapeSizeFactor = Flags.ShapeSizeFactor;
-    OldFlags.StormItemSpeedFactor = Flags.StormItemSpeedFactor;
-    OldFlags.StormItemCountMax = Flags.StormItemCountMax;
-    OldFlags.StormSaturationFactor = Flags.StormSaturationFactor;
-
-    OldFlags.ShowStars = Flags.ShowStars;
-    OldFlags.MaxStarCount = Flags.MaxStarCount;
-
-    OldFlags.ShowWind = Flags.ShowWind;
-    OldFlags.WhirlFactor = Flags.WhirlFactor;
-    OldFlags.WhirlTimer = Flags.WhirlTimer;
-    OldFlags.ShowBlowoff = Flags.ShowBlowoff;
-    OldFlags.BlowOffFactor = Flags.BlowOffFactor;
-
-    OldFlags.KeepFallenOnWindows = Flags.KeepFallenOnWindows;
-    OldFlags.MaxWindowFallenDepth = Flags.MaxWindowFallenDepth;
-    OldFlags.WindowFallenTopOffset = Flags.WindowFallenTopOffset;
-    OldFlags.KeepFallenOnDesktop = Flags.KeepFallenOnDesktop;
-    OldFlags.MaxDesktopFallenDepth = Flags.MaxDesktopFallenDepth;
-    OldFlags.DesktopFallenTopOffset = Flags.DesktopFallenTopOffset;
-
-    OldFlags.CpuLoad = Flags.CpuLoad;
-    OldFlags.Transparency = Flags.Transparency;
-    OldFlags.Scale = Flags.Scale;
-    OldFlags.AllWorkspaces = Flags.AllWorkspaces;
-    OldFlags.ComboStormShape = Flags.ComboStormShape;
-
-    // Init the X11Threads.
-    XInitThreads();
-
     // Request all interesting X11 events.
     const Window eventWindow = (mGlobal.hasDestopWindow) ?
         mGlobal.Rootwindow : mGlobal.StormWindow;
 
     XSelectInput(mGlobal.display, eventWindow,
         StructureNotifyMask | SubstructureNotifyMask |
-        FocusChangeMask);
+        FocusChangeMask | PropertyChangeMask);
     XFixesSelectCursorInput(mGlobal.display, eventWindow,
         XFixesDisplayCursorNotifyMask);
+    initX11RootCache();
+    initX11InputModule();
 
     clearStormWindow();
     createMainWindow();
+    markStartupPhase("Main window build");
 
     // Hide us if starting minimized.
     if (Flags.mHideMenu) {
@@ -278,6 +276,7 @@ int startApplication(int argc, char* argv[]) {
 
     Flags.shutdownRequested = false;
     updateWindowsList();
+    markStartupPhase("Window list scan");
 
     // Init app modules.
     addWindowsModuleToMainloop();
@@ -286,20 +285,24 @@ int startApplication(int argc, char* argv[]) {
     initBlowoffModule();
     initFallenModule();
     initStarsModule();
+    markStartupPhase("Wind, blowoff, fallen & stars init");
     initStormModule();
+    markStartupPhase("Storm module init");
 
     addLoadMonitorToMainloop();
 
-    addMethodToMainloop(PRIORITY_DEFAULT,
-        DO_HANDLE_X11_EVENT_TIME, handlePendingX11Events);
+    addX11EventSourceToMainloop(PRIORITY_DEFAULT,
+        handlePendingX11Events);
 
     addMethodToMainloop(PRIORITY_DEFAULT,
         DO_DISPLAY_RECONFIGURATION_EVENT_TIME,
         handleDisplayReconfigurationChange);
 
-    addMethodToMainloop(PRIORITY_HIGH,
-        DO_UI_SETTINGS_UPDATES_EVENT_TIME,
-        doAllUISettingsUpdates);
+    // Settings changes are pushed to their observers, see Prefs.h.
+    addPrefObserver(PREF_LANGUAGE, respondToLanguageSettingsChanges);
+    addPrefObserver(PREF_CPU_LOAD, respondToAdvancedSettingsChanges);
+    addPrefObserver(PREF_ALL_WORKSPACES,
+        respondToAdvancedSettingsChanges);
 
     HandleCpuFactor();
     respondToWorkspaceSettingsChange();
@@ -310,6 +313,7 @@ int startApplication(int argc, char* argv[]) {
 
     logWindow(mGlobal.StormWindow);
     fflush(stdout);
+    markStartupPhase("Mainloop setup");
 
     //***************************************************
     // Bring it all up !
@@ -318,7 +322,9 @@ int startApplication(int argc, char* argv[]) {
     printf("\n%splasmastorm: gtk_main() Starts.%s\n",
         COLOR_BLUE, COLOR_NORMAL);
 
-    gtk_main();
+    if (!Flags.shutdownRequested) {
+        gtk_main();
+    }
 
     printf("\n%splasmastorm: gtk_main() Finishes.%s\n",
         COLOR_BLUE, COLOR_NORMAL);
@@ -328,19 +334,26 @@ int startApplication(int argc, char* argv[]) {
         COLOR_GREEN, COLOR_NORMAL);
 
     // More terminates.
+    uninitFallenModule();
+    logFallenLockStats();
+    logLoadGovernorStats();
+    logX11AtomStats();
+    logX11EventStats();
+    logX11Stats();
+    uninitPrefsModule();
+    if (!isStartupProfileComplete()) {
+        logStartupProfile();
+    }
+    uninitX11RootCache();
+    saveFallenSnapshot();
+
     XClearWindow(mGlobal.display, mGlobal.StormWindow);
     XFlush(mGlobal.display);
 
+    closeX11ScanConnection();
     XCloseDisplay(mGlobal.display);
     uninitQPickerDialog();
 
-    // If Restarting due to display or language change.
-    if (mGlobal.languageChangeRestart) {
-        sleep(0);
-        setenv("plasmastorm_RESTART", "yes", 1);
-        execvp(argv[0], argv);
-    }
-
     return 0;
 }
 
@@ -397,75 +410,21 @@ void handleX11CairoDisplay() {
     mGlobal.StormWindowHeight = height;
 }
 
-/** *********************************************************************
- * here we are handling the buttons in ui
- * Ok, this is a long list, and could be implemented more efficient.
- * But, doAllUISettingsUpdates is called not too frequently, so....
- * Note: if changes != 0, the settings will be written to .plasmastormrc
- **/
-int doAllUISettingsUpdates() {
-    if (Flags.shutdownRequested) {
-        gtk_main_quit();
-    }
-
-    respondToLanguageSettingsChanges();
-
-    respondToStormsSettingsChanges();
-    updateStarsUserSettings();
-    respondToWindSettingsChanges();
-    respondToSurfacesSettingsChanges();
-    respondToBlowoffSettingsChanges();
-
-    respondToAdvancedSettingsChanges();
-
-    return TRUE;
-}
-
 /** *********************************************************************
  ** TODO: Advanced Page for UI should be in its own module.
  **/
-void respondToAdvancedSettingsChanges() {
-    //UIDO(CpuLoad, 
-    if (Flags.CpuLoad !=
-            OldFlags.CpuLoad) {
-        OldFlags.CpuLoad =
-            Flags.CpuLoad;
-        HandleCpuFactor();
-        Flags.mHaveFlagsChanged++;
-    }
-
-    //UIDO(Transparency, );
-    if (Flags.Transparency !=
-            OldFlags.Transparency) {
-        OldFlags.Transparency =
-            Flags.Transparency;
-        Flags.mHaveFlagsChanged++;
-    }
-
-    //UIDO(Scale, );
-    if (Flags.Scale !=
-            OldFlags.Scale) {
-        OldFlags.Scale =
-            Flags.Scale;
-        Flags.mHaveFlagsChanged++;
-    }
+void respondToAdvancedSettingsChanges(PrefKey key) {
+    switch (key) {
+        case PREF_CPU_LOAD:
+            HandleCpuFactor();
+            break;
 
-    //UIDO(AllWorkspaces, 
-    if (Flags.AllWorkspaces !=
-            OldFlags.AllWorkspaces) {
-        OldFlags.AllWorkspaces =
-            Flags.AllWorkspaces;
-        respondToWorkspaceSettingsChange();
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_ALL_WORKSPACES:
+            respondToWorkspaceSettingsChange();
+            break;
 
-    // TODO: Advanced Settings changes might trigger restart
-    // on display change so (?) we force the prefs out. This should be
-    // closer to the actual codepath not catch all here :-(
-    if (Flags.mHaveFlagsChanged > 0) {
-        writePrefstoLocalStorage();
-        set_buttons();
-        Flags.mHaveFlagsChanged = 0;
+        default:
+            break;
     }
 }
 
@@ -496,15 +455,15 @@ int handlePendingX11Events() {
         return FALSE;
     }
 
-    XFlush(mGlobal.display);
-    while (XPending(mGlobal.display)) {
+    // One bounded batch, the event source calls us again
+    // while more are queued.
+    XEvent event;
+    while (getNextX11Event(&event)) {
         // printf("%sApplication: handlePendingX11Events() Starts.%s\n",
         //     COLOR_YELLOW, COLOR_NORMAL);
 
-        XEvent event;
-        XNextEvent(mGlobal.display, &event);
-
-        // Check for Active window change through loop.
+        // Check for Active window change through loop,
+        // from the root cache (no round trip).
         const Window activeX11Window = getActiveX11Window();
         if (getActiveAppWindow() != activeX11Window) {
             // printf("%sApplication: handlePendingX11Events() Start : "
@@ -557,6 +516,10 @@ int handlePendingX11Events() {
                 //      "onWindowMapped.%s\n\n", COLOR_BLUE, COLOR_NORMAL);
                 break;
 
+            case PropertyNotify:
+                onWindowPropertyChanged(&event);
+                break;
+
             case FocusIn:
                 // printf("%sApplication: handlePendingX11Events() Start : "
                 //     "onWindowFocused.%s\n\n", COLOR_BLUE, COLOR_NORMAL);
@@ -591,6 +554,14 @@ int handlePendingX11Events() {
                 break;
 
             default:
+                // XInput2 raw pointer buttons.
+                if (isX11InputEvent(&event)) {
+                    if (handleX11InputEvent(&event)) {
+                        onPointerButtonReleased();
+                    }
+                    break;
+                }
+
                 // Check & perform XFixes action.
                 int xfixes_event_base;
                 int xfixes_error_base;
@@ -629,19 +600,45 @@ int handlePendingX11Events() {
 void RestartDisplay() {
     fflush(stdout);
 
+    // Rebuild, keeping fallen for windows that survive.
+    captureFallenSnapshot();
     initFallenListWithDesktop();
 
     clearStormWindow();
 }
 
 /** *********************************************************************
- ** This method logs signal event shutdowns as fyi.
+ ** This method logs signal event shutdowns as fyi, then shuts down.
  **/
-void appShutdownHook(int signalNumber) {
+int onAppShutdownSignal(gpointer data) {
     printf("%splasmastorm: Shutdown by Signal Handler : %i.%s\n",
-        COLOR_YELLOW, signalNumber, COLOR_NORMAL);
+        COLOR_YELLOW, GPOINTER_TO_INT(data), COLOR_NORMAL);
+
+    requestAppShutdown();
+    return G_SOURCE_CONTINUE;
+}
 
+/** *********************************************************************
+ ** This method asks the app to shut down. Before gtk_main() runs,
+ ** the flag alone keeps it from starting.
+ **/
+void requestAppShutdown() {
     Flags.shutdownRequested = true;
+    if (gtk_main_level() > 0) {
+        gtk_main_quit();
+    }
+}
+
+/** *********************************************************************
+ ** This method dumps the X11 traffic counts & startup profile,
+ ** from the main loop on SIGUSR1.
+ **/
+int dumpStatsOnSignal(__attribute__((unused)) gpointer data) {
+    logX11Stats();
+    logStartupProfile();
+    logLoadGovernorStats();
+    fflush(stdout);
+    return G_SOURCE_CONTINUE;
 }
 
 /** *********************************************************************
@@ -656,6 +653,9 @@ int handleX11ErrorEvent(Display* dpy, XErrorEvent* event) {
         return 0;
     }
 
+    // Our windows cache may have missed something.
+    requestWinInfoListResync();
+
     // Print the error message of the event.
     const int MAX_MESSAGE_BUFFER_LENGTH = 60;
     char msg[MAX_MESSAGE_BUFFER_LENGTH];
@@ -667,7 +667,7 @@ int handleX11ErrorEvent(Display* dpy, XErrorEvent* event) {
     if (mX11ErrorCount++ > mX11MaxErrorCount) {
         printf("\n%splasmastorm: Shutting down due to excessive "
             "X11 errors.%s\n", COLOR_RED, COLOR_NORMAL);
-        Flags.shutdownRequested = true;
+        requestAppShutdown();
     }
 
     return 0;
@@ -696,6 +696,7 @@ void drawCairoWindowInternal(cairo_t *cr) {
     if (Flags.shutdownRequested) {
         return;
     }
+    const uint64_t renderCostStart = startLoadCost(LOAD_COST_RENDER);
 
     // Do all module clears.
     XFlush(mGlobal.display);
@@ -725,6 +726,9 @@ void drawCairoWindowInternal(cairo_t *cr) {
 
     cairo_restore(cr);
     XFlush(mGlobal.display);
+
+    endLoadCost(LOAD_COST_RENDER, renderCostStart);
+    markStartupFirstFrame();
 }
 
 /** *********************************************************************
@@ -785,6 +789,7 @@ void HandleCpuFactor() {
         DO_STALL_CREATE_STORMITEM_EVENT_TIME,
         doStallCreateStormShapeEvent);
 
+    addStormItemsUpdateToMainloop();
     addWindowDrawMethodToMainloop();
 }
 
@@ -20,6 +20,8 @@
  */
 #pragma once
 
+#include "Prefs.h"
+
 /***********************************************************
  * Externally provided to this Module.
  */
@@ -61,7 +63,9 @@ void addWindowDrawMethodToMainloop();
 
 void RestartDisplay();
 
-void appShutdownHook(int);
+int onAppShutdownSignal(gpointer);
+void requestAppShutdown();
+int dumpStatsOnSignal(gpointer);
 
 void handleX11CairoDisplay();
 int handlePendingX11Events();
@@ -70,8 +74,7 @@ int handleX11ErrorEvent(Display*, XErrorEvent*);
 int drawCairoWindow(void*);
 void drawCairoWindowInternal(cairo_t*);
 
-int doAllUISettingsUpdates();
-void respondToAdvancedSettingsChanges();
+void respondToAdvancedSettingsChanges(PrefKey);
 
 void HandleCpuFactor();
 
@@ -49,26 +49,6 @@ void initBlowoffModule() {
         handleBlowoffEvent);
 }
 
-/** *********************************************************************
- ** This method updates the Blowoff module based on
- ** the users settings.
- **/
-void respondToBlowoffSettingsChanges() {
-    //UIDO(ShowBlowoff, );
-    if (Flags.ShowBlowoff != OldFlags.ShowBlowoff) {
-        OldFlags.ShowBlowoff = Flags.ShowBlowoff;
-        Flags.mHaveFlagsChanged++;
-    }
-
-    //UIDO(BlowOffFactor, );
-    if (Flags.BlowOffFactor != OldFlags.BlowOffFactor) {
-        OldFlags.BlowOffFactor = Flags.BlowOffFactor;
-        // printf("%s\nplasmastorm::Blowoff respondToBlowoffSettingsChanges()"
-        //     " : %d\n", "BlowOffFactor", Flags.BlowOffFactor);
-        Flags.mHaveFlagsChanged++;
-    }
-}
-
 /** *********************************************************************
  ** This method gets a random number for a blowoff event.
  **/
@@ -80,6 +60,23 @@ int getBlowoffEventCount() {
     return result;
 }
 
+/** *********************************************************************
+ ** This method returns the mean of getBlowoffEventCount(), for
+ ** callers that sample a whole batch of events at once.
+ **
+ ** floor(c * U) >= k with probability (1 - k / c), k = 1 .. c.
+ **/
+double getBlowoffEventMean() {
+    const double c = 0.04 * Flags.BlowOffFactor;
+
+    double result = 0;
+    for (int k = 1; k <= (int) c; k++) {
+        result += 1.0 - k / c;
+    }
+
+    return result;
+}
+
 /** *********************************************************************
  ** This method processes Blowoff events.
  **/
@@ -90,7 +87,7 @@ int handleBlowoffEvent() {
     if (!WorkspaceActive() || !Flags.ShowBlowoff) {
         return true;
     }
-    if (softLockFallenBaseSemaphore(3, &lockcounter)) {
+    if (softLockFallenBaseSemaphoreForRead(3, &lockcounter)) {
         return true;
     }
 
@@ -98,15 +95,19 @@ int handleBlowoffEvent() {
     while (fallen) {
         if (canFallenConsumeStormItem(fallen) &&
             Flags.ShowStormItems) {
-            if (fallen->winInfo.window == 0 || (!fallen->winInfo.hidden &&
+            if (fallen->winInfo.window == 0 ||
+                (!(fallen->winInfo.state & WINDOW_STATE_HIDDEN) &&
                 (isFallenOnVisibleWorkspace(fallen) ||
-                fallen->winInfo.sticky))) {
+                (fallen->winInfo.state & WINDOW_STATE_STICKY)))) {
                 updateFallenWithWind(fallen, fallen->w / 4, fallen->h / 4);
             }
         }
         fallen = fallen->next;
     }
 
+    // All erased pixels, cleared at once.
+    flushFallenDamage();
+
     unlockFallenSemaphore();
     return true;
 }
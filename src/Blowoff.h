@@ -22,8 +22,7 @@
 
 extern void initBlowoffModule();
 
-extern void respondToBlowoffSettingsChanges();
-
 extern int getBlowoffEventCount();
+extern double getBlowoffEventMean();
 
 extern int handleBlowoffEvent();
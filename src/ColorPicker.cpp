@@ -42,6 +42,15 @@ using namespace std;
 #include <QtWidgets/QWidget>
 
 
+/** *********************************************************************
+ **
+ ** Externally provided to this Module.
+ **
+ **/
+extern "C" void onQPickerColorChosen(const char* callerTag,
+    int red, int green, int blue);
+
+
 /** *********************************************************************
  **
  ** Main Color Picker class def.
@@ -68,13 +77,28 @@ class PlasmaColorDialog : public QColorDialog {
 
         void reject() {
             hide();
+            endPicking();
         }
         void accept() {
             setPlasmaColor(currentColor());
             hide();
+
+            // Push the choice to the settings registry.
+            char* callerName = mActiveCallerName;
+            endPicking();
+            if (callerName != nullptr) {
+                onQPickerColorChosen(callerName, mColor.red(),
+                    mColor.green(), mColor.blue());
+            }
         }
         void closeEvent(__attribute__((unused)) QCloseEvent *event) {
             hide();
+            endPicking();
+        }
+
+        void endPicking() {
+            mAlreadyShowingQPickerDialog = false;
+            mActiveCallerName = nullptr;
         }
 
         bool isAlreadyInitialized() {
@@ -118,12 +142,44 @@ class PlasmaColorDialog : public QColorDialog {
  **
  ** Main Globals.
  **
+ ** Qt is brought up on the first startQPickerDialog() call rather than
+ ** from static initializers, so launches that never open the picker
+ ** don't pay for QApplication setup (platform plugin, fonts, its own
+ ** X connection) before main() even runs.
+ **
  **/
 static int argc = 1;
-static std::string argv[] = { "plasmastormpicker" };
-static QApplication* mColorApp = new QApplication(argc, (char**) argv);
+static char mColorAppName[] = "plasmastormpicker";
+static char* argv[] = { mColorAppName, nullptr };
+
+static QApplication* mColorApp = nullptr;
+static PlasmaColorDialog* mColorDialog = nullptr;
+
+static bool mColorAppTerminated = false;
+
+
+/** *********************************************************************
+ **
+ ** Create QApplication & dialog on first use.
+ **
+ **/
+static bool ensureQPickerDialog() {
+    if (mColorDialog != nullptr) {
+        return true;
+    }
+    if (mColorAppTerminated) {
+        return false;
+    }
+
+    mColorApp = new QApplication(argc, argv);
+    mColorApp->setWindowIcon(
+        QIcon("/usr/local/share/pixmaps/plasmastormpicker.png"));
 
-static PlasmaColorDialog* mColorDialog = new PlasmaColorDialog();
+    mColorDialog = new PlasmaColorDialog();
+    mColorDialog->setWindowTitle("Select Color");
+    mColorDialog->setOption(QColorDialog::DontUseNativeDialog);
+    return true;
+}
 
 
 /** *********************************************************************
@@ -133,38 +189,44 @@ static PlasmaColorDialog* mColorDialog = new PlasmaColorDialog();
  **/
 extern "C"
 bool isQPickerActive() {
-    return mColorDialog->isQPickerActive();
+    return mColorDialog != nullptr &&
+        mColorDialog->isQPickerActive();
 };
 
 extern "C"
 char* getQPickerCallerName() {
-    return mColorDialog->getQPickerCallerName();
+    return mColorDialog != nullptr ?
+        mColorDialog->getQPickerCallerName() : nullptr;
 }
 
 extern "C"
 bool isQPickerVisible() {
-    return mColorDialog->isVisible();
+    return mColorDialog != nullptr &&
+        mColorDialog->isVisible();
 }
 
 extern "C"
 bool isQPickerTerminated() {
-    return mColorDialog->isAlreadyTerminated();
+    return mColorAppTerminated;
 };
 
 
 extern "C"
 int getQPickerRed() {
-    return mColorDialog->getPlasmaColor().red();
+    return mColorDialog != nullptr ?
+        mColorDialog->getPlasmaColor().red() : 0;
 };
 
 extern "C"
 int getQPickerGreen() {
-    return mColorDialog->getPlasmaColor().green();
+    return mColorDialog != nullptr ?
+        mColorDialog->getPlasmaColor().green() : 0;
 };
 
 extern "C"
 int getQPickerBlue() {
-    return mColorDialog->getPlasmaColor().blue();
+    return mColorDialog != nullptr ?
+        mColorDialog->getPlasmaColor().blue() : 0;
 };
 
 
@@ -175,16 +237,17 @@ int getQPickerBlue() {
  **/
 extern "C"
 bool startQPickerDialog(char* inElementTag, char* inColorString) {
+    // Bring up Qt on first use.
+    if (!ensureQPickerDialog()) {
+        return false;
+    }
+
     // Early out if we're alreaady active.
     if (mColorDialog->isQPickerActive()) {
         return false;
     }
 
-    // Create initial dialog globals.
-    mColorDialog->setWindowTitle("Select Color");
-    mColorApp->setWindowIcon(
-        QIcon("/usr/local/share/pixmaps/plasmastormpicker.png"));
-    mColorDialog->setOption(QColorDialog::DontUseNativeDialog);
+    // Mark dialog active.
     mColorDialog->setQPickerActive(true);
     mColorDialog->setAlreadyInitialized(true);
 
@@ -208,8 +271,10 @@ bool startQPickerDialog(char* inElementTag, char* inColorString) {
  **/
 extern "C"
 void endQPickerDialog() {
-    mColorDialog->setQPickerActive(false);
-    mColorDialog->setQPickerCallerName(nullptr);
+    if (mColorDialog == nullptr) {
+        return;
+    }
+    mColorDialog->endPicking();
 }
 
 
@@ -220,11 +285,16 @@ void endQPickerDialog() {
  **/
 extern "C"
 void uninitQPickerDialog() {
-    if (mColorApp != nullptr) {
-        endQPickerDialog();
-        mColorDialog->setAlreadyTerminated(true);
+    mColorAppTerminated = true;
 
-        mColorApp->closeAllWindows();
-        mColorApp = nullptr;
+    // Qt never started, nothing to tear down.
+    if (mColorApp == nullptr) {
+        return;
     }
+
+    endQPickerDialog();
+    mColorDialog->setAlreadyTerminated(true);
+
+    mColorApp->closeAllWindows();
+    mColorApp = nullptr;
 }
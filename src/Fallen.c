@@ -23,12 +23,16 @@
 #include "config.h"
 #endif
 
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include <X11/Intrinsic.h>
 #include <X11/Xlib.h>
@@ -40,7 +44,11 @@
 #include <gtk/gtk.h>
 
 #include "Blowoff.h"
+#include "ColorCodes.h"
+#include "columnTreeHelper.h"
 #include "Fallen.h"
+#include "FallenSnapshot.h"
+#include "loadmeasure.h"
 #include "Prefs.h"
 #include "safeMalloc.h"
 #include "Storm.h"
@@ -49,6 +57,10 @@
 #include "Wind.h"
 #include "Windows.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_FALLEN
+#include "x11Stats.h"
+
 /** *********************************************************************
  ** Module globals and consts.
  **/
@@ -57,36 +69,110 @@
 
 #define MINIMUM_SPLINE_WIDTH 3
 
-// Semaphore & lock members.
-static sem_t mFallenSwapSemaphore;
-static sem_t mFallenBaseSemaphore;
+// Lock members. The base lock is a reader/writer lock over the
+// FallenItem list structure; fallenHeight values are additionally
+// covered by a sequence count so the fallen thread can snapshot
+// them while UI thread readers keep landing items.
+static pthread_rwlock_t mFallenBaseLock;
+static unsigned int mFallenHeightSequence = 0;
+
+// Odd while the UI thread paints fallen surfaces. Used as a
+// grace period before the fallen thread reuses a back surface.
+static unsigned int mFallenPaintSequence = 0;
+
+// Fallen thread members. The thread sleeps on
+// mFallenThreadCondition until some FallenItem is marked dirty.
+static pthread_t mFallenThread;
+static bool mIsFallenThreadRunning = false;
+
+static pthread_mutex_t mFallenThreadMutex =
+    PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mFallenThreadCondition;
+
+static bool mFallenThreadUpdatePending = false;
+static bool mFallenThreadStopRequested = false;
+
+// Fallen thread private copy of heights being drawn.
+static short int* mFallenHeightSnapshot = NULL;
+static int mFallenHeightSnapshotSize = 0;
+
+// Lock contention counters.
+static FallenLockStats mFallenLockStats;
+
+// Blowoff works in bands of columns.
+#define BLOWOFF_BAND_WIDTH 8
+#define BLOWOFF_MAX_BAND_ITEMS 128
+
+// Display area uncovered by blowoff, see flushFallenDamage().
+static cairo_region_t* mFallenDamage = NULL;
+
+// Highest fallen top on screen, a lower bound on every
+// fallen->y - fallenHeight[i]. Growth keeps it current,
+// erosion only leaves it conservative, and any write lock
+// (list or geometry change) invalidates it.
+static int mFallenHighestTop = 0;
+static bool mIsFallenHighestTopValid = false;
 
 /***********************************************************
  * Helper methods for semaphores.
  */
 void initFallenSemaphores() {
-    sem_init(&mFallenSwapSemaphore, 0, 1);
-    sem_init(&mFallenBaseSemaphore, 0, 1);
+    pthread_rwlock_init(&mFallenBaseLock, NULL);
+    memset(&mFallenLockStats, 0, sizeof(mFallenLockStats));
+
+    // Thread condition runs on the monotonic clock so
+    // wall clock jumps can't stretch our timed waits.
+    pthread_condattr_t conditionAttributes;
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&mFallenThreadCondition, &conditionAttributes);
+    pthread_condattr_destroy(&conditionAttributes);
 }
 
-// Swap semaphores.
-int lockFallenSwapSemaphore() {
-    return sem_wait(&mFallenSwapSemaphore);
-}
-int unlockFallenSwapSemaphore() {
-    return sem_post(&mFallenSwapSemaphore);
-}
+/***********************************************************
+ * This method returns monotonic time in nanoseconds.
+ */
+static unsigned long long getFallenLockClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-// Base semaphores.
-int lockFallenBaseSemaphore() {
-    return sem_wait(&mFallenBaseSemaphore);
+    return (unsigned long long) now.tv_sec * 1000000000ULL +
+        now.tv_nsec;
 }
-int unlockFallenBaseSemaphore() {
-    return sem_post(&mFallenBaseSemaphore);
+
+/***********************************************************
+ * These methods take the base lock, trying first so that
+ * only contended acquisitions pay for timing the wait.
+ */
+static int acquireFallenBaseLock(bool forWrite, bool mayBlock) {
+    int resultCode = forWrite ?
+        pthread_rwlock_trywrlock(&mFallenBaseLock) :
+        pthread_rwlock_tryrdlock(&mFallenBaseLock);
+
+    if (resultCode == EBUSY && mayBlock) {
+        __atomic_fetch_add(&mFallenLockStats.contendedAcquisitions,
+            1, __ATOMIC_RELAXED);
+
+        const unsigned long long waitStart = getFallenLockClock();
+        resultCode = forWrite ?
+            pthread_rwlock_wrlock(&mFallenBaseLock) :
+            pthread_rwlock_rdlock(&mFallenBaseLock);
+        __atomic_fetch_add(&mFallenLockStats.waitNanoseconds,
+            getFallenLockClock() - waitStart, __ATOMIC_RELAXED);
+    }
+
+    if (resultCode == 0) {
+        __atomic_fetch_add(forWrite ?
+            &mFallenLockStats.writeAcquisitions :
+            &mFallenLockStats.readAcquisitions,
+            1, __ATOMIC_RELAXED);
+    }
+
+    return resultCode;
 }
-int softLockFallenBaseSemaphore(
+
+static int softAcquireFallenBaseLock(bool forWrite,
     int maxSoftTries, int* tryCount) {
-    int resultCode;
 
     // Guard tryCount and bump.
     if (*tryCount < 0) {
@@ -95,22 +181,178 @@ int softLockFallenBaseSemaphore(
     (*tryCount)++;
 
     // Set resultCode from soft or hard wait.
-    resultCode = (*tryCount > maxSoftTries) ?
-        sem_wait(&mFallenBaseSemaphore) :
-        sem_trywait(&mFallenBaseSemaphore);
+    const int resultCode = acquireFallenBaseLock(forWrite,
+        *tryCount > maxSoftTries);
 
     // Success clears tryCount for next time.
     if (resultCode == 0) {
         *tryCount = 0;
+    } else {
+        __atomic_fetch_add(&mFallenLockStats.softLockGiveUps,
+            1, __ATOMIC_RELAXED);
     }
 
     return resultCode;
 }
 
+// Base semaphores, exclusive. Needed to change the
+// list itself or any FallenItem's winInfo & geometry.
+int lockFallenBaseSemaphore() {
+    const int resultCode = acquireFallenBaseLock(true, true);
+    if (resultCode == 0) {
+        invalidateFallenHighestTop();
+    }
+    return resultCode;
+}
+int softLockFallenBaseSemaphore(
+    int maxSoftTries, int* tryCount) {
+    const int resultCode = softAcquireFallenBaseLock(true,
+        maxSoftTries, tryCount);
+    if (resultCode == 0) {
+        invalidateFallenHighestTop();
+    }
+    return resultCode;
+}
+
+// Base semaphores, shared. Enough to walk the list and
+// to change heights inside a height update.
+int lockFallenBaseSemaphoreForRead() {
+    return acquireFallenBaseLock(false, true);
+}
+int softLockFallenBaseSemaphoreForRead(
+    int maxSoftTries, int* tryCount) {
+    return softAcquireFallenBaseLock(false,
+        maxSoftTries, tryCount);
+}
+
+int unlockFallenBaseSemaphore() {
+    return pthread_rwlock_unlock(&mFallenBaseLock);
+}
+
+/***********************************************************
+ * Height sequence helpers. Heights are only ever written
+ * from the UI thread, so writers don't need to serialize
+ * against each other.
+ */
+void beginFallenHeightUpdate() {
+    __atomic_fetch_add(&mFallenHeightSequence, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+void endFallenHeightUpdate() {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_fetch_add(&mFallenHeightSequence, 1, __ATOMIC_RELAXED);
+}
+
+/***********************************************************
+ * This method copies a consistent set of fallenHeight values,
+ * retrying if a UI thread update overlapped the copy.
+ */
+void copyFallenHeights(FallenItem* fallen, short int* heights) {
+    while (true) {
+        const unsigned int sequence = __atomic_load_n(
+            &mFallenHeightSequence, __ATOMIC_ACQUIRE);
+
+        if (!(sequence & 1)) {
+            memcpy(heights, fallen->fallenHeight,
+                sizeof(*heights) * fallen->w);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (__atomic_load_n(&mFallenHeightSequence,
+                    __ATOMIC_RELAXED) == sequence) {
+                return;
+            }
+        }
+
+        __atomic_fetch_add(&mFallenLockStats.heightCopyRetries,
+            1, __ATOMIC_RELAXED);
+        sched_yield();
+    }
+}
+
+/***********************************************************
+ * Lock statistics.
+ */
+void getFallenLockStats(FallenLockStats* stats) {
+    stats->readAcquisitions = __atomic_load_n(
+        &mFallenLockStats.readAcquisitions, __ATOMIC_RELAXED);
+    stats->writeAcquisitions = __atomic_load_n(
+        &mFallenLockStats.writeAcquisitions, __ATOMIC_RELAXED);
+    stats->contendedAcquisitions = __atomic_load_n(
+        &mFallenLockStats.contendedAcquisitions, __ATOMIC_RELAXED);
+    stats->waitNanoseconds = __atomic_load_n(
+        &mFallenLockStats.waitNanoseconds, __ATOMIC_RELAXED);
+    stats->softLockGiveUps = __atomic_load_n(
+        &mFallenLockStats.softLockGiveUps, __ATOMIC_RELAXED);
+    stats->heightCopyRetries = __atomic_load_n(
+        &mFallenLockStats.heightCopyRetries, __ATOMIC_RELAXED);
+    stats->surfaceReuseWaits = __atomic_load_n(
+        &mFallenLockStats.surfaceReuseWaits, __ATOMIC_RELAXED);
+}
+
+void logFallenLockStats() {
+    FallenLockStats stats;
+    getFallenLockStats(&stats);
+
+    printf("%splasmastorm: Fallen locks: %llu read, %llu write, "
+        "%llu contended (%.3f ms waiting), %llu soft lock give-ups, "
+        "%llu height copy retries, %llu surface reuse waits.%s\n",
+        COLOR_BLUE, stats.readAcquisitions, stats.writeAcquisitions,
+        stats.contendedAcquisitions, stats.waitNanoseconds / 1e6,
+        stats.softLockGiveUps, stats.heightCopyRetries,
+        stats.surfaceReuseWaits, COLOR_NORMAL);
+}
+
+/** *********************************************************************
+ ** This method returns the highest fallen top on screen. Items
+ ** above it can't land on anything.
+ **/
+int getFallenHighestTop() {
+    if (mIsFallenHighestTopValid) {
+        return mFallenHighestTop;
+    }
+
+    mFallenHighestTop = INT_MAX;
+    FallenItem* fallen = mGlobal.FallenFirst;
+    while (fallen) {
+        const int top = fallen->y -
+            getColumnTreeMax(fallen->heightTree, 0, fallen->w);
+        if (top < mFallenHighestTop) {
+            mFallenHighestTop = top;
+        }
+        fallen = fallen->next;
+    }
+
+    mIsFallenHighestTopValid = true;
+    return mFallenHighestTop;
+}
+
+/** *********************************************************************
+ ** This method forces getFallenHighestTop() to rescan.
+ **/
+void invalidateFallenHighestTop() {
+    mIsFallenHighestTopValid = false;
+}
+
+/** *********************************************************************
+ ** This method keeps the highest top current as a fallen grows.
+ **/
+static void raiseFallenHighestTop(FallenItem* fallen) {
+    if (!mIsFallenHighestTopValid) {
+        return;
+    }
+
+    const int top = fallen->y -
+        getColumnTreeMax(fallen->heightTree, 0, fallen->w);
+    if (top < mFallenHighestTop) {
+        mFallenHighestTop = top;
+    }
+}
+
 /** *********************************************************************
  ** This method ...
  **/
 void initFallenModule() {
+    loadFallenSnapshot();
     initFallenListWithDesktop();
 
     addMethodToMainloop(PRIORITY_DEFAULT,
@@ -118,8 +360,40 @@ void initFallenModule() {
     addMethodToMainloop(PRIORITY_DEFAULT,
         time_adjust_bottom, do_adjust_deshes);
 
-    static pthread_t thread;
-    pthread_create(&thread, NULL, execFallenThread, NULL);
+    mFallenThreadStopRequested = false;
+    mIsFallenThreadRunning = (pthread_create(&mFallenThread,
+        NULL, execFallenThread, NULL) == 0);
+
+    addPrefObserver(PREF_KEEP_FALLEN_ON_WINDOWS,
+        respondToSurfacesSettingsChanges);
+    addPrefObserver(PREF_MAX_WINDOW_FALLEN_DEPTH,
+        respondToSurfacesSettingsChanges);
+    addPrefObserver(PREF_WINDOW_FALLEN_TOP_OFFSET,
+        respondToSurfacesSettingsChanges);
+    addPrefObserver(PREF_KEEP_FALLEN_ON_DESKTOP,
+        respondToSurfacesSettingsChanges);
+    addPrefObserver(PREF_MAX_DESKTOP_FALLEN_DEPTH,
+        respondToSurfacesSettingsChanges);
+    addPrefObserver(PREF_DESKTOP_FALLEN_TOP_OFFSET,
+        respondToSurfacesSettingsChanges);
+}
+
+/** *********************************************************************
+ ** This method stops the fallen thread & waits for it to finish
+ ** its current pass.
+ **/
+void uninitFallenModule() {
+    if (!mIsFallenThreadRunning) {
+        return;
+    }
+
+    pthread_mutex_lock(&mFallenThreadMutex);
+    mFallenThreadStopRequested = true;
+    pthread_cond_signal(&mFallenThreadCondition);
+    pthread_mutex_unlock(&mFallenThreadMutex);
+
+    pthread_join(mFallenThread, NULL);
+    mIsFallenThreadRunning = false;
 }
 
 /** *********************************************************************
@@ -146,28 +420,92 @@ void initFallenListWithDesktop() {
 }
 
 /** *********************************************************************
- ** This method is a private thread looper.
+ ** This method is a private thread looper. It sleeps until a
+ ** FallenItem is marked dirty (or the max latency passes), redraws
+ ** all dirty items in one pass, then waits out the batch window so
+ ** a burst of landings costs one redraw.
  **/
 void* execFallenThread() {
-    // Loop until cancelled.
-    while (1) {
+    while (true) {
+        if (!waitForFallenThreadEvent(
+                DO_FALLEN_THREAD_MAX_LATENCY_TIME, true)) {
+            break;
+        }
         if (Flags.shutdownRequested) {
-            pthread_exit(NULL);
+            break;
         }
 
         // Main thread method.
+        const uint64_t fallenCostStart = startLoadCost(LOAD_COST_FALLEN);
         updateAllFallenOnThread();
+        endLoadCost(LOAD_COST_FALLEN, fallenCostStart);
 
-        usleep((useconds_t)
-            DO_FALLEN_THREAD_EVENT_TIME * 1000000);
+        // The quality governor stretches the batch window under load.
+        if (!waitForFallenThreadEvent(DO_FALLEN_THREAD_EVENT_TIME *
+                getQualityFallenIntervalScale(), false)) {
+            break;
+        }
     }
 
     return NULL;
 }
 
+/** *********************************************************************
+ ** This method blocks the fallen thread for up to waitTime seconds.
+ ** When wakeOnUpdate is set, a pending update ends the wait early
+ ** (and is consumed). Returns false if the thread should stop.
+ **/
+bool waitForFallenThreadEvent(double waitTime, bool wakeOnUpdate) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    deadline.tv_sec += (time_t) waitTime;
+    deadline.tv_nsec += (long) ((waitTime - (time_t) waitTime) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&mFallenThreadMutex);
+    while (!mFallenThreadStopRequested &&
+        !(wakeOnUpdate && mFallenThreadUpdatePending)) {
+        if (pthread_cond_timedwait(&mFallenThreadCondition,
+                &mFallenThreadMutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    if (wakeOnUpdate) {
+        mFallenThreadUpdatePending = false;
+    }
+    const bool shouldContinue = !mFallenThreadStopRequested;
+    pthread_mutex_unlock(&mFallenThreadMutex);
+
+    return shouldContinue;
+}
 
 /** *********************************************************************
- ** This method ...
+ ** This method wakes the fallen thread for a redraw pass.
+ **/
+void signalFallenThread() {
+    pthread_mutex_lock(&mFallenThreadMutex);
+    mFallenThreadUpdatePending = true;
+    pthread_cond_signal(&mFallenThreadCondition);
+    pthread_mutex_unlock(&mFallenThreadMutex);
+}
+
+/** *********************************************************************
+ ** This method flags a FallenItem for redraw by the fallen thread.
+ ** threads: base lock (read or write) held by caller
+ **/
+void markFallenItemDirty(FallenItem* fallen) {
+    __atomic_store_n(&fallen->isDirty, true, __ATOMIC_RELEASE);
+    signalFallenThread();
+}
+
+/** *********************************************************************
+ ** This method redraws all dirty FallenItems. Runs on the fallen
+ ** thread, and so must never make Xlib calls: all drawing is into
+ ** cairo image surfaces that the UI thread paints & flushes.
  **/
 void updateAllFallenOnThread() {
     if (!WorkspaceActive() || !Flags.ShowStormItems) {
@@ -177,83 +515,60 @@ void updateAllFallenOnThread() {
         return;
     }
 
-    lockFallenSemaphore();
+    lockFallenSemaphoreForRead();
 
     FallenItem* fallen = mGlobal.FallenFirst;
     while (fallen) {
-        if (canFallenConsumeStormItem(fallen)) {
+        // Items that can't be drawn now stay dirty
+        // until they can. Clear before drawing, so a
+        // landing during the draw marks it again.
+        if (__atomic_load_n(&fallen->isDirty, __ATOMIC_ACQUIRE) &&
+            canFallenConsumeStormItem(fallen) &&
+            isFallenVisible(fallen)) {
+            __atomic_store_n(&fallen->isDirty, false,
+                __ATOMIC_RELEASE);
             drawFallenItem(fallen);
+            swapFallenItemSurfaces(fallen);
         }
         fallen = fallen->next;
     }
 
-    XFlush(mGlobal.display);
-    swapFallenListItemSurfaces();
     unlockFallenSemaphore();
 }
 
 /** *********************************************************************
  ** This method ...
  **/
-void respondToSurfacesSettingsChanges() {
-    //UIDO(KeepFallenOnWindows,
-    if (Flags.KeepFallenOnWindows !=
-            OldFlags.KeepFallenOnWindows) {
-        OldFlags.KeepFallenOnWindows =
-            Flags.KeepFallenOnWindows;
-        initFallenListWithDesktop();
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
-    }
+void respondToSurfacesSettingsChanges(PrefKey key) {
+    switch (key) {
+        case PREF_KEEP_FALLEN_ON_WINDOWS:
+        case PREF_MAX_WINDOW_FALLEN_DEPTH:
+        case PREF_KEEP_FALLEN_ON_DESKTOP:
+            initFallenListWithDesktop();
+            clearStormWindow();
+            break;
 
-    //UIDO(MaxWindowFallenDepth,
-    if (Flags.MaxWindowFallenDepth !=
-            OldFlags.MaxWindowFallenDepth) {
-        OldFlags.MaxWindowFallenDepth =
-            Flags.MaxWindowFallenDepth;
-        initFallenListWithDesktop();
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_WINDOW_FALLEN_TOP_OFFSET:
+            updateFallenRegionsWithLock();
+            break;
 
-    //UIDO(WindowFallenTopOffset, 
-    if (Flags.WindowFallenTopOffset !=
-            OldFlags.WindowFallenTopOffset) {
-        OldFlags.WindowFallenTopOffset =
-            Flags.WindowFallenTopOffset;
-        updateFallenRegionsWithLock();
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_MAX_DESKTOP_FALLEN_DEPTH:
+            setMaxDesktopFallenDepth();
+            initFallenListWithDesktop();
+            clearStormWindow();
+            break;
 
-    //UIDO(KeepFallenOnDesktop,
-    if (Flags.KeepFallenOnDesktop !=
-            OldFlags.KeepFallenOnDesktop) {
-        OldFlags.KeepFallenOnDesktop =
-            Flags.KeepFallenOnDesktop;
-        initFallenListWithDesktop();
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_DESKTOP_FALLEN_TOP_OFFSET:
+            updateDisplayDimensions();
+            break;
 
-    //UIDO(MaxDesktopFallenDepth,
-    if (Flags.MaxDesktopFallenDepth !=
-            OldFlags.MaxDesktopFallenDepth) {
-        OldFlags.MaxDesktopFallenDepth =
-            Flags.MaxDesktopFallenDepth;
-        setMaxDesktopFallenDepth();
-        initFallenListWithDesktop();
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
+        default:
+            return;
     }
 
-    //UIDO(DesktopFallenTopOffset, 
-    if (Flags.DesktopFallenTopOffset !=
-            OldFlags.DesktopFallenTopOffset) {
-        OldFlags.DesktopFallenTopOffset =
-            Flags.DesktopFallenTopOffset;
-        updateDisplayDimensions();
-        Flags.mHaveFlagsChanged++;
-    }
+    // Catch up on anything left dirty while
+    // fallen drawing was switched off.
+    signalFallenThread();
 }
 
 /** *********************************************************************
@@ -289,11 +604,11 @@ int canFallenConsumeStormItem(FallenItem *fallen) {
         return Flags.KeepFallenOnDesktop;
     }
 
-    if (fallen->winInfo.hidden) {
+    if (fallen->winInfo.state & WINDOW_STATE_HIDDEN) {
         return false;
     }
 
-    if (!fallen->winInfo.sticky &&
+    if (!(fallen->winInfo.state & WINDOW_STATE_STICKY) &&
         !isFallenOnVisibleWorkspace(fallen)) {
         return false;
     }
@@ -321,35 +636,82 @@ int isFallenOnVisibleWorkspace(FallenItem *fallen) {
  **
  ** This method removes some fallen StormItems from fallen, w pixels.
  **
- ** Also add storm items.
+ ** Also add storm items. Work is done per band of columns: half the
+ ** tall enough columns blow (binomial), each losing a pixel, and the
+ ** band's items are sampled as one Poisson count & created in bulk.
  **/
 void updateFallenWithWind(FallenItem *fallen, int w, int h) {
-    int x = randint(fallen->w - w);
-
-    for (int i = x; i < x + w; i++) {
-        if (fallen->fallenHeight[i] > h) {
-            if (Flags.ShowWind && mGlobal.Wind != 0 && drand48() > 0.5) {
-
-                const int numberOfItemsToMake =
-                    getBlowoffEventCount();
-                for (int j = 0; j < numberOfItemsToMake; j++) {
-                    StormItem* stormItem = createStormItem(
-                        Flags.ComboStormShape - 1);
-
-                    stormItem->xRealPosition = fallen->x + i;
-                    stormItem->yRealPosition = fallen->y -
-                        fallen->fallenHeight[i] - drand48() * 4;
-                    stormItem->xVelocity = 0.25 *
-                        getWindDirection(mGlobal.NewWind) * mGlobal.WindMax;
-                    stormItem->yVelocity = -10;
-
-                    // Not cyclic for Windows, cyclic for bottom.
-                    stormItem->cyclic = (fallen->winInfo.window == 0);
-                }
+    if (!Flags.ShowWind || mGlobal.Wind == 0) {
+        return;
+    }
 
-                eraseFallenAtPixel(fallen, i);
+    const float detailScale = getQualityBlowoffScale();
+    if (detailScale <= 0) {
+        return;
+    }
+
+    const int x = randint(fallen->w - w);
+    const double itemsPerColumn = getBlowoffEventMean() *
+        detailScale;
+
+    int columns[BLOWOFF_BAND_WIDTH];
+    StormItem* stormItems[BLOWOFF_MAX_BAND_ITEMS];
+
+    for (int band = x; band < x + w; band += BLOWOFF_BAND_WIDTH) {
+        int bandEnd = band + BLOWOFF_BAND_WIDTH;
+        if (bandEnd > x + w) {
+            bandEnd = x + w;
+        }
+
+        // Nothing tall enough in this band.
+        if (getColumnTreeMax(fallen->heightTree,
+            band, bandEnd) <= h) {
+            continue;
+        }
+
+        int eligibleCount = 0;
+        for (int i = band; i < bandEnd; i++) {
+            if (fallen->fallenHeight[i] > h) {
+                columns[eligibleCount++] = i;
             }
         }
+
+        // Pick which columns blow, partial shuffle to the front.
+        const int blownCount = randomBinomial(eligibleCount, 0.5);
+        if (blownCount == 0) {
+            continue;
+        }
+        for (int k = 0; k < blownCount; k++) {
+            const int pick = k + randint(eligibleCount - k);
+            const int column = columns[pick];
+            columns[pick] = columns[k];
+            columns[k] = column;
+        }
+
+        int itemCount = randomPoisson(blownCount * itemsPerColumn);
+        if (itemCount > BLOWOFF_MAX_BAND_ITEMS) {
+            itemCount = BLOWOFF_MAX_BAND_ITEMS;
+        }
+        createStormItems(Flags.ComboStormShape - 1,
+            itemCount, stormItems);
+
+        const float xVelocity = 0.25 *
+            getWindDirection(mGlobal.NewWind) * mGlobal.WindMax;
+        for (int k = 0; k < itemCount; k++) {
+            StormItem* stormItem = stormItems[k];
+            const int i = columns[k % blownCount];
+
+            stormItem->xRealPosition = fallen->x + i;
+            stormItem->yRealPosition = fallen->y -
+                fallen->fallenHeight[i] - drand48() * 4;
+            stormItem->xVelocity = xVelocity;
+            stormItem->yVelocity = -10;
+
+            // Not cyclic for Windows, cyclic for bottom.
+            stormItem->cyclic = (fallen->winInfo.window == 0);
+        }
+
+        eraseFallenAtColumns(fallen, columns, blownCount);
     }
 }
 
@@ -368,6 +730,8 @@ void updateFallenPartial(FallenItem* fallen, int position, int width) {
         return;
     }
 
+    beginFallenHeightUpdate();
+
     // tempHeightArray will contain the fallenHeight values
     // corresponding with position-1 .. position+width (inclusive).
     short int* tempHeightArray;
@@ -440,6 +804,13 @@ void updateFallenPartial(FallenItem* fallen, int position, int width) {
     }
 
     free(tempHeightArray);
+
+    updateColumnTreeRange(fallen->heightTree,
+        fallen->fallenHeight, imin, imax);
+    endFallenHeightUpdate();
+
+    raiseFallenHighestTop(fallen);
+    markFallenItemDirty(fallen);
 }
 
 /** *********************************************************************
@@ -455,13 +826,20 @@ void updateFallenAtBottom() {
 }
 
 /** *********************************************************************
- ** This method ... threads: locking by caller
+ ** This method turns fallen into StormItems, when its window goes
+ ** away. Sampled per band: every other column & row is a cell
+ ** that yields 0.1 * getBlowoffEventCount() items on average.
+ ** threads: locking by caller
  **/
 void generateFallenStormItems(FallenItem *fallen,
     int x, int w, float yVelocity) {
     if (!Flags.ShowBlowoff || !Flags.ShowStormItems) {
         return;
     }
+    const float detailScale = getQualityBlowoffScale();
+    if (detailScale <= 0) {
+        return;
+    }
 
     int ifirst = x;
     if (ifirst < 0) {
@@ -478,28 +856,61 @@ void generateFallenStormItems(FallenItem *fallen,
         ilast = fallen->w;
     }
 
-    for (int i = ifirst; i < ilast; i += 2) {
-        for (int j = 0; j < fallen->fallenHeight[i]; j += 2) {
+    const double itemsPerCell = 0.1 * getBlowoffEventMean() *
+        detailScale;
+    const float xVelocity = (Flags.ShowWind) ?
+        mGlobal.NewWind / 8 : 0;
 
-            const int kmax = getBlowoffEventCount();
-            for (int k = 0; k < kmax; k++) {
-                const bool probability = (drand48() < 0.1);
+    int cellEnds[BLOWOFF_BAND_WIDTH];
+    StormItem* stormItems[BLOWOFF_MAX_BAND_ITEMS];
 
-                if (probability) {
-                    StormItem* stormItem = createStormItem(
-                        Flags.ComboStormShape - 1);
+    for (int band = ifirst; band < ilast;
+        band += BLOWOFF_BAND_WIDTH) {
+        if (getColumnTreeMax(fallen->heightTree, band,
+            band + BLOWOFF_BAND_WIDTH) <= 0) {
+            continue;
+        }
 
-                    stormItem->cyclic = 0;
+        // Running count of cells per sampled column.
+        int columnCount = 0;
+        int cellCount = 0;
+        for (int i = band; i < band + BLOWOFF_BAND_WIDTH &&
+            i < ilast; i += 2) {
+            cellCount += (fallen->fallenHeight[i] + 1) / 2;
+            cellEnds[columnCount++] = cellCount;
+        }
+        if (cellCount == 0) {
+            continue;
+        }
 
-                    stormItem->xRealPosition = fallen->x + i + 16 *
-                        (drand48() - 0.5);
-                    stormItem->yRealPosition = fallen->y - j - 8;
+        int itemCount = randomPoisson(cellCount * itemsPerCell);
+        if (itemCount > BLOWOFF_MAX_BAND_ITEMS) {
+            itemCount = BLOWOFF_MAX_BAND_ITEMS;
+        }
+        createStormItems(Flags.ComboStormShape - 1,
+            itemCount, stormItems);
 
-                    stormItem->xVelocity = (Flags.ShowWind) ?
-                        mGlobal.NewWind / 8 : 0;
-                    stormItem->yVelocity = yVelocity;
-                }
+        for (int k = 0; k < itemCount; k++) {
+            StormItem* stormItem = stormItems[k];
+
+            // Uniform cell, then its column & row.
+            const int cell = randint(cellCount);
+            int column = 0;
+            while (cell >= cellEnds[column]) {
+                column++;
             }
+            const int firstCell = column ? cellEnds[column - 1] : 0;
+            const int i = band + 2 * column;
+            const int j = 2 * (cell - firstCell);
+
+            stormItem->cyclic = 0;
+
+            stormItem->xRealPosition = fallen->x + i + 16 *
+                (drand48() - 0.5);
+            stormItem->yRealPosition = fallen->y - j - 8;
+
+            stormItem->xVelocity = xVelocity;
+            stormItem->yVelocity = yVelocity;
         }
     }
 }
@@ -532,6 +943,9 @@ void pushFallenItem(FallenItem** fallenArray,
     fallenListItem->prevw = 10;
     fallenListItem->prevh = 10;
 
+    fallenListItem->isDirty = true;
+    fallenListItem->swapPaintSequence = 0;
+
     fallenListItem->surface = cairo_image_surface_create(
         CAIRO_FORMAT_ARGB32, w, h);
     fallenListItem->surface1 = cairo_surface_create_similar(
@@ -554,7 +968,13 @@ void pushFallenItem(FallenItem** fallenArray,
         fallenListItem->maxFallenHeight[i] = h;
     }
 
-    CreateDesh(fallenListItem);
+    // Carry over heights from before a restart, else a new desh.
+    if (!restoreFallenFromSnapshot(fallenListItem)) {
+        CreateDesh(fallenListItem);
+    }
+    fallenListItem->heightTree = createColumnTree(
+        fallenListItem->fallenHeight, w);
+    invalidateFallenHighestTop();
 
     fallenListItem->next = *fallenArray;
     *fallenArray = fallenListItem;
@@ -630,7 +1050,7 @@ void CreateDesh(FallenItem *p) {
 // change to desired heights
 int do_change_deshes() {
     static int lockcounter;
-    if (softLockFallenBaseSemaphore(3, &lockcounter)) {
+    if (softLockFallenBaseSemaphoreForRead(3, &lockcounter)) {
         return TRUE;
     }
 
@@ -648,9 +1068,8 @@ int do_change_deshes() {
  ** This method ...
  **/
 int do_adjust_deshes(__attribute__((unused))void* dummy) {
-    // TODO: threads: probably no need for
-    // lock, but to be sure:
-    lockFallenSemaphore();
+    lockFallenSemaphoreForRead();
+    beginFallenHeightUpdate();
 
     FallenItem *fallen = mGlobal.FallenFirst;
     while (fallen) {
@@ -664,9 +1083,15 @@ int do_adjust_deshes(__attribute__((unused))void* dummy) {
                 fallen->fallenHeight[i] -= c;
             }
         }
+        if (adjustments) {
+            rebuildColumnTree(fallen->heightTree,
+                fallen->fallenHeight);
+            markFallenItemDirty(fallen);
+        }
         fallen = fallen->next;
     }
 
+    endFallenHeightUpdate();
     unlockFallenSemaphore();
     return TRUE;
 }
@@ -674,11 +1099,24 @@ int do_adjust_deshes(__attribute__((unused))void* dummy) {
 /** *********************************************************************
  ** This method ...
  **/
-// threads: locking by caller
+// threads: fallen thread only, base lock held for read.
 void createFallenDisplayArea(FallenItem* fallen) {
-    cairo_t* cr = cairo_create(fallen->surface1);
+    // Draw from a private copy of the heights, UI thread
+    // landings carry on while we draw.
+    if (mFallenHeightSnapshotSize < fallen->w) {
+        mFallenHeightSnapshotSize = fallen->w;
+        mFallenHeightSnapshot = (short int*) realloc(
+            mFallenHeightSnapshot, sizeof(short int) *
+            mFallenHeightSnapshotSize);
+        REALLOC_CHECK(mFallenHeightSnapshot);
+    }
+    copyFallenHeights(fallen, mFallenHeightSnapshot);
+    short int *fallenHeight = mFallenHeightSnapshot;
 
-    short int *fallenHeight = fallen->fallenHeight;
+    // surface1 was the front surface before the last swap,
+    // make sure the UI thread is done painting it.
+    waitForFallenSurfaceRelease(fallen);
+    cairo_t* cr = cairo_create(fallen->surface1);
 
     cairo_set_antialias(cr, CAIRO_ANTIALIAS_DEFAULT);
     cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
@@ -801,16 +1239,85 @@ void createFallenDisplayArea(FallenItem* fallen) {
 }
 
 /** *********************************************************************
- ** This method ... threads: locking by caller
+ ** This method takes the top pixel off each of the given columns.
+ ** The erased pixels are added to the damage region, cleared on the
+ ** display by flushFallenDamage().
+ ** threads: locking by caller
  **/
-void eraseFallenAtPixel(FallenItem *fallen, int x) {
-    if (fallen->fallenHeight[x] <= 0) {
+void eraseFallenAtColumns(FallenItem *fallen,
+    const int* columns, int count) {
+    int xmin = fallen->w, xmax = -1;
+    int topmost = 0, lowest = fallen->h;
+
+    beginFallenHeightUpdate();
+    for (int k = 0; k < count; k++) {
+        const int x = columns[k];
+        if (fallen->fallenHeight[x] <= 0) {
+            continue;
+        }
+
+        if (x < xmin) {
+            xmin = x;
+        }
+        if (x > xmax) {
+            xmax = x;
+        }
+        if (fallen->fallenHeight[x] > topmost) {
+            topmost = fallen->fallenHeight[x];
+        }
+        if (fallen->fallenHeight[x] < lowest) {
+            lowest = fallen->fallenHeight[x];
+        }
+
+        fallen->fallenHeight[x]--;
+    }
+    if (xmax >= 0) {
+        updateColumnTreeRange(fallen->heightTree,
+            fallen->fallenHeight, xmin, xmax + 1);
+    }
+    endFallenHeightUpdate();
+
+    if (xmax < 0) {
         return;
     }
 
-    sanelyCheckAndClearDisplayArea(mGlobal.display, mGlobal.StormWindow,
-        fallen->x + x, fallen->y - fallen->fallenHeight[x], 1, 1, false);
-    fallen->fallenHeight[x]--;
+    addFallenDamage(fallen->x + xmin, fallen->y - topmost,
+        xmax - xmin + 1, topmost - lowest + 1);
+    markFallenItemDirty(fallen);
+}
+
+/** *********************************************************************
+ ** This method adds a display rectangle to the damage region.
+ **/
+void addFallenDamage(int x, int y, int w, int h) {
+    if (!mFallenDamage) {
+        mFallenDamage = cairo_region_create();
+    }
+
+    const cairo_rectangle_int_t rectangle = { x, y, w, h };
+    cairo_region_union_rectangle(mFallenDamage, &rectangle);
+}
+
+/** *********************************************************************
+ ** This method clears all damaged display area in one go. The
+ ** fallen itself is repainted by the next frame.
+ **/
+void flushFallenDamage() {
+    if (!mFallenDamage) {
+        return;
+    }
+
+    const int count = cairo_region_num_rectangles(mFallenDamage);
+    for (int i = 0; i < count; i++) {
+        cairo_rectangle_int_t rectangle;
+        cairo_region_get_rectangle(mFallenDamage, i, &rectangle);
+        sanelyCheckAndClearDisplayArea(mGlobal.display,
+            mGlobal.StormWindow, rectangle.x, rectangle.y,
+            rectangle.width, rectangle.height, false);
+    }
+
+    cairo_region_destroy(mFallenDamage);
+    mFallenDamage = NULL;
 }
 
 /** *********************************************************************
@@ -831,6 +1338,7 @@ void freeFallenItemMemory(FallenItem *fallen) {
     free(fallen->columnColor);
     free(fallen->fallenHeight);
     free(fallen->maxFallenHeight);
+    destroyColumnTree(fallen->heightTree);
 
     cairo_surface_destroy(fallen->surface);
     cairo_surface_destroy(fallen->surface1);
@@ -856,16 +1364,26 @@ FallenItem* findFallenItemByWindow(FallenItem* first,
 }
 
 /** *********************************************************************
- ** This method ...
+ ** This method returns true if the FallenItem is currently shown.
  **/
-void drawFallenItem(FallenItem* fallen) {
-    if (fallen->winInfo.window == 0 ||
-        (!fallen->winInfo.hidden &&
+bool isFallenVisible(FallenItem* fallen) {
+    return fallen->winInfo.window == 0 ||
+        (!(fallen->winInfo.state & WINDOW_STATE_HIDDEN) &&
             (isFallenOnVisibleWorkspace(fallen) ||
-                fallen->winInfo.sticky))) {
+                (fallen->winInfo.state & WINDOW_STATE_STICKY)));
+}
 
-        createFallenDisplayArea(fallen);
+/** *********************************************************************
+ ** This method draws a visible FallenItem into its back surface.
+ ** Returns true if it drew.
+ **/
+bool drawFallenItem(FallenItem* fallen) {
+    if (!isFallenVisible(fallen)) {
+        return false;
     }
+
+    createFallenDisplayArea(fallen);
+    return true;
 }
 
 /** *********************************************************************
@@ -879,12 +1397,16 @@ void cairoDrawAllFallenItems(cairo_t *cr) {
         return;
     }
 
-    lockFallenSwapSemaphore();
+    // Open paint grace period.
+    __atomic_fetch_add(&mFallenPaintSequence, 1, __ATOMIC_SEQ_CST);
 
     FallenItem *fallen = mGlobal.FallenFirst;
     while (fallen) {
         if (canFallenConsumeStormItem(fallen)) {
-            cairo_set_source_surface(cr, fallen->surface,
+            cairo_surface_t* surface = __atomic_load_n(
+                &fallen->surface, __ATOMIC_SEQ_CST);
+
+            cairo_set_source_surface(cr, surface,
                 fallen->x, fallen->y - fallen->h);
             paintCairoContextWithAlpha(cr,
                 (0.01 * (100 - Flags.Transparency)));
@@ -892,33 +1414,51 @@ void cairoDrawAllFallenItems(cairo_t *cr) {
             fallen->prevx = fallen->x;
             fallen->prevy = fallen->y - fallen->h + 1;
 
-            fallen->prevw = cairo_image_surface_get_width(
-                fallen->surface);
+            fallen->prevw = cairo_image_surface_get_width(surface);
             fallen->prevh = fallen->h;
         }
 
         fallen = fallen->next;
     }
 
-    unlockFallenSwapSemaphore();
+    // Drop our reference to the last surface before
+    // closing the grace period.
+    cairo_set_source_rgba(cr, 0, 0, 0, 0);
+    __atomic_fetch_add(&mFallenPaintSequence, 1, __ATOMIC_SEQ_CST);
 }
 
 /** *********************************************************************
- ** This method ...
+ ** This method publishes a freshly drawn back surface. The UI
+ ** thread may still be painting the old front surface, so note the
+ ** paint sequence for waitForFallenSurfaceRelease().
  **/
-void swapFallenListItemSurfaces() {
-    lockFallenSwapSemaphore();
-
-    FallenItem* fallen = mGlobal.FallenFirst;
-    while (fallen) {
-        cairo_surface_t* tempSurface = fallen->surface1;
-        fallen->surface1 = fallen->surface;
-        fallen->surface = tempSurface;
+void swapFallenItemSurfaces(FallenItem* fallen) {
+    fallen->surface1 = __atomic_exchange_n(&fallen->surface,
+        fallen->surface1, __ATOMIC_SEQ_CST);
+    fallen->swapPaintSequence = __atomic_load_n(
+        &mFallenPaintSequence, __ATOMIC_SEQ_CST);
+}
 
-        fallen = fallen->next;
+/** *********************************************************************
+ ** This method waits until any UI thread paint that could have
+ ** picked up the back surface (before it was swapped out) is done.
+ **/
+void waitForFallenSurfaceRelease(FallenItem* fallen) {
+    const unsigned int sequence = fallen->swapPaintSequence;
+    if (!(sequence & 1)) {
+        return;
     }
 
-    unlockFallenSwapSemaphore();
+    if (__atomic_load_n(&mFallenPaintSequence,
+            __ATOMIC_ACQUIRE) == sequence) {
+        __atomic_fetch_add(&mFallenLockStats.surfaceReuseWaits,
+            1, __ATOMIC_RELAXED);
+        while (__atomic_load_n(&mFallenPaintSequence,
+                __ATOMIC_ACQUIRE) == sequence) {
+            sched_yield();
+        }
+    }
+    fallen->swapPaintSequence = 0;
 }
 
 /** *********************************************************************
@@ -991,7 +1531,8 @@ void logAllFallenDisplayAreas(FallenItem *list) {
         }
         printf("id:%#10lx ws:%4ld x:%6d y:%6d w:%6d sty:%2d hid:%2d sum:%8d\n",
             fallen->winInfo.window, fallen->winInfo.ws, fallen->x, fallen->y, fallen->w,
-            fallen->winInfo.sticky, fallen->winInfo.hidden, sumact);
+            !!(fallen->winInfo.state & WINDOW_STATE_STICKY),
+            !!(fallen->winInfo.state & WINDOW_STATE_HIDDEN), sumact);
         fallen = fallen->next;
     }
 }
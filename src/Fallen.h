@@ -21,7 +21,7 @@
 #pragma once
 
 #include <pthread.h>
-#include <semaphore.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include <X11/Intrinsic.h>
@@ -30,24 +30,37 @@
 #include <gtk/gtk.h>
 
 #include "plasmastorm.h"
+#include "Prefs.h"
 
 
+// Lock contention counters, see getFallenLockStats().
+typedef struct _FallenLockStats {
+    unsigned long long readAcquisitions;
+    unsigned long long writeAcquisitions;
+    unsigned long long contendedAcquisitions;
+    unsigned long long waitNanoseconds;
+    unsigned long long softLockGiveUps;
+    unsigned long long heightCopyRetries;
+    unsigned long long surfaceReuseWaits;
+} FallenLockStats;
+
 // Semaphore helpers.
 extern void initFallenSemaphores();
 
-// Swap semaphores.
-int lockFallenSwapSemaphore();
-int unlockFallenSwapSemaphore();
-
-// Base semaphores.
+// Base semaphores (reader / writer).
 extern int lockFallenBaseSemaphore();
 extern int softLockFallenBaseSemaphore(
     int maxSoftTries, int* tryCount);
+extern int lockFallenBaseSemaphoreForRead();
+extern int softLockFallenBaseSemaphoreForRead(
+    int maxSoftTries, int* tryCount);
 extern int unlockFallenBaseSemaphore();
 
 #ifndef __GNUC__
     #define lockFallenSemaphore() \
         lockFallenBaseSemaphore()
+    #define lockFallenSemaphoreForRead() \
+        lockFallenBaseSemaphoreForRead()
     #define unlockFallenSemaphore() \
         unlockFallenBaseSemaphore()
     #define softLockFallenSemaphore(maxSoftTries,tryCount) \
@@ -56,6 +69,9 @@ extern int unlockFallenBaseSemaphore();
     #define lockFallenSemaphore() __extension__({ \
         int retval = lockFallenBaseSemaphore(); \
         retval; })
+    #define lockFallenSemaphoreForRead() __extension__({ \
+        int retval = lockFallenBaseSemaphoreForRead(); \
+        retval; })
     #define unlockFallenSemaphore() __extension__({ \
         int retval = unlockFallenBaseSemaphore(); \
         retval; })
@@ -66,13 +82,26 @@ extern int unlockFallenBaseSemaphore();
         retval; })
 #endif
 
+// Height sequence helpers.
+extern void beginFallenHeightUpdate();
+extern void endFallenHeightUpdate();
+void copyFallenHeights(FallenItem*, short int* heights);
+
+// Lock statistics.
+extern void getFallenLockStats(FallenLockStats*);
+extern void logFallenLockStats();
+
 //
 extern void initFallenModule();
+extern void uninitFallenModule();
 
 void* execFallenThread();
+bool waitForFallenThreadEvent(double waitTime, bool wakeOnUpdate);
+extern void signalFallenThread();
+extern void markFallenItemDirty(FallenItem*);
 void updateAllFallenOnThread();
 
-extern void respondToSurfacesSettingsChanges();
+extern void respondToSurfacesSettingsChanges(PrefKey);
 extern void boundMaxDesktopFallenDepth();
 extern void setMaxDesktopFallenDepth();
 
@@ -83,6 +112,9 @@ extern void updateFallenWithWind(FallenItem*, int w, int h);
 extern void updateFallenPartial(FallenItem*, int x, int w);
 extern void updateFallenAtBottom();
 
+extern int getFallenHighestTop();
+extern void invalidateFallenHighestTop();
+
 extern void generateFallenStormItems(FallenItem*,
     int x, int w, float vy);
 
@@ -94,7 +126,9 @@ int do_adjust_deshes();
 //
 void createFallenDisplayArea(FallenItem*);
 extern void cairoDrawAllFallenItems(cairo_t*);
-void eraseFallenAtPixel(FallenItem*, int x);
+void eraseFallenAtColumns(FallenItem*, const int* columns, int count);
+void addFallenDamage(int x, int y, int w, int h);
+extern void flushFallenDamage();
 
 extern void eraseFallenOnDisplay(FallenItem*, int x, int w);
 extern void freeFallenItemMemory(FallenItem*);
@@ -107,9 +141,11 @@ extern void pushFallenItem(FallenItem**, WinInfo*,
 void popFallenItem(FallenItem**);
 
 extern FallenItem* findFallenItemByWindow(FallenItem*, Window);
-extern void drawFallenItem(FallenItem*);
+extern bool isFallenVisible(FallenItem*);
+extern bool drawFallenItem(FallenItem*);
 
-void swapFallenListItemSurfaces();
+void swapFallenItemSurfaces(FallenItem*);
+void waitForFallenSurfaceRelease(FallenItem*);
 
 extern void eraseFallenListItem(Window);
 extern int removeFallenListItem(FallenItem**, Window);
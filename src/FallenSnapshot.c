@@ -0,0 +1,402 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gtk/gtk.h>
+
+#include "ColorCodes.h"
+#include "Fallen.h"
+#include "FallenSnapshot.h"
+#include "Prefs.h"
+#include "utils.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+#define FALLEN_SNAPSHOT_FILE_NAME "plasmastorm-fallen.snapshot"
+
+// Older snapshots belong to some earlier session, not a restart.
+#define FALLEN_SNAPSHOT_MAX_AGE 600
+
+// Windows not seen again by then won't be.
+#define DO_RELEASE_FALLEN_SNAPSHOT_TIME 30.0
+
+// Snapshot data: the mapped file at startup, a heap buffer
+// across a display restart.
+static void* mSnapshotMap = NULL;
+static size_t mSnapshotMapSize = 0;
+static bool mSnapshotIsMapped = false;
+
+static const FallenSnapshotHeader* mSnapshotHeader = NULL;
+static const FallenSnapshotRecord* mSnapshotRecords = NULL;
+
+static bool* mSnapshotRecordUsed = NULL;
+static unsigned int mSnapshotRecordsRemaining = 0;
+
+static guint mSnapshotReleaseTimer = 0;
+
+static int releaseFallenSnapshotEvent();
+
+
+/** *********************************************************************
+ ** This method returns the snapshot file path, or NULL if there's
+ ** no runtime dir to put it in. Caller frees.
+ **/
+static char* getFallenSnapshotFileName() {
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (!runtimeDir || !runtimeDir[0]) {
+        return NULL;
+    }
+
+    const size_t length = strlen(runtimeDir) + 1 +
+        strlen(FALLEN_SNAPSHOT_FILE_NAME) + 1;
+    char* fileName = (char*) malloc(length);
+    snprintf(fileName, length, "%s/%s", runtimeDir,
+        FALLEN_SNAPSHOT_FILE_NAME);
+
+    return fileName;
+}
+
+/** *********************************************************************
+ ** This method lays out all FallenItems in snapshot format, in a
+ ** heap buffer of *size bytes. Caller frees.
+ **/
+static char* buildFallenSnapshot(size_t* size) {
+    lockFallenSemaphoreForRead();
+
+    // Size it.
+    uint32_t recordCount = 0;
+    size_t heightBytes = 0;
+    for (FallenItem* fallen = mGlobal.FallenFirst; fallen;
+        fallen = fallen->next) {
+        recordCount++;
+        heightBytes += 2 * sizeof(short int) * fallen->w;
+    }
+
+    const size_t recordsSize = recordCount *
+        sizeof(FallenSnapshotRecord);
+    const size_t fileSize = sizeof(FallenSnapshotHeader) +
+        recordsSize + heightBytes;
+
+    char* buffer = (char*) calloc(1, fileSize);
+    if (!buffer) {
+        unlockFallenSemaphore();
+        return NULL;
+    }
+
+    // Fill it.
+    FallenSnapshotHeader* header = (FallenSnapshotHeader*) buffer;
+    header->magic = FALLEN_SNAPSHOT_MAGIC;
+    header->version = FALLEN_SNAPSHOT_VERSION;
+    header->headerSize = sizeof(FallenSnapshotHeader);
+    header->recordSize = sizeof(FallenSnapshotRecord);
+    header->recordCount = recordCount;
+    header->fileSize = fileSize;
+    header->createdTime = time(NULL);
+
+    FallenSnapshotRecord* record = (FallenSnapshotRecord*)
+        (buffer + sizeof(FallenSnapshotHeader));
+    size_t heightsOffset = sizeof(FallenSnapshotHeader) + recordsSize;
+
+    for (FallenItem* fallen = mGlobal.FallenFirst; fallen;
+        fallen = fallen->next) {
+        record->window = fallen->winInfo.window;
+        record->x = fallen->x;
+        record->y = fallen->y;
+        record->w = fallen->w;
+        record->h = fallen->h;
+        record->heightsOffset = heightsOffset;
+
+        const size_t arraySize = sizeof(short int) * fallen->w;
+        memcpy(buffer + heightsOffset, fallen->fallenHeight, arraySize);
+        memcpy(buffer + heightsOffset + arraySize,
+            fallen->maxFallenHeight, arraySize);
+
+        heightsOffset += 2 * arraySize;
+        record++;
+    }
+
+    unlockFallenSemaphore();
+
+    *size = fileSize;
+    return buffer;
+}
+
+/** *********************************************************************
+ ** This method writes all FallenItems to the snapshot file, for the
+ ** next run.
+ **/
+void saveFallenSnapshot() {
+    char* fileName = getFallenSnapshotFileName();
+    if (!fileName) {
+        return;
+    }
+
+    size_t fileSize;
+    char* buffer = buildFallenSnapshot(&fileSize);
+    if (!buffer) {
+        free(fileName);
+        return;
+    }
+    const uint32_t recordCount =
+        ((const FallenSnapshotHeader*) buffer)->recordCount;
+
+    // A snapshot is a one restart handoff, not worth a disk sync.
+    const bool isWritten = writeFileAtomically(fileName, buffer,
+        fileSize, ATOMIC_WRITE_NO_SYNC);
+    if (isWritten) {
+        printf("%splasmastorm: Fallen snapshot saved, %u items, "
+            "%zu bytes.%s\n", COLOR_BLUE, recordCount, fileSize,
+            COLOR_NORMAL);
+    } else {
+        printf("%splasmastorm: Fallen snapshot NOT saved: %s.%s\n",
+            COLOR_YELLOW, strerror(errno), COLOR_NORMAL);
+    }
+
+    free(buffer);
+    free(fileName);
+}
+
+/** *********************************************************************
+ ** This method checks a mapped snapshot before anything in it is
+ ** trusted. Every record must lie within the file.
+ **/
+static bool isFallenSnapshotValid(const void* map, size_t mapSize) {
+    if (mapSize < sizeof(FallenSnapshotHeader)) {
+        return false;
+    }
+
+    const FallenSnapshotHeader* header =
+        (const FallenSnapshotHeader*) map;
+    if (header->magic != FALLEN_SNAPSHOT_MAGIC ||
+        header->version != FALLEN_SNAPSHOT_VERSION ||
+        header->headerSize != sizeof(FallenSnapshotHeader) ||
+        header->recordSize != sizeof(FallenSnapshotRecord) ||
+        header->fileSize != mapSize) {
+        return false;
+    }
+
+    const int64_t age = time(NULL) - header->createdTime;
+    if (age < 0 || age > FALLEN_SNAPSHOT_MAX_AGE) {
+        return false;
+    }
+
+    const size_t recordsEnd = sizeof(FallenSnapshotHeader) +
+        (size_t) header->recordCount * sizeof(FallenSnapshotRecord);
+    if (recordsEnd > mapSize) {
+        return false;
+    }
+
+    const FallenSnapshotRecord* records = (const FallenSnapshotRecord*)
+        ((const char*) map + sizeof(FallenSnapshotHeader));
+    for (uint32_t i = 0; i < header->recordCount; i++) {
+        const FallenSnapshotRecord* record = &records[i];
+        if (record->w <= 0 || record->h <= 0 ||
+            record->heightsOffset < recordsEnd ||
+            record->heightsOffset % sizeof(short int)) {
+            return false;
+        }
+        if (record->heightsOffset + 2 * sizeof(short int) *
+            (size_t) record->w > mapSize) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** This method makes data the current snapshot, restored from by
+ ** restoreFallenFromSnapshot() until all records are used or the
+ ** release timer runs out.
+ **/
+static void useFallenSnapshot(void* data, size_t size, bool isMapped) {
+    mSnapshotMap = data;
+    mSnapshotMapSize = size;
+    mSnapshotIsMapped = isMapped;
+    mSnapshotHeader = (const FallenSnapshotHeader*) data;
+    mSnapshotRecords = (const FallenSnapshotRecord*)
+        ((const char*) data + sizeof(FallenSnapshotHeader));
+
+    mSnapshotRecordsRemaining = mSnapshotHeader->recordCount;
+    mSnapshotRecordUsed = (bool*) calloc(
+        mSnapshotHeader->recordCount + 1, sizeof(bool));
+
+    mSnapshotReleaseTimer = addMethodToMainloop(PRIORITY_DEFAULT,
+        DO_RELEASE_FALLEN_SNAPSHOT_TIME, releaseFallenSnapshotEvent);
+}
+
+/** *********************************************************************
+ ** This method maps a snapshot left by a previous run, if any.
+ ** Matching FallenItems are restored as they're pushed, see
+ ** restoreFallenFromSnapshot().
+ **/
+bool loadFallenSnapshot() {
+    releaseFallenSnapshot();
+
+    char* fileName = getFallenSnapshotFileName();
+    if (!fileName) {
+        return false;
+    }
+
+    const int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        free(fileName);
+        return false;
+    }
+
+    // Consumed either way, a stale file
+    // must not outlive this run.
+    unlink(fileName);
+    free(fileName);
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, fileStat.st_size, PROT_READ,
+        MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    if (!isFallenSnapshotValid(map, fileStat.st_size)) {
+        printf("%splasmastorm: Fallen snapshot ignored, "
+            "stale or invalid.%s\n", COLOR_YELLOW, COLOR_NORMAL);
+        munmap(map, fileStat.st_size);
+        return false;
+    }
+
+    useFallenSnapshot(map, fileStat.st_size, true);
+
+    printf("%splasmastorm: Fallen snapshot loaded, %u items.%s\n",
+        COLOR_BLUE, mSnapshotHeader->recordCount, COLOR_NORMAL);
+    return true;
+}
+
+/** *********************************************************************
+ ** This method snapshots all FallenItems in memory, so the list can
+ ** be rebuilt (ie: display restart) keeping fallen for windows that
+ ** survive. No file is involved.
+ **/
+bool captureFallenSnapshot() {
+    releaseFallenSnapshot();
+
+    size_t size;
+    char* buffer = buildFallenSnapshot(&size);
+    if (!buffer) {
+        return false;
+    }
+
+    useFallenSnapshot(buffer, size, false);
+    return true;
+}
+
+/** *********************************************************************
+ ** This method drops the snapshot.
+ **/
+void releaseFallenSnapshot() {
+    if (!mSnapshotMap) {
+        return;
+    }
+
+    if (mSnapshotReleaseTimer) {
+        g_source_remove(mSnapshotReleaseTimer);
+        mSnapshotReleaseTimer = 0;
+    }
+
+    if (mSnapshotIsMapped) {
+        munmap(mSnapshotMap, mSnapshotMapSize);
+    } else {
+        free(mSnapshotMap);
+    }
+    free(mSnapshotRecordUsed);
+
+    mSnapshotMap = NULL;
+    mSnapshotMapSize = 0;
+    mSnapshotIsMapped = false;
+    mSnapshotHeader = NULL;
+    mSnapshotRecords = NULL;
+    mSnapshotRecordUsed = NULL;
+    mSnapshotRecordsRemaining = 0;
+}
+
+/** *********************************************************************
+ ** Mainloop one shot to drop a snapshot no longer matching anything.
+ **/
+static int releaseFallenSnapshotEvent() {
+    mSnapshotReleaseTimer = 0;
+    releaseFallenSnapshot();
+    return FALSE;
+}
+
+/** *********************************************************************
+ ** This method copies saved heights into a new FallenItem if the
+ ** snapshot has a record for the same window, with the same size.
+ ** threads: locking by caller
+ **/
+bool restoreFallenFromSnapshot(FallenItem* fallen) {
+    if (!mSnapshotMap) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < mSnapshotHeader->recordCount; i++) {
+        const FallenSnapshotRecord* record = &mSnapshotRecords[i];
+        if (mSnapshotRecordUsed[i] ||
+            record->window != fallen->winInfo.window ||
+            record->w != fallen->w || record->h != fallen->h) {
+            continue;
+        }
+
+        const short int* savedHeights = (const short int*)
+            ((const char*) mSnapshotMap + record->heightsOffset);
+        const short int* savedMaxHeights = savedHeights + record->w;
+
+        for (int x = 0; x < fallen->w; x++) {
+            fallen->maxFallenHeight[x] = savedMaxHeights[x];
+            fallen->fallenHeight[x] =
+                (savedHeights[x] < 0) ? 0 :
+                (savedHeights[x] > fallen->h) ? fallen->h :
+                savedHeights[x];
+        }
+
+        mSnapshotRecordUsed[i] = true;
+        if (--mSnapshotRecordsRemaining == 0) {
+            releaseFallenSnapshot();
+        }
+        return true;
+    }
+
+    return false;
+}
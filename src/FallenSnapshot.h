@@ -0,0 +1,66 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "plasmastorm.h"
+
+
+/***********************************************************
+ * Snapshot file layout. All values are native endian, the
+ * file never leaves the machine ($XDG_RUNTIME_DIR).
+ *
+ *   FallenSnapshotHeader
+ *   FallenSnapshotRecord[recordCount]
+ *   per record: short fallenHeight[w], short maxFallenHeight[w]
+ */
+#define FALLEN_SNAPSHOT_MAGIC 0x4c465350 // "PSFL"
+#define FALLEN_SNAPSHOT_VERSION 1
+
+typedef struct _FallenSnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t recordCount;
+    uint32_t fileSize;
+    int64_t createdTime;
+} FallenSnapshotHeader;
+
+typedef struct _FallenSnapshotRecord {
+    uint64_t window;
+    int32_t x, y;
+    int32_t w, h;
+    uint32_t heightsOffset;
+    uint32_t reserved;
+} FallenSnapshotRecord;
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void saveFallenSnapshot();
+extern bool loadFallenSnapshot();
+extern bool captureFallenSnapshot();
+extern void releaseFallenSnapshot();
+
+extern bool restoreFallenFromSnapshot(FallenItem*);
@@ -326,8 +326,24 @@ onChangedShowStormItems(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.ShowStormItems = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_SHOW_STORM_ITEMS, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
+}
+
+/** *********************************************************************
+ ** Called by the Qt color picker when the user accepts a color.
+ **/
+void onQPickerColorChosen(const char* callerTag,
+    int red, int green, int blue) {
+    char colorString[8];
+    snprintf(colorString, sizeof(colorString), "#%02x%02x%02x",
+        red & 0xff, green & 0xff, blue & 0xff);
+
+    if (!strcmp(callerTag, "StormItemColor1TAG")) {
+        setStringPref(PREF_STORM_ITEM_COLOR1, colorString);
+    } else if (!strcmp(callerTag, "StormItemColor2TAG")) {
+        setStringPref(PREF_STORM_ITEM_COLOR2, colorString);
+    }
 }
 
 void
@@ -355,7 +371,7 @@ onChangedShapeSizeFactor(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.ShapeSizeFactor = lrint(value);
+    setIntPref(PREF_SHAPE_SIZE_FACTOR, lrint(value));
 }
 
 void
@@ -365,7 +381,7 @@ onChangedStormItemSpeedFactor(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.StormItemSpeedFactor = lrint(value);
+    setIntPref(PREF_STORM_ITEM_SPEED_FACTOR, lrint(value));
 }
 
 void
@@ -375,7 +391,7 @@ onChangedStormItemCountMax(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.StormItemCountMax = lrint(value);
+    setIntPref(PREF_STORM_ITEM_COUNT_MAX, lrint(value));
 }
 
 void
@@ -385,7 +401,7 @@ onChangedStormItemSaturationFactor(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.StormSaturationFactor = lrint(value);
+    setIntPref(PREF_STORM_SATURATION_FACTOR, lrint(value));
 }
 
 void
@@ -394,8 +410,8 @@ onClickedShowStars(GtkWidget* toggleButton) {
         return;
     }
 
-    Flags.ShowStars = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_SHOW_STARS, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 void
@@ -405,7 +421,7 @@ onChangedMaxStarCount(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.MaxStarCount = lrint(value);
+    setIntPref(PREF_MAX_STAR_COUNT, lrint(value));
 }
 
 void
@@ -413,8 +429,8 @@ onChangedShowWind(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.ShowWind = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_SHOW_WIND, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 void
@@ -424,7 +440,7 @@ onChangedWhirlFactor(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.WhirlFactor = lrint(value);
+    setIntPref(PREF_WHIRL_FACTOR, lrint(value));
 }
 
 void
@@ -434,7 +450,7 @@ onChangedWhirlTimer(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.WhirlTimer = lrint(value);
+    setIntPref(PREF_WHIRL_TIMER, lrint(value));
 }
 
 void
@@ -442,8 +458,8 @@ onChangedKeepFallenOnWindows(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.KeepFallenOnWindows = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_KEEP_FALLEN_ON_WINDOWS, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 void
@@ -453,7 +469,7 @@ onChangedMaxWindowFallenDepth(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.MaxWindowFallenDepth = lrint(value);
+    setIntPref(PREF_MAX_WINDOW_FALLEN_DEPTH, lrint(value));
 }
 
 void
@@ -466,7 +482,7 @@ onChangedWindowFallenTopOffset(GtkWidget* w) {
         ((gtk_range_get_type ())))))));
 
     /* Negative Here */
-    Flags.WindowFallenTopOffset = -1 * lrint(value);
+    setIntPref(PREF_WINDOW_FALLEN_TOP_OFFSET, -1 * lrint(value));
 }
 
 void
@@ -474,8 +490,8 @@ onChangedKeepFallenOnBottom(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.KeepFallenOnDesktop = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_KEEP_FALLEN_ON_DESKTOP, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 void
@@ -485,7 +501,7 @@ onChangedMaxDesktopFallenDepth(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.MaxDesktopFallenDepth = lrint(value);
+    setIntPref(PREF_MAX_DESKTOP_FALLEN_DEPTH, lrint(value));
 }
 
 void
@@ -498,7 +514,7 @@ onChangedDesktopFallenTopOffset(GtkWidget* w) {
         ((gtk_range_get_type ())))))));
 
     /* Negative Here */
-    Flags.DesktopFallenTopOffset = -1 * lrint(value);
+    setIntPref(PREF_DESKTOP_FALLEN_TOP_OFFSET, -1 * lrint(value));
 }
 
 void
@@ -506,8 +522,8 @@ onChangedShowBlowoff(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.ShowBlowoff = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_SHOW_BLOWOFF, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 void
@@ -517,7 +533,7 @@ onChangedBlowOffFactor(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.BlowOffFactor = lrint(value);
+    setIntPref(PREF_BLOWOFF_FACTOR, lrint(value));
 }
 
 void
@@ -527,7 +543,7 @@ onChangedCpuLoad(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.CpuLoad = lrint(value);
+    setIntPref(PREF_CPU_LOAD, lrint(value));
 }
 
 void
@@ -537,7 +553,7 @@ onChangedTransparency(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.Transparency = lrint(value);
+    setIntPref(PREF_TRANSPARENCY, lrint(value));
 }
 
 void
@@ -547,7 +563,7 @@ onChangedScale(GtkWidget* slider) {
     }
     const gdouble value = gtk_range_get_value(
         GTK_RANGE(slider));
-    Flags.Scale = lrint(value);
+    setIntPref(PREF_SCALE, lrint(value));
 }
 
 void
@@ -555,8 +571,8 @@ onChangedAllWorkspaces(GtkWidget* toggleButton) {
     if (!mOnUserThread) {
         return;
     }
-    Flags.AllWorkspaces = gtk_toggle_button_get_active(
-        GTK_TOGGLE_BUTTON(toggleButton));
+    setIntPref(PREF_ALL_WORKSPACES, gtk_toggle_button_get_active(
+        GTK_TOGGLE_BUTTON(toggleButton)));
 }
 
 #pragma GCC diagnostic push
@@ -721,12 +737,8 @@ MODULE_EXPORT
 void onSelectedStormShapeBox(GtkComboBoxText *combo,
      __attribute__((unused)) gpointer data) {
 
-    Flags.ComboStormShape = gtk_combo_box_get_active(
-        GTK_COMBO_BOX(combo));
-    if (Flags.ComboStormShape != OldFlags.ComboStormShape) {
-        OldFlags.ComboStormShape = Flags.ComboStormShape;
-        Flags.mHaveFlagsChanged++;
-    }
+    setIntPref(PREF_COMBO_STORM_SHAPE, gtk_combo_box_get_active(
+        GTK_COMBO_BOX(combo)));
 
     // Random Snow has sizing available.
     removeSliderNotAvailStyleClass();
@@ -740,7 +752,7 @@ void onSelectedLanguageBox(GtkComboBoxText *combo,
     __attribute__((unused)) gpointer data) {
 
     int num = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
-    Flags.Language = strdup(lang[num]);
+    setStringPref(PREF_LANGUAGE, lang[num]);
 }
 
 /** *********************************************************************
@@ -756,51 +768,59 @@ static void setVersionNumberForAboutPage() {
  ** Page Default Tab button Helpers.
  **/
 void setDefaultStormSettings() {
-    Flags.ShowStormItems = DefaultFlags.ShowStormItems;
+    setIntPref(PREF_SHOW_STORM_ITEMS, DefaultFlags.ShowStormItems);
 
-    Flags.ComboStormShape = DefaultFlags.ComboStormShape;
+    setIntPref(PREF_COMBO_STORM_SHAPE, DefaultFlags.ComboStormShape);
     gtk_combo_box_set_active(GTK_COMBO_BOX(GTK_COMBO_BOX_TEXT(
         gtk_builder_get_object(builder, "id-ComboStormShape"))),
         Flags.ComboStormShape);
 
-    Flags.StormItemColor1 = DefaultFlags.StormItemColor1;
-    Flags.StormItemColor2 = DefaultFlags.StormItemColor2;
+    setStringPref(PREF_STORM_ITEM_COLOR1, DefaultFlags.StormItemColor1);
+    setStringPref(PREF_STORM_ITEM_COLOR2, DefaultFlags.StormItemColor2);
 
-    Flags.ShapeSizeFactor = DefaultFlags.ShapeSizeFactor;
-    Flags.StormItemSpeedFactor = DefaultFlags.StormItemSpeedFactor;
-    Flags.StormItemCountMax = DefaultFlags.StormItemCountMax;
-    Flags.StormSaturationFactor = DefaultFlags.StormSaturationFactor;
+    setIntPref(PREF_SHAPE_SIZE_FACTOR, DefaultFlags.ShapeSizeFactor);
+    setIntPref(PREF_STORM_ITEM_SPEED_FACTOR,
+        DefaultFlags.StormItemSpeedFactor);
+    setIntPref(PREF_STORM_ITEM_COUNT_MAX, DefaultFlags.StormItemCountMax);
+    setIntPref(PREF_STORM_SATURATION_FACTOR,
+        DefaultFlags.StormSaturationFactor);
 
-    Flags.ShowStars = DefaultFlags.ShowStars;
-    Flags.MaxStarCount = DefaultFlags.MaxStarCount;
+    setIntPref(PREF_SHOW_STARS, DefaultFlags.ShowStars);
+    setIntPref(PREF_MAX_STAR_COUNT, DefaultFlags.MaxStarCount);
 }
 
 void setDefaultWindSettings() {
-    Flags.ShowWind = DefaultFlags.ShowWind;
+    setIntPref(PREF_SHOW_WIND, DefaultFlags.ShowWind);
 
-    Flags.WhirlFactor = DefaultFlags.WhirlFactor;
-    Flags.WhirlTimer = DefaultFlags.WhirlTimer;
+    setIntPref(PREF_WHIRL_FACTOR, DefaultFlags.WhirlFactor);
+    setIntPref(PREF_WHIRL_TIMER, DefaultFlags.WhirlTimer);
 }
 
 void setDefaultFallenSettings() {
-    Flags.KeepFallenOnWindows = DefaultFlags.KeepFallenOnWindows;
-    Flags.MaxWindowFallenDepth = DefaultFlags.MaxWindowFallenDepth;
-    Flags.WindowFallenTopOffset = DefaultFlags.WindowFallenTopOffset;
-
-    Flags.KeepFallenOnDesktop = DefaultFlags.KeepFallenOnDesktop;
-    Flags.MaxDesktopFallenDepth = DefaultFlags.MaxDesktopFallenDepth;
-    Flags.DesktopFallenTopOffset = DefaultFlags.DesktopFallenTopOffset;
-
-    Flags.ShowBlowoff = DefaultFlags.ShowBlowoff;
-    Flags.BlowOffFactor = DefaultFlags.BlowOffFactor;
+    setIntPref(PREF_KEEP_FALLEN_ON_WINDOWS,
+        DefaultFlags.KeepFallenOnWindows);
+    setIntPref(PREF_MAX_WINDOW_FALLEN_DEPTH,
+        DefaultFlags.MaxWindowFallenDepth);
+    setIntPref(PREF_WINDOW_FALLEN_TOP_OFFSET,
+        DefaultFlags.WindowFallenTopOffset);
+
+    setIntPref(PREF_KEEP_FALLEN_ON_DESKTOP,
+        DefaultFlags.KeepFallenOnDesktop);
+    setIntPref(PREF_MAX_DESKTOP_FALLEN_DEPTH,
+        DefaultFlags.MaxDesktopFallenDepth);
+    setIntPref(PREF_DESKTOP_FALLEN_TOP_OFFSET,
+        DefaultFlags.DesktopFallenTopOffset);
+
+    setIntPref(PREF_SHOW_BLOWOFF, DefaultFlags.ShowBlowoff);
+    setIntPref(PREF_BLOWOFF_FACTOR, DefaultFlags.BlowOffFactor);
 }
 
 void setDefaultAdvancedSettings() {
-    Flags.CpuLoad = DefaultFlags.CpuLoad;
-    Flags.Transparency = DefaultFlags.Transparency;
-    Flags.Scale = DefaultFlags.Scale;
+    setIntPref(PREF_CPU_LOAD, DefaultFlags.CpuLoad);
+    setIntPref(PREF_TRANSPARENCY, DefaultFlags.Transparency);
+    setIntPref(PREF_SCALE, DefaultFlags.Scale);
 
-    Flags.AllWorkspaces = DefaultFlags.AllWorkspaces;
+    setIntPref(PREF_ALL_WORKSPACES, DefaultFlags.AllWorkspaces);
 }
 
 /** *********************************************************************
@@ -839,7 +859,10 @@ void setMainWindowSticky(bool stickyFlag) {
  ** CSS related code for MainWindow styling.
  **/
 void applyUICSSTheme() {
+    // Provider is built once, applied to each (re)built window.
     if (mCSSProvider) {
+        applyCSSToWindow(mMainWindow, mCSSProvider);
+        mStyleContext = gtk_widget_get_style_context(mMainWindow);
         return;
     }
 
@@ -999,7 +1022,7 @@ void setLabelText(GtkLabel *label, const gchar *str) {
 
 MODULE_EXPORT
 void onClickedQuitApplication() {
-    Flags.shutdownRequested = true;
+    requestAppShutdown();
 }
 
 /** *********************************************************************
@@ -1032,21 +1055,79 @@ void onClickedSetAdvancedDefaults() {
 }
 
 /** *********************************************************************
- ** ...
+ ** This method tears down the UI built by createMainWindow().
  **/
-void respondToLanguageSettingsChanges() {
-    if (!strcmp(Flags.Language, OldFlags.Language)) {
+static void destroyMainWindow() {
+    if (!mMainWindow) {
         return;
     }
-    free(OldFlags.Language);
-    OldFlags.Language = strdup(Flags.Language);
-    Flags.mHaveFlagsChanged++;
 
-    printf("\nplasmastorm: Restarting due to language change.\n");
+    // Style & label setters must not touch dying widgets.
+    mIsUserThreadRunning = false;
+    mStyleContext = NULL;
+
+    // The glade "destroy" handler quits the app, not this time.
+    g_signal_handlers_disconnect_by_func(G_OBJECT(mMainWindow),
+        G_CALLBACK(onClickedQuitApplication), NULL);
+    gtk_widget_destroy(mMainWindow);
+    mMainWindow = NULL;
+
+    g_object_unref(builder);
+    builder = NULL;
+
+    for (int i = 0; i < 100 && lang[i]; i++) {
+        free(lang[i]);
+        lang[i] = NULL;
+    }
+}
 
+/** *********************************************************************
+ ** This method rebuilds the UI in place, ie: for a new language.
+ ** Window position, size, iconified & sticky state carry over.
+ **/
+void rebuildMainWindow() {
+    if (!mMainWindow) {
+        return;
+    }
+
+    int x, y, width, height;
+    gtk_window_get_position(GTK_WINDOW(mMainWindow), &x, &y);
+    gtk_window_get_size(GTK_WINDOW(mMainWindow), &width, &height);
+
+    GdkWindow* gdkWindow = gtk_widget_get_window(mMainWindow);
+    const bool isIconified = gdkWindow &&
+        (gdk_window_get_state(gdkWindow) & GDK_WINDOW_STATE_ICONIFIED);
+
+    destroyMainWindow();
+    createMainWindow();
+
+    gtk_window_move(GTK_WINDOW(mMainWindow), x, y);
+    gtk_window_resize(GTK_WINDOW(mMainWindow), width, height);
+    if (isIconified) {
+        gtk_window_iconify(GTK_WINDOW(mMainWindow));
+    }
+    setMainWindowSticky(Flags.AllWorkspaces);
+}
+
+/** *********************************************************************
+ ** ...
+ **/
+void respondToLanguageSettingsChanges(
+    __attribute__((unused)) PrefKey key) {
+    // Rebind gettext & rebuild just the UI, the storm keeps going.
+    const double startTime = wallclock();
+
+    // textdomain() in mybindtestdomain() also drops gettext's
+    // cached translations, so _() picks up the new LANGUAGE.
     setLanguageEnvironmentVar();
-    mGlobal.languageChangeRestart = true;
-    Flags.shutdownRequested = true;
+    mGlobal.Language = getLanguageFromEnvStrings();
+    mybindtestdomain();
+
+    rebuildMainWindow();
+
+    printf("\nplasmastorm: Language changed to \"%s\", UI rebuilt "
+        "in %.0f ms.\n", Flags.Language,
+        (wallclock() - startTime) * 1000.0);
 }
 
 /** *********************************************************************
@@ -20,6 +20,8 @@
 */
 #pragma once
 
+#include "Prefs.h"
+
 // Required GTK version.
 #define GTK_MAJOR 3
 #define GTK_MINOR 20
@@ -29,6 +31,7 @@
 extern GtkWidget* getMainWindow();
 
 extern void createMainWindow();
+extern void rebuildMainWindow();
 void init_pixmaps();
 
 extern int isGtkVersionValid();
@@ -36,7 +39,7 @@ extern char *ui_gtk_version();
 extern char *ui_gtk_required();
 
 extern void setLanguageEnvironmentVar();
-extern void respondToLanguageSettingsChanges();
+extern void respondToLanguageSettingsChanges(PrefKey);
 
 extern void addBusyStyleClass();
 extern void removeBusyStyleClass();
@@ -75,3 +78,5 @@ bool startQPickerDialog(char* callerTag,
 int getQPickerRed();
 int getQPickerGreen();
 int getQPickerBlue();
+void onQPickerColorChosen(const char* callerTag,
+    int red, int green, int blue);
@@ -18,12 +18,22 @@
 #-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #-# 
 */
+#include <assert.h>
+#include <errno.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
+#include <glib-unix.h>
+#include <gtk/gtk.h>
+
+#include "ColorCodes.h"
+#include "MainWindow.h"
 #include "Prefs.h"
 #include "plasmastorm.h"
 #include "safeMalloc.h"
@@ -35,12 +45,91 @@
  ** Module globals and consts.
  **/
 FLAGS Flags;
-FLAGS OldFlags;
 FLAGS DefaultFlags;
 
 #define MAX_FILENAME_LENGTH 4096
 char mPrefsFileName[MAX_FILENAME_LENGTH];
 
+// Settings registry, see Prefs.h.
+typedef struct {
+    const char* name;
+    bool isString;
+    size_t offset;
+} PrefInfo;
+
+#define PREF_INT(key, field) \
+    [key] = { #field, false, offsetof(FLAGS, field) }
+#define PREF_STRING(key, field) \
+    [key] = { #field, true, offsetof(FLAGS, field) }
+
+static const PrefInfo mPrefInfo[PREF_COUNT] = {
+    PREF_STRING(PREF_LANGUAGE, Language),
+
+    PREF_INT(PREF_SHOW_STORM_ITEMS, ShowStormItems),
+    PREF_INT(PREF_COMBO_STORM_SHAPE, ComboStormShape),
+    PREF_STRING(PREF_STORM_ITEM_COLOR1, StormItemColor1),
+    PREF_STRING(PREF_STORM_ITEM_COLOR2, StormItemColor2),
+    PREF_INT(PREF_SHAPE_SIZE_FACTOR, ShapeSizeFactor),
+    PREF_INT(PREF_STORM_ITEM_SPEED_FACTOR, StormItemSpeedFactor),
+    PREF_INT(PREF_STORM_ITEM_COUNT_MAX, StormItemCountMax),
+    PREF_INT(PREF_STORM_SATURATION_FACTOR, StormSaturationFactor),
+
+    PREF_INT(PREF_SHOW_STARS, ShowStars),
+    PREF_INT(PREF_MAX_STAR_COUNT, MaxStarCount),
+
+    PREF_INT(PREF_SHOW_WIND, ShowWind),
+    PREF_INT(PREF_WHIRL_FACTOR, WhirlFactor),
+    PREF_INT(PREF_WHIRL_TIMER, WhirlTimer),
+    PREF_INT(PREF_SHOW_BLOWOFF, ShowBlowoff),
+    PREF_INT(PREF_BLOWOFF_FACTOR, BlowOffFactor),
+
+    PREF_INT(PREF_KEEP_FALLEN_ON_WINDOWS, KeepFallenOnWindows),
+    PREF_INT(PREF_MAX_WINDOW_FALLEN_DEPTH, MaxWindowFallenDepth),
+    PREF_INT(PREF_WINDOW_FALLEN_TOP_OFFSET, WindowFallenTopOffset),
+    PREF_INT(PREF_KEEP_FALLEN_ON_DESKTOP, KeepFallenOnDesktop),
+    PREF_INT(PREF_MAX_DESKTOP_FALLEN_DEPTH, MaxDesktopFallenDepth),
+    PREF_INT(PREF_DESKTOP_FALLEN_TOP_OFFSET, DesktopFallenTopOffset),
+
+    PREF_INT(PREF_CPU_LOAD, CpuLoad),
+    PREF_INT(PREF_TRANSPARENCY, Transparency),
+    PREF_INT(PREF_SCALE, Scale),
+    PREF_INT(PREF_ALL_WORKSPACES, AllWorkspaces),
+};
+
+#define MAX_PREF_OBSERVERS 4
+
+static PrefObserver mPrefObservers[PREF_COUNT][MAX_PREF_OBSERVERS];
+static int mPrefObserverCount[PREF_COUNT];
+
+static unsigned int mPrefGeneration[PREF_COUNT];
+static bool mPrefChanged[PREF_COUNT];
+
+static guint mPrefDispatchSource = 0;
+
+// Prefs file writes trail a burst of changes (slider drags) by this.
+#define DO_WRITE_PREFS_DELAY_MSECS 1000
+static guint mPrefWriteSource = 0;
+
+// Prefs file is "Name=value" lines in any order, see parsePrefsText().
+#define PREFS_FILE_BASE_NAME ".plasmastormrc"
+#define PREFS_FILE_HEADER \
+    "# plasmastorm preferences, one Name=value per line.\n"
+
+// Last prefs text written or read, to skip identical rewrites and
+// ignore inotify events for our own writes.
+static char* mPrefsFileText = NULL;
+
+// inotify watch for external edits of the prefs file.
+#define DO_RELOAD_PREFS_DELAY_MSECS 200
+static int mPrefsWatchFd = -1;
+static guint mPrefsWatchSource = 0;
+static guint mPrefsReloadSource = 0;
+static bool mApplyingPrefsFile = false;
+
+static void writePrefsFile(AtomicWriteSync);
+static void startPrefsFileWatch();
+static void stopPrefsFileWatch();
+
 
 /** *********************************************************************
  ** This method ...
@@ -50,17 +139,25 @@ void initPrefsModule(int argc, char* argv[]) {
     setAllPrefsFromDefaultValues();
 
     getPrefsFromLocalStorage();
+    startPrefsFileWatch();
 
     updatePrefsWithRuntimeValues(argc, argv);
 }
 
+/** *********************************************************************
+ ** This method stops the file watch & writes pending changes.
+ **/
+void uninitPrefsModule() {
+    stopPrefsFileWatch();
+    flushPrefsToLocalStorage();
+}
+
 /** *********************************************************************
  ** This method sets Pref default values.
  **/
 void setAllPrefDefaultValues() {
     DefaultFlags.shutdownRequested = 0;
     DefaultFlags.mHideMenu = 0;
-    DefaultFlags.mHaveFlagsChanged = 0;
 
     DefaultFlags.Language = strdup("sys");
 
@@ -103,7 +200,6 @@ void setAllPrefDefaultValues() {
 void setAllPrefsFromDefaultValues() {
     Flags.shutdownRequested = DefaultFlags.shutdownRequested;
     Flags.mHideMenu = DefaultFlags.mHideMenu;
-    Flags.mHaveFlagsChanged = DefaultFlags.mHaveFlagsChanged;
 
     free(Flags.Language);
     Flags.Language = strdup(DefaultFlags.Language);
@@ -145,222 +241,386 @@ void setAllPrefsFromDefaultValues() {
     Flags.ComboStormShape = DefaultFlags.ComboStormShape;
 }
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-result"
 /** *********************************************************************
- ** This method ...
+ ** Settings registry field helpers.
  **/
-void getPrefsFromLocalStorage() {
-    const int MAX_INPUT_STRING_LENGTH = 255;
+static int* getIntPrefField(PrefKey key) {
+    return (int*) ((char*) &Flags + mPrefInfo[key].offset);
+}
 
-    char inputPrefName[MAX_INPUT_STRING_LENGTH];
-    char inputPrefValue[MAX_INPUT_STRING_LENGTH];
+static char** getStringPrefField(PrefKey key) {
+    return (char**) ((char*) &Flags + mPrefInfo[key].offset);
+}
 
-    // If none, initialize the empty file & done.
-    FILE* prefsFile = fopen(getPrefsFileName(), "r");
-    if (prefsFile == NULL) {
-        writePrefstoLocalStorage();
+/** *********************************************************************
+ ** This method runs observers for every key changed since the last
+ ** dispatch, then refreshes the UI widgets from Flags once.
+ **/
+static gboolean dispatchPrefChanges(__attribute__((unused))
+    gpointer data) {
+    mPrefDispatchSource = 0;
+
+    for (int key = 0; key < PREF_COUNT; key++) {
+        if (!mPrefChanged[key]) {
+            continue;
+        }
+        // Cleared first, an observer may change it again.
+        mPrefChanged[key] = false;
+
+        for (int i = 0; i < mPrefObserverCount[key]; i++) {
+            mPrefObservers[key][i]((PrefKey) key);
+        }
+    }
+
+    if (getMainWindow()) {
+        set_buttons();
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/** *********************************************************************
+ ** This method writes the prefs file once a burst of changes settles.
+ **/
+static gboolean writePrefsAfterChanges(__attribute__((unused))
+    gpointer data) {
+    mPrefWriteSource = 0;
+    writePrefstoLocalStorage();
+    return G_SOURCE_REMOVE;
+}
+
+/** *********************************************************************
+ ** This method marks key changed & schedules observers and the
+ ** prefs file write. Use directly when something other than a
+ ** setter changes what a key means, ie: WindowScale for Scale.
+ **/
+void notifyPrefChanged(PrefKey key) {
+    mPrefGeneration[key]++;
+    mPrefChanged[key] = true;
+
+    if (!mPrefDispatchSource) {
+        mPrefDispatchSource = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+            dispatchPrefChanges, NULL, NULL);
+    }
+
+    // A reload from the file needs no write back.
+    if (mApplyingPrefsFile) {
         return;
     }
 
-    // Read & ignore Warning line # 1 & 2.
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
+    if (mPrefWriteSource) {
+        g_source_remove(mPrefWriteSource);
+    }
+    mPrefWriteSource = g_timeout_add(DO_WRITE_PREFS_DELAY_MSECS,
+        writePrefsAfterChanges, NULL);
+}
 
-    // Get Pref name & pref value.
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    inputPrefValue[strlen(inputPrefValue) > 0 ?
-        strlen(inputPrefValue) - 1 : 0] = (char) 0;
+/** *********************************************************************
+ ** Settings registry setters, no-ops when the value is unchanged.
+ **/
+void setIntPref(PrefKey key, int value) {
+    assert(!mPrefInfo[key].isString);
 
-    free(Flags.Language);
-    Flags.Language = strdup(inputPrefValue);
+    int* field = getIntPrefField(key);
+    if (*field == value) {
+        return;
+    }
+    *field = value;
+    notifyPrefChanged(key);
+}
 
-    // Get Pref name & pref value.
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ShowStormItems = atoi(inputPrefValue);
+void setStringPref(PrefKey key, const char* value) {
+    assert(mPrefInfo[key].isString);
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    inputPrefValue[strlen(inputPrefValue) > 0 ?
-        strlen(inputPrefValue) - 1 : 0] = (char) 0;
+    char** field = getStringPrefField(key);
+    if (*field && !strcmp(*field, value)) {
+        return;
+    }
+    free(*field);
+    *field = strdup(value);
+    notifyPrefChanged(key);
+}
 
-    free(Flags.StormItemColor1);
-    Flags.StormItemColor1 = strdup(inputPrefValue);
+/** *********************************************************************
+ ** Settings registry getters.
+ **/
+unsigned int getPrefGeneration(PrefKey key) {
+    return mPrefGeneration[key];
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    inputPrefValue[strlen(inputPrefValue) > 0 ?
-        strlen(inputPrefValue) - 1 : 0] = (char) 0;
+const char* getPrefName(PrefKey key) {
+    return mPrefInfo[key].name;
+}
 
-    free(Flags.StormItemColor2);
-    Flags.StormItemColor2 = strdup(inputPrefValue);
+/** *********************************************************************
+ ** This method subscribes observer to changes of key.
+ **/
+void addPrefObserver(PrefKey key, PrefObserver observer) {
+    if (mPrefObserverCount[key] >= MAX_PREF_OBSERVERS) {
+        printf("plasmastorm: Too many observers for pref %s.\n",
+            getPrefName(key));
+        return;
+    }
+    mPrefObservers[key][mPrefObserverCount[key]++] = observer;
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ShapeSizeFactor = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method writes a still pending prefs file update now,
+ ** ie: at exit.
+ **/
+void flushPrefsToLocalStorage() {
+    if (!mPrefWriteSource) {
+        return;
+    }
+    g_source_remove(mPrefWriteSource);
+    mPrefWriteSource = 0;
+    writePrefsFile(ATOMIC_WRITE_SYNC_DATA_AND_DIRECTORY);
+}
+
+/** *********************************************************************
+ ** This method formats Flags as prefs file text, one Name=value
+ ** line per registry key.
+ **/
+static GString* formatPrefsText() {
+    GString* text = g_string_new(PREFS_FILE_HEADER);
+
+    for (int key = 0; key < PREF_COUNT; key++) {
+        if (mPrefInfo[key].isString) {
+            g_string_append_printf(text, "%s=%s\n",
+                mPrefInfo[key].name, *getStringPrefField(key));
+        } else {
+            g_string_append_printf(text, "%s=%d\n",
+                mPrefInfo[key].name, *getIntPrefField(key));
+        }
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.StormItemSpeedFactor = atoi(inputPrefValue);
+    return text;
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.StormItemCountMax = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method sets one named pref from file text. Unknown names
+ ** are skipped so older builds can read newer files.
+ **/
+static void applyPrefsFileValue(const char* name, const char* value,
+    bool notifyObservers) {
+    int key = 0;
+    while (key < PREF_COUNT && strcmp(mPrefInfo[key].name, name)) {
+        key++;
+    }
+    if (key == PREF_COUNT) {
+        return;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.StormSaturationFactor = atoi(inputPrefValue);
+    if (mPrefInfo[key].isString) {
+        if (notifyObservers) {
+            setStringPref((PrefKey) key, value);
+        } else {
+            char** field = getStringPrefField((PrefKey) key);
+            free(*field);
+            *field = strdup(value);
+        }
+        return;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ShowStars = atoi(inputPrefValue);
+    if (notifyObservers) {
+        setIntPref((PrefKey) key, atoi(value));
+    } else {
+        *getIntPrefField((PrefKey) key) = atoi(value);
+    }
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.MaxStarCount = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method parses prefs file text in place. Lines may come in
+ ** any order, missing prefs keep their current value.
+ **
+ ** Files from older releases hold each name & value on separate
+ ** lines under a two line banner. A line without '=' is taken as
+ ** such a name, & the line after it as its value.
+ **/
+static void parsePrefsText(char* text, bool notifyObservers) {
+    char* legacyName = NULL;
+
+    char* line = text;
+    while (line && *line) {
+        char* nextLine = strchr(line, '\n');
+        if (nextLine) {
+            *nextLine++ = '\0';
+        }
+        line[strcspn(line, "\r")] = '\0';
+
+        char* equals = strchr(line, '=');
+        if (legacyName) {
+            applyPrefsFileValue(legacyName, line, notifyObservers);
+            legacyName = NULL;
+        } else if (*line == '#' || *line == '\0') {
+            // Comment or blank line.
+        } else if (equals) {
+            *equals = '\0';
+            applyPrefsFileValue(g_strstrip(line),
+                g_strstrip(equals + 1), notifyObservers);
+        } else {
+            legacyName = line;
+        }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ShowWind = atoi(inputPrefValue);
+        line = nextLine;
+    }
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.WhirlFactor = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method ...
+ **/
+void getPrefsFromLocalStorage() {
+    // If none, initialize the empty file & done.
+    gchar* text = NULL;
+    if (!g_file_get_contents(getPrefsFileName(), &text, NULL, NULL)) {
+        writePrefstoLocalStorage();
+        return;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.WhirlTimer = atoi(inputPrefValue);
+    g_free(mPrefsFileText);
+    mPrefsFileText = g_strdup(text);
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ShowBlowoff = atoi(inputPrefValue);
+    parsePrefsText(text, false);
+    g_free(text);
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.BlowOffFactor = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method writes Flags to the prefs file. Text identical to the
+ ** last written or read is skipped. Debounced writes sync file data
+ ** only, the last one at exit also syncs the directory entry.
+ **/
+static void writePrefsFile(AtomicWriteSync syncPolicy) {
+    GString* text = formatPrefsText();
+    if (mPrefsFileText && !strcmp(mPrefsFileText, text->str)) {
+        g_string_free(text, TRUE);
+        return;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.KeepFallenOnWindows = atoi(inputPrefValue);
+    if (writeFileAtomically(getPrefsFileName(), text->str, text->len,
+        syncPolicy)) {
+        g_free(mPrefsFileText);
+        mPrefsFileText = g_string_free(text, FALSE);
+    } else {
+        printf("%splasmastorm: Prefs NOT saved: %s.%s\n",
+            COLOR_YELLOW, strerror(errno), COLOR_NORMAL);
+        g_string_free(text, TRUE);
+    }
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.MaxWindowFallenDepth = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method ...
+ **/
+void writePrefstoLocalStorage() {
+    writePrefsFile(ATOMIC_WRITE_SYNC_DATA);
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.WindowFallenTopOffset = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method applies an external edit of the prefs file through
+ ** the setters, so observers see it like a UI change.
+ **/
+static gboolean reloadPrefsAfterFileChange(__attribute__((unused))
+    gpointer data) {
+    mPrefsReloadSource = 0;
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.KeepFallenOnDesktop = atoi(inputPrefValue);
+    gchar* text = NULL;
+    if (!g_file_get_contents(getPrefsFileName(), &text, NULL, NULL)) {
+        return G_SOURCE_REMOVE;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.MaxDesktopFallenDepth = atoi(inputPrefValue);
+    // Our own writes come back here too.
+    if (mPrefsFileText && !strcmp(mPrefsFileText, text)) {
+        g_free(text);
+        return G_SOURCE_REMOVE;
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.DesktopFallenTopOffset = atoi(inputPrefValue);
+    printf("%splasmastorm: Prefs file changed, reloading.%s\n",
+        COLOR_BLUE, COLOR_NORMAL);
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.CpuLoad = atoi(inputPrefValue);
+    g_free(mPrefsFileText);
+    mPrefsFileText = g_strdup(text);
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.Transparency = atoi(inputPrefValue);
+    mApplyingPrefsFile = true;
+    parsePrefsText(text, true);
+    mApplyingPrefsFile = false;
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.Scale = atoi(inputPrefValue);
+    g_free(text);
+    return G_SOURCE_REMOVE;
+}
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.AllWorkspaces = atoi(inputPrefValue);
+/** *********************************************************************
+ ** This method drains inotify events & schedules a reload when the
+ ** prefs file was among them. Editors often save in several steps,
+ ** so the reload trails the last event.
+ **/
+static gboolean onPrefsWatchEvent(gint fd,
+    __attribute__((unused)) GIOCondition condition,
+    __attribute__((unused)) gpointer data) {
+    char buffer[4096] __attribute__((aligned(
+        __alignof__(struct inotify_event))));
+
+    bool isPrefsFileEvent = false;
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* next = buffer; next < buffer + length; ) {
+            const struct inotify_event* event =
+                (const struct inotify_event*) next;
+            if (event->len &&
+                !strcmp(event->name, PREFS_FILE_BASE_NAME)) {
+                isPrefsFileEvent = true;
+            }
+            next += sizeof(struct inotify_event) + event->len;
+        }
+    }
 
-    fgets(inputPrefName, MAX_INPUT_STRING_LENGTH, prefsFile);
-    fgets(inputPrefValue, MAX_INPUT_STRING_LENGTH, prefsFile);
-    Flags.ComboStormShape = atoi(inputPrefValue);
+    if (isPrefsFileEvent) {
+        if (mPrefsReloadSource) {
+            g_source_remove(mPrefsReloadSource);
+        }
+        mPrefsReloadSource = g_timeout_add(DO_RELOAD_PREFS_DELAY_MSECS,
+            reloadPrefsAfterFileChange, NULL);
+    }
 
-    // Close file & exit.
-    fclose(prefsFile);
+    return G_SOURCE_CONTINUE;
 }
-#pragma GCC diagnostic pop
 
 /** *********************************************************************
- ** This method ...
+ ** This method watches the prefs file for external edits. The
+ ** directory is watched, as rename() swaps the file's inode.
  **/
-void writePrefstoLocalStorage() {
-    FILE* prefsFile = fopen(getPrefsFileName(), "w");
-    if (prefsFile == NULL) {
+static void startPrefsFileWatch() {
+    mPrefsWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mPrefsWatchFd < 0) {
         return;
     }
 
-    fprintf(prefsFile, "%s  %s\n", "GENERATED FILE - ", "Do Not Modify");
-    fprintf(prefsFile, "%s  %s\n", "**************   ", "*************");
-
-    fprintf(prefsFile, "%s\n%s\n", "Language",
-        Flags.Language);
-
-    fprintf(prefsFile, "%s\n%d\n", "ShowStormItems",
-        Flags.ShowStormItems);
-    fprintf(prefsFile, "%s\n%s\n", "StormItemColor1",
-        Flags.StormItemColor1);
-    fprintf(prefsFile, "%s\n%s\n", "StormItemColor2",
-        Flags.StormItemColor2);
-    fprintf(prefsFile, "%s\n%d\n", "ShapeSizeFactor",
-        Flags.ShapeSizeFactor);
-    fprintf(prefsFile, "%s\n%d\n", "StormItemSpeedFactor",
-        Flags.StormItemSpeedFactor);
-    fprintf(prefsFile, "%s\n%d\n", "StormItemCountMax",
-        Flags.StormItemCountMax);
-    fprintf(prefsFile, "%s\n%d\n", "StormSaturationFactor",
-        Flags.StormSaturationFactor);
-
-    fprintf(prefsFile, "%s\n%d\n", "ShowStars",
-        Flags.ShowStars);
-    fprintf(prefsFile, "%s\n%d\n", "MaxStarCount",
-        Flags.MaxStarCount);
-
-    fprintf(prefsFile, "%s\n%d\n", "ShowWind",
-        Flags.ShowWind);
-    fprintf(prefsFile, "%s\n%d\n", "WhirlFactor",
-        Flags.WhirlFactor);
-    fprintf(prefsFile, "%s\n%d\n", "WhirlTimer",
-        Flags.WhirlTimer);
-    fprintf(prefsFile, "%s\n%d\n", "ShowBlowoff",
-        Flags.ShowBlowoff);
-    fprintf(prefsFile, "%s\n%d\n", "BlowOffFactor",
-        Flags.BlowOffFactor);
-
-    fprintf(prefsFile, "%s\n%d\n", "KeepFallenOnWindows",
-        Flags.KeepFallenOnWindows);
-    fprintf(prefsFile, "%s\n%d\n", "MaxWindowFallenDepth",
-        Flags.MaxWindowFallenDepth);
-    fprintf(prefsFile, "%s\n%d\n", "WindowFallenTopOffset",
-        Flags.WindowFallenTopOffset);
-    fprintf(prefsFile, "%s\n%d\n", "KeepFallenOnDesktop",
-        Flags.KeepFallenOnDesktop);
-    fprintf(prefsFile, "%s\n%d\n", "MaxDesktopFallenDepth",
-        Flags.MaxDesktopFallenDepth);
-    fprintf(prefsFile, "%s\n%d\n", "DesktopFallenTopOffset",
-        Flags.DesktopFallenTopOffset);
-
-    fprintf(prefsFile, "%s\n%d\n", "CpuLoad",
-        Flags.CpuLoad);
-    fprintf(prefsFile, "%s\n%d\n", "Transparency",
-        Flags.Transparency);
-    fprintf(prefsFile, "%s\n%d\n", "Scale",
-        Flags.Scale);
-    fprintf(prefsFile, "%s\n%d\n", "AllWorkspaces",
-        Flags.AllWorkspaces);
-    fprintf(prefsFile, "%s\n%d\n", "ComboStormShape",
-        Flags.ComboStormShape);
-
-    fclose(prefsFile);
+    gchar* dirName = g_path_get_dirname(getPrefsFileName());
+    const int watch = inotify_add_watch(mPrefsWatchFd, dirName,
+        IN_CLOSE_WRITE | IN_MOVED_TO);
+    g_free(dirName);
+
+    if (watch < 0) {
+        close(mPrefsWatchFd);
+        mPrefsWatchFd = -1;
+        return;
+    }
+
+    mPrefsWatchSource = g_unix_fd_add(mPrefsWatchFd, G_IO_IN,
+        onPrefsWatchEvent, NULL);
+}
+
+static void stopPrefsFileWatch() {
+    if (mPrefsReloadSource) {
+        g_source_remove(mPrefsReloadSource);
+        mPrefsReloadSource = 0;
+    }
+    if (mPrefsWatchSource) {
+        g_source_remove(mPrefsWatchSource);
+        mPrefsWatchSource = 0;
+    }
+    if (mPrefsWatchFd >= 0) {
+        close(mPrefsWatchFd);
+        mPrefsWatchFd = -1;
+    }
 }
 
 /** *********************************************************************
@@ -381,7 +641,7 @@ char* getPrefsFileName() {
     mPrefsFileName[0] = '\0';
 
     strcat(mPrefsFileName, getenv("HOME"));
-    strcat(mPrefsFileName, "/.plasmastormrc");
+    strcat(mPrefsFileName, "/" PREFS_FILE_BASE_NAME);
 
     return mPrefsFileName;
 }
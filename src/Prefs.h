@@ -29,7 +29,6 @@ typedef struct {
 
     char* Language;
     int mHideMenu;
-    int mHaveFlagsChanged;
     bool shutdownRequested;
 
     int ShowStormItems;
@@ -65,11 +64,66 @@ typedef struct {
 } FLAGS;
 
 extern FLAGS Flags;
-extern FLAGS OldFlags;
 extern FLAGS DefaultFlags;
 
 
+/***********************************************************
+ * Settings registry. Each user setting in FLAGS has a key.
+ * Setters bump the key's change generation, then its
+ * observers run from the mainloop right after, once per
+ * burst of changes.
+ */
+typedef enum {
+    PREF_LANGUAGE,
+
+    PREF_SHOW_STORM_ITEMS,
+    PREF_COMBO_STORM_SHAPE,
+    PREF_STORM_ITEM_COLOR1,
+    PREF_STORM_ITEM_COLOR2,
+    PREF_SHAPE_SIZE_FACTOR,
+    PREF_STORM_ITEM_SPEED_FACTOR,
+    PREF_STORM_ITEM_COUNT_MAX,
+    PREF_STORM_SATURATION_FACTOR,
+
+    PREF_SHOW_STARS,
+    PREF_MAX_STAR_COUNT,
+
+    PREF_SHOW_WIND,
+    PREF_WHIRL_FACTOR,
+    PREF_WHIRL_TIMER,
+    PREF_SHOW_BLOWOFF,
+    PREF_BLOWOFF_FACTOR,
+
+    PREF_KEEP_FALLEN_ON_WINDOWS,
+    PREF_MAX_WINDOW_FALLEN_DEPTH,
+    PREF_WINDOW_FALLEN_TOP_OFFSET,
+    PREF_KEEP_FALLEN_ON_DESKTOP,
+    PREF_MAX_DESKTOP_FALLEN_DEPTH,
+    PREF_DESKTOP_FALLEN_TOP_OFFSET,
+
+    PREF_CPU_LOAD,
+    PREF_TRANSPARENCY,
+    PREF_SCALE,
+    PREF_ALL_WORKSPACES,
+
+    PREF_COUNT
+} PrefKey;
+
+typedef void (*PrefObserver)(PrefKey);
+
+extern void setIntPref(PrefKey, int value);
+extern void setStringPref(PrefKey, const char* value);
+extern void notifyPrefChanged(PrefKey);
+
+extern unsigned int getPrefGeneration(PrefKey);
+extern const char* getPrefName(PrefKey);
+
+extern void addPrefObserver(PrefKey, PrefObserver);
+extern void flushPrefsToLocalStorage();
+
+
 extern void initPrefsModule(int argc, char* argv[]);
+extern void uninitPrefsModule();
 
 void setAllPrefDefaultValues();
 void setAllPrefsFromDefaultValues();
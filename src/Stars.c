@@ -33,6 +33,10 @@
 #include "utils.h"
 #include "Windows.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_STARS
+#include "x11Stats.h"
+
 
 /** *********************************************************************
  ** Module globals and consts.
@@ -50,6 +54,23 @@ char* mStarColorArray[STARANIMATIONS] =
 int mNumberOfStars;
 StarCoordinate* mStarCoordinates = NULL;
 
+// Stars never move, so they're all pre-rendered into one layer the
+// size of their bounding box & composited in one paint per frame.
+// A twinkle patches just the changed stars, see patchStarsLayer().
+static cairo_surface_t* mStarsLayerSurface = NULL;
+static cairo_surface_type_t mStarsLayerTargetType;
+
+static int mStarsLayerX = 0;
+static int mStarsLayerY = 0;
+static int mStarsLayerWidth = 0;
+static int mStarsLayerHeight = 0;
+
+static bool mStarsLayerNeedsRebuild = true;
+static bool mStarsLayerHasChanges = false;
+
+// Largest star surface, every star fits a square this size.
+static int mStarMaxSize = 0;
+
 int mPreviousAppScale = 100;
 
 
@@ -57,6 +78,7 @@ int mPreviousAppScale = 100;
  ** This method initializes the Stars module.
  **/
 void initStarsModule() {
+    hasAppScaleChangedFrom(&mPreviousAppScale);
     initStarsModuleArrays();
 
     // Clear and set mStarSurfaceArray.
@@ -68,6 +90,10 @@ void initStarsModule() {
 
     addMethodToMainloop(PRIORITY_DEFAULT,
         time_ustar, updateStarsFrame);
+
+    addPrefObserver(PREF_SHOW_STARS, updateStarsUserSettings);
+    addPrefObserver(PREF_MAX_STAR_COUNT, updateStarsUserSettings);
+    addPrefObserver(PREF_SCALE, updateStarsUserSettings);
 }
 
 /** *********************************************************************
@@ -87,21 +113,20 @@ void initStarsModuleArrays() {
         star->x = randint(mGlobal.StormWindowWidth);
         star->y = randint(mGlobal.StormWindowHeight / 4);
         star->color = randint(STARANIMATIONS);
+        star->isColorChanged = false;
     }
+
+    mStarsLayerNeedsRebuild = true;
 }
 
 /** *********************************************************************
  ** This method inits cairo surfaces.
  **/
 void initStarsModuleSurfaces() {
-    // Clear and set mStarSurfaceArray.
-    for (int i = 0; i < STARANIMATIONS; i++) {
-        mStarSurfaceArray[i] = NULL;
-    }
-
     const float sizeBase = STAR_SIZE * LOCAL_SCALE *
         mGlobal.WindowScale * Flags.Scale * 0.01;
 
+    mStarMaxSize = 0;
     for (int i = 0; i < STARANIMATIONS; i++) {
         float size = sizeBase * 0.2 * (1 + 4 * drand48());
         if (size < 3) {
@@ -139,25 +164,33 @@ void initStarsModuleSurfaces() {
 
         cairo_stroke(cr);
         cairo_destroy(cr);
+
+        const int width = cairo_image_surface_get_width(
+            mStarSurfaceArray[i]);
+        if (width > mStarMaxSize) {
+            mStarMaxSize = width;
+        }
     }
+
+    mStarsLayerNeedsRebuild = true;
 }
 
 /** *********************************************************************
  ** This method erases a single Stars
  ** frame from drawCairoWindowInternal().
+ **
+ ** One clear of the layer bounds replaces a clear per star. Bounds
+ ** are still those of the last drawn layer here, so a rebuild at
+ ** the next draw can't leave old stars behind.
  **/
 void eraseStarsFrame() {
-    if (!Flags.ShowStars) {
+    if (!Flags.ShowStars || !mStarsLayerSurface) {
         return;
     }
 
-    for (int i = 0; i < mNumberOfStars; i++) {
-        const StarCoordinate* star = &mStarCoordinates[i];
-
-        sanelyCheckAndClearDisplayArea(mGlobal.display,
-            mGlobal.StormWindow, star->x, star->y,
-            STAR_SIZE, STAR_SIZE, false);
-    }
+    sanelyCheckAndClearDisplayArea(mGlobal.display,
+        mGlobal.StormWindow, mStarsLayerX, mStarsLayerY,
+        mStarsLayerWidth, mStarsLayerHeight, false);
 }
 
 /** *********************************************************************
@@ -174,7 +207,14 @@ int updateStarsFrame() {
 
     for (int i = 0; i < mNumberOfStars; i++) {
         if (drand48() > 0.8) {
-            mStarCoordinates[i].color = randint(STARANIMATIONS);
+            StarCoordinate* star = &mStarCoordinates[i];
+
+            const int color = randint(STARANIMATIONS);
+            if (color != star->color) {
+                star->color = color;
+                star->isColorChanged = true;
+                mStarsLayerHasChanges = true;
+            }
         }
     }
 
@@ -182,51 +222,153 @@ int updateStarsFrame() {
 }
 
 /** *********************************************************************
- ** This method draws a single Stars
- ** frame from drawCairoWindowInternal().
+ ** This method paints every star overlapping the layer context's
+ ** clip into the layer.
  **/
-void drawStarsFrame(cairo_t *cr) {
-    if (!Flags.ShowStars) {
+static void drawStarsIntoLayer(cairo_t* layerCr) {
+    double x1, y1, x2, y2;
+    cairo_clip_extents(layerCr, &x1, &y1, &x2, &y2);
+
+    for (int i = 0; i < mNumberOfStars; i++) {
+        StarCoordinate* star = &mStarCoordinates[i];
+        star->isColorChanged = false;
+
+        if (star->x >= x2 || star->x + mStarMaxSize <= x1 ||
+            star->y >= y2 || star->y + mStarMaxSize <= y1) {
+            continue;
+        }
+
+        cairo_set_source_surface(layerCr,
+            mStarSurfaceArray[star->color], star->x, star->y);
+        cairo_paint(layerCr);
+    }
+}
+
+/** *********************************************************************
+ ** This method recreates the layer for the current stars. It's made
+ ** similar to the StormWindow target, so on X11 it lives server side
+ ** & the per frame composite sends no pixels.
+ **/
+static void rebuildStarsLayer(cairo_t* cr) {
+    mStarsLayerNeedsRebuild = false;
+    mStarsLayerHasChanges = false;
+
+    if (mStarsLayerSurface) {
+        cairo_surface_destroy(mStarsLayerSurface);
+        mStarsLayerSurface = NULL;
+    }
+    if (mNumberOfStars <= 0) {
         return;
     }
 
-    cairo_save(cr);
+    int minX = mStarCoordinates[0].x;
+    int minY = mStarCoordinates[0].y;
+    int maxX = minX;
+    int maxY = minY;
+    for (int i = 1; i < mNumberOfStars; i++) {
+        const StarCoordinate* star = &mStarCoordinates[i];
+        minX = MIN(minX, star->x);
+        minY = MIN(minY, star->y);
+        maxX = MAX(maxX, star->x);
+        maxY = MAX(maxY, star->y);
+    }
 
-    cairo_set_line_width(cr, 1);
-    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+    mStarsLayerX = minX;
+    mStarsLayerY = minY;
+    mStarsLayerWidth = maxX - minX + mStarMaxSize;
+    mStarsLayerHeight = maxY - minY + mStarMaxSize;
+
+    cairo_surface_t* target = cairo_get_target(cr);
+    mStarsLayerTargetType = cairo_surface_get_type(target);
+    mStarsLayerSurface = cairo_surface_create_similar(target,
+        CAIRO_CONTENT_COLOR_ALPHA, mStarsLayerWidth, mStarsLayerHeight);
+
+    cairo_t* layerCr = cairo_create(mStarsLayerSurface);
+    cairo_translate(layerCr, -mStarsLayerX, -mStarsLayerY);
+    drawStarsIntoLayer(layerCr);
+    cairo_destroy(layerCr);
+}
+
+/** *********************************************************************
+ ** This method redraws twinkled stars into the layer. Only their
+ ** squares are cleared & repainted, along with any neighbour star
+ ** overlapping them.
+ **/
+static void patchStarsLayer() {
+    mStarsLayerHasChanges = false;
+
+    cairo_t* layerCr = cairo_create(mStarsLayerSurface);
+    cairo_translate(layerCr, -mStarsLayerX, -mStarsLayerY);
 
     for (int i = 0; i < mNumberOfStars; i++) {
         const StarCoordinate* star = &mStarCoordinates[i];
-
-        cairo_set_source_surface(cr, mStarSurfaceArray[star->color],
-            star->x, star->y);
-        paintCairoContextWithAlpha(cr, (0.01 * (100 -
-            Flags.Transparency)));
+        if (star->isColorChanged) {
+            cairo_rectangle(layerCr, star->x, star->y,
+                mStarMaxSize, mStarMaxSize);
+        }
     }
+    cairo_clip(layerCr);
 
-    cairo_restore(cr);
+    cairo_set_operator(layerCr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(layerCr);
+    cairo_set_operator(layerCr, CAIRO_OPERATOR_OVER);
+
+    drawStarsIntoLayer(layerCr);
+    cairo_destroy(layerCr);
 }
 
 /** *********************************************************************
- ** This method updates the Stars module with
- ** refreshed user settings.
+ ** This method draws a single Stars
+ ** frame from drawCairoWindowInternal().
  **/
-void updateStarsUserSettings() {
-    if (Flags.ShowStars != OldFlags.ShowStars) {
-        OldFlags.ShowStars = Flags.ShowStars;
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
+void drawStarsFrame(cairo_t *cr) {
+    if (!Flags.ShowStars) {
+        return;
+    }
+
+    if (mStarsLayerNeedsRebuild || (mStarsLayerSurface &&
+        cairo_surface_get_type(cairo_get_target(cr)) !=
+            mStarsLayerTargetType)) {
+        rebuildStarsLayer(cr);
+    } else if (mStarsLayerHasChanges && mStarsLayerSurface) {
+        patchStarsLayer();
     }
 
-    if (Flags.MaxStarCount != OldFlags.MaxStarCount) {
-        OldFlags.MaxStarCount = Flags.MaxStarCount;
-        initStarsModuleArrays();
-        clearStormWindow();
-        Flags.mHaveFlagsChanged++;
+    if (!mStarsLayerSurface) {
+        return;
     }
 
-    if (hasAppScaleChangedFrom(&mPreviousAppScale)) {
-        initStarsModuleSurfaces();
-        initStarsModuleArrays();
+    cairo_save(cr);
+    cairo_set_source_surface(cr, mStarsLayerSurface,
+        mStarsLayerX, mStarsLayerY);
+    paintCairoContextWithAlpha(cr, (0.01 * (100 -
+        Flags.Transparency)));
+    cairo_restore(cr);
+}
+
+/** *********************************************************************
+ ** This method updates the Stars module with
+ ** refreshed user settings.
+ **/
+void updateStarsUserSettings(PrefKey key) {
+    switch (key) {
+        case PREF_SHOW_STARS:
+            clearStormWindow();
+            break;
+
+        case PREF_MAX_STAR_COUNT:
+            initStarsModuleArrays();
+            clearStormWindow();
+            break;
+
+        case PREF_SCALE:
+            if (hasAppScaleChangedFrom(&mPreviousAppScale)) {
+                initStarsModuleSurfaces();
+                initStarsModuleArrays();
+            }
+            break;
+
+        default:
+            break;
     }
 }
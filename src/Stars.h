@@ -22,6 +22,8 @@
 
 #include <gtk/gtk.h>
 
+#include "Prefs.h"
+
 
 /***********************************************************
  * Module Method stubs.
@@ -35,4 +37,4 @@ int updateStarsFrame();
 void eraseStarsFrame();
 void drawStarsFrame(cairo_t *cr);
 
-void updateStarsUserSettings();
+void updateStarsUserSettings(PrefKey);
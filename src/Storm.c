@@ -25,40 +25,33 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <gtk/gtk.h>
 
 #include "Blowoff.h"
 #include "ClockHelper.h"
+#include "columnTreeHelper.h"
 #include "Fallen.h"
 #include "hashTableHelper.h"
+#include "loadmeasure.h"
 #include "MainWindow.h"
 #include "pixmaps.h"
 #include "plasmastorm.h"
 #include "Prefs.h"
 #include "safeMalloc.h"
 #include "Storm.h"
+#include "StormShapeCache.h"
 #include "utils.h"
+#include "versionHelper.h"
 #include "Wind.h"
+#include "WindField.h"
 #include "Windows.h"
 #include "xpmHelper.h"
 
-
-/***********************************************************
- * Externally provided to this Module.
- */
-
-// Color Picker methods.
-bool isQPickerActive();
-char* getQPickerCallerName();
-bool isQPickerVisible();
-bool isQPickerTerminated();
-
-int getQPickerRed();
-int getQPickerBlue();
-int getQPickerGreen();
-
-void endQPickerDialog();
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_STORM
+#include "x11Stats.h"
 
 
 /** *********************************************************************
@@ -80,10 +73,18 @@ const float mWindSpeedMaxArray[] =
 static int mPreviousAppScale = 100;
 
 int mResourcesShapeCount = 0;
+static uint64_t mResourcesShapesHash = 0;
+static uint64_t getResourcesShapesHash();
 
 static int mStormItemsShapeCount = 0;
 static char*** mStormItemShapes = NULL;
 
+// Random shapes are seeded per shape from this, so they're the
+// same every run for a given size & the shape cache can hit.
+#define RANDOM_STORMITEM_SEED 0x706c61736d61ULL
+
+// Per shape color, assigned in order before surface jobs run.
+static const char** mStormItemShapeColors = NULL;
 
 static StormItemSurface* mStormItemSurfaceList = NULL;
 
@@ -99,6 +100,19 @@ static float mStormItemsSpeedFactor;
 int mStormItemColorToggle = 0;
 GdkRGBA mStormItemColor;
 
+// StormItem pool. Items are carved from blocks & recycled,
+// never freed, so bulk creation is one allocation at most.
+#define STORMITEM_POOL_BLOCK_SIZE 256
+
+static StormItem** mFreeStormItems = NULL;
+static int mFreeStormItemsCount = 0;
+static int mAllocatedStormItemsCount = 0;
+
+// All items are updated from one shared tick. It walks a copy of the
+// itemset, as items leave the set during their own update.
+static StormItem** mUpdateStormItems = NULL;
+static unsigned int mUpdateStormItemsSize = 0;
+static guint mUpdateStormItemsSource = 0;
 
 /** *********************************************************************
  ** This method initializes the storm module.
@@ -106,8 +120,12 @@ GdkRGBA mStormItemColor;
 void initStormModule() {
     // Create ShapesList from Resources & new Random Storm Shapes.
     mResourcesShapeCount = getResourcesShapeCount();
+    mResourcesShapesHash = getResourcesShapesHash();
+    mStormItemsShapeCount = mResourcesShapeCount +
+        RANDOM_STORMITEM_COUNT;
 
-    createCombinedShapesList();
+    // Shapes are built on demand, a cache hit never needs them.
+    hasAppScaleChangedFrom(&mPreviousAppScale);
     createCombinedShapeSurfacesList();
     updateStormShapesAttributes();
 
@@ -116,6 +134,16 @@ void initStormModule() {
 
     addMethodToMainloop(PRIORITY_DEFAULT, DO_CREATE_STORMITEM_EVENT,
         doCreateStormShapeEvent);
+
+    addPrefObserver(PREF_SHOW_STORM_ITEMS, respondToStormsSettingsChanges);
+    addPrefObserver(PREF_SHAPE_SIZE_FACTOR, respondToStormsSettingsChanges);
+    addPrefObserver(PREF_STORM_ITEM_SPEED_FACTOR,
+        respondToStormsSettingsChanges);
+    addPrefObserver(PREF_STORM_SATURATION_FACTOR,
+        respondToStormsSettingsChanges);
+    addPrefObserver(PREF_STORM_ITEM_COLOR1, respondToStormsSettingsChanges);
+    addPrefObserver(PREF_STORM_ITEM_COLOR2, respondToStormsSettingsChanges);
+    addPrefObserver(PREF_SCALE, respondToStormsSettingsChanges);
 }
 
 /** *********************************************************************
@@ -131,6 +159,99 @@ int getResourcesShapeCount() {
     return count;
 }
 
+/** *********************************************************************
+ ** Helper returns an FNV-1a hash of every resource xpm line, so a
+ ** changed pixmap misses the shape cache.
+ **/
+static uint64_t getResourcesShapesHash() {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (int i = 0; i < mResourcesShapeCount; i++) {
+        XPM_TYPE** xpm = mResourcesShapes[i];
+
+        int width = 0, height = 0, colorCount = 0;
+        sscanf((const char*) xpm[0], "%d %d %d",
+            &width, &height, &colorCount);
+
+        const int lineCount = 1 + colorCount + height;
+        for (int line = 0; line < lineCount; line++) {
+            const unsigned char* bytes =
+                (const unsigned char*) xpm[line];
+            // Include the terminator, so line breaks count too.
+            do {
+                hash = (hash ^ *bytes) * 0x100000001b3ULL;
+            } while (*bytes++);
+        }
+    }
+
+    return hash;
+}
+
+/** *********************************************************************
+ ** This method runs job(index) for every index in 0 .. count - 1 on
+ ** a thread pool & waits for all of them.
+ **
+ ** Index 0 always runs here first: gdk-pixbuf loads its xpm loader
+ ** lazily on first use, & that must not race.
+ **/
+static void runStormShapeJobs(GFunc job, int count) {
+    if (count <= 0) {
+        return;
+    }
+    job(GINT_TO_POINTER(1), NULL);
+
+    GThreadPool* pool = g_thread_pool_new(job, NULL,
+        g_get_num_processors(), FALSE, NULL);
+    for (int i = 1; i < count; i++) {
+        if (pool) {
+            g_thread_pool_push(pool, GINT_TO_POINTER(i + 1), NULL);
+        } else {
+            job(GINT_TO_POINTER(i + 1), NULL);
+        }
+    }
+
+    if (pool) {
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+}
+
+/** *********************************************************************
+ ** This method sets the erand48() state for random shape index,
+ ** independent of every other shape & of thread scheduling.
+ **/
+static void seedRandomStormShape(int index,
+    unsigned short seed[3]) {
+    // splitmix64.
+    uint64_t z = RANDOM_STORMITEM_SEED +
+        (uint64_t) Flags.ShapeSizeFactor * 0x100000000ULL +
+        (uint64_t) (index + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+
+    seed[0] = (unsigned short) z;
+    seed[1] = (unsigned short) (z >> 16);
+    seed[2] = (unsigned short) (z >> 32);
+}
+
+/** *********************************************************************
+ ** Thread pool job, creates one random shape.
+ **/
+static void createRandomStormShapeJob(gpointer data,
+    __attribute__((unused)) gpointer userData) {
+    const int index = GPOINTER_TO_INT(data) - 1;
+
+    unsigned short seed[3];
+    seedRandomStormShape(index, seed);
+
+    createRandomStormShape(
+        Flags.ShapeSizeFactor +
+            (Flags.ShapeSizeFactor * erand48(seed)),
+        Flags.ShapeSizeFactor +
+            (Flags.ShapeSizeFactor * erand48(seed)),
+        &mStormItemShapes[index + mResourcesShapeCount], seed);
+}
+
 /** *********************************************************************
  ** This method loads and/or creates stormItem
  ** pixmap images combined from pre-loaded images
@@ -138,38 +259,37 @@ int getResourcesShapeCount() {
  **/
 void createCombinedShapesList() {
     // Remove any existing Shape list.
-    if (mStormItemShapes) {
-        for (int i = 0; i < mStormItemsShapeCount; i++) {
-            xpm_destroy(mStormItemShapes[i]);
-        }
-        free(mStormItemShapes);
-    }
+    destroyCombinedShapesList();
 
     // Create new combined Shape list.
-    mStormItemsShapeCount = mResourcesShapeCount +
-        RANDOM_STORMITEM_COUNT;
-
-    char*** newShapesList = (char***) malloc(
+    mStormItemShapes = (char***) malloc(
         mStormItemsShapeCount * sizeof(char**));
 
     // First, add Shapes from resources Shapes list.
     int lineCount;
     for (int i = 0; i < mResourcesShapeCount; i++) {
         xpm_set_color((char**) mResourcesShapes[i],
-            &newShapesList[i], &lineCount, "storm");
+            &mStormItemShapes[i], &lineCount, "storm");
     }
 
     // Then Shapes generated randomly.
-    for (int i = 0; i < RANDOM_STORMITEM_COUNT; i++) {
-        createRandomStormShape(
-            Flags.ShapeSizeFactor +
-                (Flags.ShapeSizeFactor * drand48()),
-            Flags.ShapeSizeFactor +
-                (Flags.ShapeSizeFactor * drand48()),
-            &newShapesList[i + mResourcesShapeCount]);
+    runStormShapeJobs(createRandomStormShapeJob,
+        RANDOM_STORMITEM_COUNT);
+}
+
+/** *********************************************************************
+ ** This method frees the Shape list, it's rebuilt on demand.
+ **/
+void destroyCombinedShapesList() {
+    if (!mStormItemShapes) {
+        return;
     }
 
-    mStormItemShapes = newShapesList;
+    for (int i = 0; i < mStormItemsShapeCount; i++) {
+        xpm_destroy(mStormItemShapes[i]);
+    }
+    free(mStormItemShapes);
+    mStormItemShapes = NULL;
 }
 
 /** *********************************************************************
@@ -179,6 +299,8 @@ void createCombinedShapesList() {
 void createCombinedShapeSurfacesList() {
     mStormItemSurfaceList = (StormItemSurface*) malloc(
         mStormItemsShapeCount * sizeof(StormItemSurface));
+    mStormItemShapeColors = (const char**) malloc(
+        mStormItemsShapeCount * sizeof(char*));
 
     for (int i = 0; i < mStormItemsShapeCount; i++) {
         mStormItemSurfaceList[i].surface = NULL;
@@ -186,164 +308,156 @@ void createCombinedShapeSurfacesList() {
 }
 
 /** *********************************************************************
- ** This method updates stormItem pixmap image attributes such as color.
+ ** Thread pool job, renders & scales one shape to its surface.
  **/
-void updateStormShapesAttributes() {
-    for (int i = 0; i < mStormItemsShapeCount; i++) {
-        // Reset each Shape base to StormColor.
-        char** shapeString;
-        int lineCount;
-        xpm_set_color(mStormItemShapes[i], &shapeString, &lineCount,
-            getNextStormShapeColorAsString());
-
-        // Get item base w/h, and rando shrink item size w/h.
-        // Items stuck on scenery removes themself this way.
-        int itemWidth, itemHeight;
-        sscanf(mStormItemShapes[i][0], "%d %d",
-            &itemWidth, &itemHeight);
-        itemWidth *= 0.01 * Flags.Scale *
-            mStormItemSizeAdjustment * mGlobal.WindowScale;
-        itemHeight *= 0.01 * Flags.Scale *
-            mStormItemSizeAdjustment * mGlobal.WindowScale;
-
-        // Set new item draw surface.
-        // Guard stormItem w/h.
-        StormItemSurface* itemSurface =
-            &mStormItemSurfaceList[i];
-        if (itemWidth < 1) {
-            itemWidth = 1;
-        }
-        if (itemHeight < 1) {
-            itemHeight = 1;
-        }
-        if (itemWidth == 1 && itemHeight == 1) {
-            itemHeight = 2;
-        }
-        itemSurface->width = itemWidth;
-        itemSurface->height = itemHeight;
-
-        // Destroy existing surface.
-        if (itemSurface->surface) {
-            cairo_surface_destroy(itemSurface->surface);
-        }
-
-        // Create new surface from base.
-        GdkPixbuf* newStormItemSurface =
-            gdk_pixbuf_new_from_xpm_data((const char**) shapeString);
-        xpm_destroy(shapeString);
-
-        // Scale it to new size.
-        GdkPixbuf* pixbufscaled = gdk_pixbuf_scale_simple(
-            newStormItemSurface, itemWidth, itemHeight,
-            GDK_INTERP_HYPER);
-        itemSurface->surface = gdk_cairo_surface_create_from_pixbuf(
-            pixbufscaled, 0, NULL);
-        g_clear_object(&pixbufscaled);
+static void createStormShapeSurfaceJob(gpointer data,
+    __attribute__((unused)) gpointer userData) {
+    const int index = GPOINTER_TO_INT(data) - 1;
 
-        g_clear_object(&newStormItemSurface);
+    // Reset each Shape base to StormColor.
+    char** shapeString;
+    int lineCount;
+    xpm_set_color(mStormItemShapes[index], &shapeString, &lineCount,
+        mStormItemShapeColors[index]);
+
+    // Get item base w/h, and rando shrink item size w/h.
+    // Items stuck on scenery removes themself this way.
+    int itemWidth, itemHeight;
+    sscanf(mStormItemShapes[index][0], "%d %d",
+        &itemWidth, &itemHeight);
+    itemWidth *= 0.01 * Flags.Scale *
+        mStormItemSizeAdjustment * mGlobal.WindowScale;
+    itemHeight *= 0.01 * Flags.Scale *
+        mStormItemSizeAdjustment * mGlobal.WindowScale;
+
+    // Set new item draw surface.
+    // Guard stormItem w/h.
+    StormItemSurface* itemSurface =
+        &mStormItemSurfaceList[index];
+    if (itemWidth < 1) {
+        itemWidth = 1;
+    }
+    if (itemHeight < 1) {
+        itemHeight = 1;
     }
+    if (itemWidth == 1 && itemHeight == 1) {
+        itemHeight = 2;
+    }
+    itemSurface->width = itemWidth;
+    itemSurface->height = itemHeight;
+
+    // Create new surface from base.
+    GdkPixbuf* newStormItemSurface =
+        gdk_pixbuf_new_from_xpm_data((const char**) shapeString);
+    xpm_destroy(shapeString);
+
+    // Scale it to new size.
+    GdkPixbuf* pixbufscaled = gdk_pixbuf_scale_simple(
+        newStormItemSurface, itemWidth, itemHeight,
+        GDK_INTERP_HYPER);
+    itemSurface->surface = gdk_cairo_surface_create_from_pixbuf(
+        pixbufscaled, 0, NULL);
+    g_clear_object(&pixbufscaled);
+
+    g_clear_object(&newStormItemSurface);
 }
 
 /** *********************************************************************
- ** This method updates module based on User pref settings.
+ ** This method updates stormItem pixmap image attributes such as color.
+ **
+ ** Surfaces come from the shape cache when one matches the current
+ ** settings, else they're built on the thread pool & cached.
  **/
-void respondToStormsSettingsChanges() {
-    //UIDO(ShowStormItems,
-    if (Flags.ShowStormItems !=
-            OldFlags.ShowStormItems) {
-        OldFlags.ShowStormItems =
-            Flags.ShowStormItems;
-        if (!Flags.ShowStormItems) {
-            clearStormWindow();
-        }
-        Flags.mHaveFlagsChanged++;
-    }
-
-    //UIDO(ShapeSizeFactor, 
-    if (Flags.ShapeSizeFactor !=
-            OldFlags.ShapeSizeFactor) {
-        OldFlags.ShapeSizeFactor =
-            Flags.ShapeSizeFactor;
-        setStormItemSize();
-        Flags.mHaveFlagsChanged++;
-    }
-
-    //UIDO(StormItemSpeedFactor,
-    if (Flags.StormItemSpeedFactor !=
-            OldFlags.StormItemSpeedFactor) {
-        OldFlags.StormItemSpeedFactor =
-            Flags.StormItemSpeedFactor;
-        setStormItemSpeed();
-        Flags.mHaveFlagsChanged++;
+void updateStormShapesAttributes() {
+    StormShapeCacheKey key;
+    memset(&key, 0, sizeof(key));
+    g_strlcpy(key.programVersion, VERSION,
+        sizeof(key.programVersion));
+    key.generatorVersion = STORM_SHAPE_CACHE_VERSION;
+    key.pixbufVersion = (gdk_pixbuf_major_version << 16) |
+        (gdk_pixbuf_minor_version << 8) | gdk_pixbuf_micro_version;
+    key.resourcesHash = mResourcesShapesHash;
+    key.seed = RANDOM_STORMITEM_SEED;
+    key.resourcesShapeCount = mResourcesShapeCount;
+    key.randomShapeCount = RANDOM_STORMITEM_COUNT;
+    key.shapeSizeFactor = Flags.ShapeSizeFactor;
+    key.scale = Flags.Scale;
+    key.windowScale = mGlobal.WindowScale;
+    key.sizeAdjustment = mStormItemSizeAdjustment;
+    key.colorToggle = mStormItemColorToggle;
+    g_strlcpy(key.color1, Flags.StormItemColor1,
+        sizeof(key.color1));
+    g_strlcpy(key.color2, Flags.StormItemColor2,
+        sizeof(key.color2));
+
+    // Colors alternate per shape, assign them in order.
+    for (int i = 0; i < mStormItemsShapeCount; i++) {
+        mStormItemShapeColors[i] = getNextStormShapeColorAsString();
     }
 
-    //UIDO(StormItemCountMax, );
-    if (Flags.StormItemCountMax !=
-            OldFlags.StormItemCountMax) {
-        OldFlags.StormItemCountMax =
-            Flags.StormItemCountMax;
-        Flags.mHaveFlagsChanged++;
+    // Destroy existing surfaces, then any mapping under them.
+    for (int i = 0; i < mStormItemsShapeCount; i++) {
+        if (mStormItemSurfaceList[i].surface) {
+            cairo_surface_destroy(mStormItemSurfaceList[i].surface);
+            mStormItemSurfaceList[i].surface = NULL;
+        }
     }
+    releaseStormShapeCache();
 
-    //UIDO(StormSaturationFactor,
-    if (Flags.StormSaturationFactor !=
-            OldFlags.StormSaturationFactor) {
-        OldFlags.StormSaturationFactor =
-            Flags.StormSaturationFactor;
-        setStormItemsPerSecond();
-        Flags.mHaveFlagsChanged++;
+    // Warm start.
+    if (loadStormShapeCache(&key, mStormItemSurfaceList,
+        mStormItemsShapeCount)) {
+        return;
     }
 
-    //UIDOS(StormItemColor1, updateStormShapesAttributes();
-    //    clearStormWindow(););
-    if (strcmp(Flags.StormItemColor1, OldFlags.StormItemColor1)) {
-        updateStormShapesAttributes();
-        clearStormWindow();
-        free(OldFlags.StormItemColor1);
-        OldFlags.StormItemColor1 = strdup(Flags.StormItemColor1);
-        Flags.mHaveFlagsChanged++;
+    // Cold start.
+    if (!mStormItemShapes) {
+        createCombinedShapesList();
     }
+    runStormShapeJobs(createStormShapeSurfaceJob,
+        mStormItemsShapeCount);
 
-    if (isQPickerActive() && !strcmp(getQPickerCallerName(),
-        "StormItemColor1TAG") && !isQPickerVisible()) {
-        char cbuffer[16];
-        snprintf(cbuffer, 16, "#%02x%02x%02x", getQPickerRed(),
-            getQPickerGreen(), getQPickerBlue());
+    saveStormShapeCache(&key, mStormItemSurfaceList,
+        mStormItemsShapeCount);
+}
 
-        GdkRGBA color;
-        gdk_rgba_parse(&color, cbuffer);
-        free(Flags.StormItemColor1);
-        rgba2color(&color, &Flags.StormItemColor1);
+/** *********************************************************************
+ ** This method updates module based on User pref settings.
+ **/
+void respondToStormsSettingsChanges(PrefKey key) {
+    switch (key) {
+        case PREF_SHOW_STORM_ITEMS:
+            if (!Flags.ShowStormItems) {
+                clearStormWindow();
+            }
+            break;
 
-        endQPickerDialog();
-    }
+        case PREF_SHAPE_SIZE_FACTOR:
+            setStormItemSize();
+            break;
 
-    //UIDOS(StormItemColor2, updateStormShapesAttributes();
-    // clearStormWindow(););
-    if (strcmp(Flags.StormItemColor2, OldFlags.StormItemColor2)) {
-        updateStormShapesAttributes();
-        clearStormWindow();
-        free(OldFlags.StormItemColor2);
-        OldFlags.StormItemColor2 = strdup(Flags.StormItemColor2);
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_STORM_ITEM_SPEED_FACTOR:
+            setStormItemSpeed();
+            break;
 
-    if (isQPickerActive() && !strcmp(getQPickerCallerName(),
-        "StormItemColor2TAG") && !isQPickerVisible()) {
-        char cbuffer[16];
-        snprintf(cbuffer, 16, "#%02x%02x%02x", getQPickerRed(),
-            getQPickerGreen(), getQPickerBlue());
+        case PREF_STORM_SATURATION_FACTOR:
+            setStormItemsPerSecond();
+            break;
 
-        GdkRGBA color;
-        gdk_rgba_parse(&color, cbuffer);
-        free(Flags.StormItemColor2);
-        rgba2color(&color, &Flags.StormItemColor2);
+        case PREF_STORM_ITEM_COLOR1:
+        case PREF_STORM_ITEM_COLOR2:
+            updateStormShapesAttributes();
+            clearStormWindow();
+            break;
 
-        endQPickerDialog();
-    }
+        case PREF_SCALE:
+            if (hasAppScaleChangedFrom(&mPreviousAppScale)) {
+                updateStormShapesAttributes();
+            }
+            break;
 
-    if (hasAppScaleChangedFrom(&mPreviousAppScale)) {
-        updateStormShapesAttributes();
+        default:
+            break;
     }
 }
 
@@ -351,7 +465,7 @@ void respondToStormsSettingsChanges() {
  ** This method sets the desired size of the StormItem.
  **/
 void setStormItemSize() {
-    createCombinedShapesList();
+    destroyCombinedShapesList();
     updateStormShapesAttributes();
 
     clearStormWindow();
@@ -432,7 +546,8 @@ int doCreateStormShapeEvent() {
 
     // Determine how many items we can create.
     const int desiredItemsCount = lrint((eventElapsedTime +
-        mCreateEventStartedDesiringTime) * mStormItemsPerSecond);
+        mCreateEventStartedDesiringTime) * mStormItemsPerSecond *
+        getQualityItemScale());
 
     // Early out if none desired due to busy.
     if (desiredItemsCount == 0) {
@@ -477,24 +592,105 @@ int doStallCreateStormShapeEvent() {
  ** (hashtable set).
  **/
 StormItem* createStormItem(int itemType) {
-    mGlobal.StormItemCount++;
+    StormItem* stormItem;
+    createStormItems(itemType, 1, &stormItem);
+
+    return stormItem;
+}
+
+/** *********************************************************************
+ ** This method updates every item in the itemset, timed as one
+ ** physics cost for the quality governor.
+ **/
+static int doUpdateAllStormItemsEvent() {
+    const unsigned int count = set_size();
+    if (count > mUpdateStormItemsSize) {
+        mUpdateStormItemsSize = count;
+        mUpdateStormItems = (StormItem**) realloc(mUpdateStormItems,
+            sizeof(StormItem*) * mUpdateStormItemsSize);
+        REALLOC_CHECK(mUpdateStormItems);
+    }
+
+    set_begin();
+    for (unsigned int i = 0; i < count; i++) {
+        mUpdateStormItems[i] = (StormItem*) set_next();
+    }
+
+    const uint64_t physicsCostStart = startLoadCost(LOAD_COST_PHYSICS);
+    for (unsigned int i = 0; i < count; i++) {
+        updateStormItem(mUpdateStormItems[i]);
+    }
+    endLoadCost(LOAD_COST_PHYSICS, physicsCostStart);
+
+    return true;
+}
+
+/** *********************************************************************
+ ** This method (re)starts the shared update tick. Its period follows
+ ** cpufactor, so HandleCpuFactor() calls it whenever that changes.
+ **/
+void addStormItemsUpdateToMainloop() {
+    remove_from_mainloop(&mUpdateStormItemsSource);
+    mUpdateStormItemsSource = addMethodToMainloop(PRIORITY_HIGH,
+        DO_STORMITEM_UPDATE_EVENT_TIME, doUpdateAllStormItemsEvent);
+}
 
-    // If itemType < 0, create random itemType.
-    if (itemType < 0) {
-        itemType = mResourcesShapeCount + drand48() *
+/** *********************************************************************
+ ** This method creates count items from itemType (or random) in one
+ ** go: pool slots & set capacity are reserved up front, then each
+ ** item is initialized & joins the itemset, which the shared update
+ ** tick walks. Created items are returned in stormItems for the
+ ** caller to position.
+ **/
+void createStormItems(int itemType, int count,
+    StormItem** stormItems) {
+    if (count <= 0) {
+        return;
+    }
+
+    reserveStormItems(count);
+    set_reserve(count);
+
+    mGlobal.StormItemCount += count;
+
+    for (int i = 0; i < count; i++) {
+        StormItem* stormItem =
+            mFreeStormItems[--mFreeStormItemsCount];
+
+        // If itemType < 0, create random itemType.
+        stormItem->shapeType = (itemType >= 0) ? itemType :
+            mResourcesShapeCount + drand48() *
             (mStormItemsShapeCount - mResourcesShapeCount);
+        pushStormItemIntoItemset(stormItem);
+
+        stormItems[i] = stormItem;
+    }
+}
+
+/** *********************************************************************
+ ** This method makes sure the pool holds at least count free items.
+ **/
+void reserveStormItems(int count) {
+    if (mFreeStormItemsCount >= count) {
+        return;
     }
 
-    StormItem* stormItem = (StormItem*) malloc(
-        sizeof(StormItem));
-    stormItem->shapeType = itemType;
-    pushStormItemIntoItemset(stormItem);
+    const int blockSize = (count > STORMITEM_POOL_BLOCK_SIZE) ?
+        count : STORMITEM_POOL_BLOCK_SIZE;
 
-    addMethodWithArgToMainloop(PRIORITY_HIGH,
-        DO_STORMITEM_UPDATE_EVENT_TIME,
-        (GSourceFunc) updateStormItem, stormItem);
+    // Free list must be able to hold every item ever allocated.
+    mAllocatedStormItemsCount += blockSize;
+    mFreeStormItems = (StormItem**) realloc(mFreeStormItems,
+        sizeof(StormItem*) * mAllocatedStormItemsCount);
+    REALLOC_CHECK(mFreeStormItems);
 
-    return stormItem;
+    StormItem* block = (StormItem*) malloc(
+        sizeof(StormItem) * blockSize);
+    MALLOC_CHECK(block);
+
+    for (int i = 0; i < blockSize; i++) {
+        mFreeStormItems[mFreeStormItemsCount++] = &block[i];
+    }
 }
 
 /** *********************************************************************
@@ -552,7 +748,8 @@ int updateStormItem(StormItem* stormItem) {
     // Low probability to remove each, High probability
     // To remove blown-off.
     const bool itemsRequireRemoval = (mGlobal.StormItemCount -
-        mGlobal.FluffedStormItemCount) >= Flags.StormItemCountMax;
+        mGlobal.FluffedStormItemCount) >=
+        Flags.StormItemCountMax * getQualityItemScale();
 
     if (itemsRequireRemoval) {
         if ((!stormItem->cyclic && (drand48() > 0.3)) ||
@@ -562,7 +759,7 @@ int updateStormItem(StormItem* stormItem) {
         }
     }
 
-    // Update speed in x Direction if wind blowing.
+    // Update speed with the wind, if blowing.
     if (Flags.ShowWind) {
         float force = stormItemUpdateTime *
             stormItem->windSensitivity / stormItem->massValue;
@@ -572,8 +769,18 @@ int updateStormItem(StormItem* stormItem) {
         if (force < -0.9) {
             force = -0.9;
         }
+
+        // Gusts & whirls vary over the screen, so each item
+        // takes the wind where it is.
+        float windX, windY;
+        sampleWindField(stormItem->xRealPosition,
+            stormItem->yRealPosition, &windX, &windY);
+
         stormItem->xVelocity += force *
-            (mGlobal.NewWind - stormItem->xVelocity);
+            (windX - stormItem->xVelocity);
+        stormItem->yVelocity += force * 0.25 *
+            (stormItem->initialYVelocity + windY -
+            stormItem->yVelocity);
 
         const float X_DIR_SPEED_BOUND =
             mWindSpeedMaxArray[mGlobal.Wind] * 2;
@@ -625,7 +832,7 @@ int updateStormItem(StormItem* stormItem) {
 
     // Fallen interaction.
     if (!stormItem->fluff) {
-        lockFallenSemaphore();
+        lockFallenSemaphoreForRead();
         if (isStormItemFallen(stormItem,
             lrintf(NewX), lrintf(NewY))) {
             removeStormItemInItemset(stormItem);
@@ -646,8 +853,12 @@ int updateStormItem(StormItem* stormItem) {
  **
  ** The stormItem will be rotated, so the w and h of the resulting
  ** xpm will be different from the input w and h.
+ **
+ ** Randoms come from seed only (erand48), so shapes can be built
+ ** concurrently & reproducibly.
  **/
-void createRandomStormShape(int xpmWidth, int xpmHeight, char*** xpm) {
+void createRandomStormShape(int xpmWidth, int xpmHeight, char*** xpm,
+    unsigned short seed[3]) {
     // Initialize with @ least one pixel in the middle.
     const int xpmArrayLength = xpmWidth * xpmHeight;
 
@@ -679,7 +890,7 @@ void createRandomStormShape(int xpmWidth, int xpmHeight, char*** xpm) {
 
             // Push arrayItem on eventProbability.
             const float eventProbability = 1.1 - (px * py);
-            if (drand48() > eventProbability) {
+            if (erand48(seed) > eventProbability) {
                 if (itemArrayLength < xpmArrayLength) {
                     itemYArray[itemArrayLength] = xpmHeightIndex - halfXpmWidth;
                     itemXArray[itemArrayLength] = xpmWidthIndex - halfXpmHeight;
@@ -690,7 +901,7 @@ void createRandomStormShape(int xpmWidth, int xpmHeight, char*** xpm) {
     }
 
     // Rotate points with a random angle 0 .. pi. (Rick Magic?)
-    const float randomAngle = drand48() * M_PI;
+    const float randomAngle = erand48(seed) * M_PI;
     const float cosRandomAngle = cosf(randomAngle);
     const float sinRandomAngle = sinf(randomAngle);
 
@@ -862,19 +1073,24 @@ GdkRGBA getNextStormShapeColorAsRGB() {
 bool isStormItemFallen(StormItem* stormItem,
     int xPos, int yPos) {
 
+    // Above every fallen top, nothing to hit.
+    if (yPos < getFallenHighestTop()) {
+        return false;
+    }
+
     const int itemWidth =
         mStormItemSurfaceList[stormItem->shapeType].width;
 
     FallenItem* fallen = mGlobal.FallenFirst;
     while (fallen) {
-        if (fallen->winInfo.hidden) {
+        if (fallen->winInfo.state & WINDOW_STATE_HIDDEN) {
             fallen = fallen->next;
             continue;
         }
 
         if (fallen->winInfo.window != None &&
             !isFallenOnVisibleWorkspace(fallen) &&
-            !fallen->winInfo.sticky) {
+            !(fallen->winInfo.state & WINDOW_STATE_STICKY)) {
             fallen = fallen->next;
             continue;
         }
@@ -896,22 +1112,23 @@ bool isStormItemFallen(StormItem* stormItem,
             imax = fallen->w;
         }
 
-        for (int i = istart; i < imax; i++) {
-            if (yPos > fallen->y - fallen->fallenHeight[i] - 1) {
-                if (fallen->fallenHeight[i] < fallen->maxFallenHeight[i]) {
-                    updateFallenPartial(fallen, xPos - fallen->x,
-                        itemWidth);
-                }
+        // First column the item is below the top of.
+        const int i = findFirstColumnAbove(fallen->heightTree,
+            istart, imax, fallen->y - 1 - yPos);
+        if (i >= 0) {
+            if (fallen->fallenHeight[i] < fallen->maxFallenHeight[i]) {
+                updateFallenPartial(fallen, xPos - fallen->x,
+                    itemWidth);
+            }
 
-                if (canFallenConsumeStormItem(fallen)) {
-                    setStormItemState(stormItem, .9);
-                    if (!stormItem->fluff) {
-                        return true;
-                    }
+            if (canFallenConsumeStormItem(fallen)) {
+                setStormItemState(stormItem, .9);
+                if (!stormItem->fluff) {
+                    return true;
                 }
-
-                return false;
             }
+
+            return false;
         }
 
         // Otherwise, loop thru all.
@@ -1016,8 +1233,7 @@ int removeAllStormItemsInItemset() {
 /** *********************************************************************
  ** Itemset hashtable helper - Remove a specific item from the list.
  **
- ** Calls to this method from the mainloop() *MUST* be followed by
- ** a 'return false;' to remove this stormItem from the g_timeout callback.
+ ** Once out of the set, the shared update tick no longer sees it.
  **/
 void removeStormItemInItemset(StormItem* stormItem) {
     if (stormItem->fluff) {
@@ -1026,7 +1242,9 @@ void removeStormItemInItemset(StormItem* stormItem) {
 
     set_erase(stormItem);
 
-    free(stormItem);
+    // Back to the pool, which always has room: every
+    // live item came from it.
+    mFreeStormItems[mFreeStormItemsCount++] = stormItem;
     mGlobal.StormItemCount--;
 }
 
@@ -21,16 +21,18 @@
 #pragma once
 
 #include "plasmastorm.h"
+#include "Prefs.h"
 
 #include <gtk/gtk.h>
 
 extern void initStormModule();
 int getResourcesShapeCount();
 void createCombinedShapesList();
+void destroyCombinedShapesList();
 void createCombinedShapeSurfacesList();
 void updateStormShapesAttributes();
 
-extern void respondToStormsSettingsChanges();
+extern void respondToStormsSettingsChanges(PrefKey);
 
 void setStormItemSize();
 void setStormItemSpeed();
@@ -42,9 +44,14 @@ int doCreateStormShapeEvent();
 extern int doStallCreateStormShapeEvent();
 
 extern StormItem* createStormItem(int);
+extern void createStormItems(int itemType, int count,
+    StormItem** stormItems);
+void reserveStormItems(int count);
 int updateStormItem(StormItem*);
+extern void addStormItemsUpdateToMainloop();
 
-void createRandomStormShape(int w, int h, char***);
+void createRandomStormShape(int w, int h, char***,
+    unsigned short seed[3]);
 
 void eraseStormItem(StormItem*);
 
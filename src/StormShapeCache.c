@@ -0,0 +1,335 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtk/gtk.h>
+
+#include "ColorCodes.h"
+#include "StormShapeCache.h"
+#include "utils.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+#define STORM_SHAPE_CACHE_DIR_NAME "plasmastorm"
+#define STORM_SHAPE_CACHE_PREFIX "shapes-"
+#define STORM_SHAPE_CACHE_SUFFIX ".cache"
+
+#define STORM_SHAPE_CACHE_ALIGNMENT 16
+
+// Other instances (displays, scales) keep their own files, each
+// load refreshes its file's mtime. Files unused this long go.
+#define STORM_SHAPE_CACHE_MAX_AGE_SECS (7 * 24 * 60 * 60)
+
+// Surfaces handed out by loadStormShapeCache()
+// point into this mapping.
+static void* mShapeCacheMap = NULL;
+static size_t mShapeCacheMapSize = 0;
+
+
+/** *********************************************************************
+ ** This method returns the cache directory, creating it if needed.
+ ** Caller frees.
+ **/
+static char* getStormShapeCacheDirName() {
+    char* dirName = g_build_filename(g_get_user_cache_dir(),
+        STORM_SHAPE_CACHE_DIR_NAME, NULL);
+    if (g_mkdir_with_parents(dirName, 0700) != 0) {
+        g_free(dirName);
+        return NULL;
+    }
+    return dirName;
+}
+
+/** *********************************************************************
+ ** This method returns the cache file name for a key. The name is
+ ** a hash, the key itself is checked on load. Caller frees.
+ **/
+static char* getStormShapeCacheFileName(const char* dirName,
+    const StormShapeCacheKey* key) {
+    // FNV-1a.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const unsigned char* bytes = (const unsigned char*) key;
+    for (size_t i = 0; i < sizeof(StormShapeCacheKey); i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+
+    char baseName[64];
+    snprintf(baseName, sizeof(baseName), "%s%016llx%s",
+        STORM_SHAPE_CACHE_PREFIX, (unsigned long long) hash,
+        STORM_SHAPE_CACHE_SUFFIX);
+
+    return g_build_filename(dirName, baseName, NULL);
+}
+
+/** *********************************************************************
+ ** This method checks a mapped cache file before anything in it is
+ ** trusted. Every record must lie within the file.
+ **/
+static bool isStormShapeCacheValid(const void* map, size_t mapSize,
+    const StormShapeCacheKey* key, int count) {
+    if (mapSize < sizeof(StormShapeCacheHeader)) {
+        return false;
+    }
+
+    const StormShapeCacheHeader* header =
+        (const StormShapeCacheHeader*) map;
+    if (header->magic != STORM_SHAPE_CACHE_MAGIC ||
+        header->version != STORM_SHAPE_CACHE_VERSION ||
+        header->headerSize != sizeof(StormShapeCacheHeader) ||
+        header->recordSize != sizeof(StormShapeCacheRecord) ||
+        header->recordCount != (uint32_t) count ||
+        header->fileSize != mapSize ||
+        memcmp(&header->key, key, sizeof(StormShapeCacheKey))) {
+        return false;
+    }
+
+    const size_t recordsEnd = sizeof(StormShapeCacheHeader) +
+        (size_t) count * sizeof(StormShapeCacheRecord);
+    if (recordsEnd > mapSize) {
+        return false;
+    }
+
+    const StormShapeCacheRecord* records = (const StormShapeCacheRecord*)
+        ((const char*) map + sizeof(StormShapeCacheHeader));
+    for (int i = 0; i < count; i++) {
+        const StormShapeCacheRecord* record = &records[i];
+        if (record->width < 1 || record->height < 1 ||
+            record->width > 0xffff || record->height > 0xffff ||
+            record->stride != (uint32_t) cairo_format_stride_for_width(
+                CAIRO_FORMAT_ARGB32, record->width) ||
+            record->pixelsOffset < recordsEnd ||
+            record->pixelsOffset % STORM_SHAPE_CACHE_ALIGNMENT) {
+            return false;
+        }
+        if (record->pixelsOffset + (uint64_t) record->stride *
+            record->height > mapSize) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** This method maps the cache file for key & fills surfaces with
+ ** image surfaces over its pixels. Returns false on any miss, with
+ ** surfaces untouched.
+ **
+ ** The mapping lives until releaseStormShapeCache(), the caller
+ ** must destroy these surfaces before that.
+ **/
+bool loadStormShapeCache(const StormShapeCacheKey* key,
+    StormItemSurface* surfaces, int count) {
+    releaseStormShapeCache();
+
+    char* dirName = getStormShapeCacheDirName();
+    if (!dirName) {
+        return false;
+    }
+    char* fileName = getStormShapeCacheFileName(dirName, key);
+    g_free(dirName);
+
+    const int fd = open(fileName, O_RDONLY);
+    g_free(fileName);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    // Mark it in use, see pruneStaleStormShapeCaches().
+    futimens(fd, NULL);
+
+    // Private & writable so a stray draw into a
+    // surface can't fault, or reach the file.
+    const size_t mapSize = fileStat.st_size;
+    void* map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    if (!isStormShapeCacheValid(map, mapSize, key, count)) {
+        munmap(map, mapSize);
+        return false;
+    }
+
+    const StormShapeCacheRecord* records = (const StormShapeCacheRecord*)
+        ((const char*) map + sizeof(StormShapeCacheHeader));
+    for (int i = 0; i < count; i++) {
+        surfaces[i].width = records[i].width;
+        surfaces[i].height = records[i].height;
+        surfaces[i].surface = cairo_image_surface_create_for_data(
+            (unsigned char*) map + records[i].pixelsOffset,
+            CAIRO_FORMAT_ARGB32, records[i].width, records[i].height,
+            records[i].stride);
+    }
+
+    mShapeCacheMap = map;
+    mShapeCacheMapSize = mapSize;
+    return true;
+}
+
+/** *********************************************************************
+ ** This method unmaps the current cache file, if any.
+ **/
+void releaseStormShapeCache() {
+    if (mShapeCacheMap) {
+        munmap(mShapeCacheMap, mShapeCacheMapSize);
+    }
+    mShapeCacheMap = NULL;
+    mShapeCacheMapSize = 0;
+}
+
+/** *********************************************************************
+ ** This method removes cache files not used for a long while
+ ** before the one just written. Files of other running instances
+ ** are in use, so they're kept.
+ **/
+static void pruneStaleStormShapeCaches(const char* dirName,
+    const char* keepFileName) {
+    struct stat keepStat;
+    if (stat(keepFileName, &keepStat) != 0) {
+        return;
+    }
+    const time_t staleTime = keepStat.st_mtime -
+        STORM_SHAPE_CACHE_MAX_AGE_SECS;
+
+    GDir* dir = g_dir_open(dirName, 0, NULL);
+    if (!dir) {
+        return;
+    }
+
+    const char* baseName;
+    while ((baseName = g_dir_read_name(dir))) {
+        if (!g_str_has_prefix(baseName, STORM_SHAPE_CACHE_PREFIX)) {
+            continue;
+        }
+        char* fileName = g_build_filename(dirName, baseName, NULL);
+        struct stat fileStat;
+        if (strcmp(fileName, keepFileName) &&
+            stat(fileName, &fileStat) == 0 &&
+            fileStat.st_mtime < staleTime) {
+            unlink(fileName);
+        }
+        g_free(fileName);
+    }
+
+    g_dir_close(dir);
+}
+
+/** *********************************************************************
+ ** This method writes surfaces to the cache file for key.
+ **/
+void saveStormShapeCache(const StormShapeCacheKey* key,
+    const StormItemSurface* surfaces, int count) {
+    // Size it.
+    const size_t recordsEnd = sizeof(StormShapeCacheHeader) +
+        (size_t) count * sizeof(StormShapeCacheRecord);
+    size_t fileSize = recordsEnd;
+    for (int i = 0; i < count; i++) {
+        cairo_surface_t* surface = surfaces[i].surface;
+        if (!surface ||
+            cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+            cairo_image_surface_get_format(surface) !=
+                CAIRO_FORMAT_ARGB32) {
+            return;
+        }
+        fileSize = (fileSize + STORM_SHAPE_CACHE_ALIGNMENT - 1) &
+            ~(size_t) (STORM_SHAPE_CACHE_ALIGNMENT - 1);
+        fileSize += (size_t) cairo_image_surface_get_stride(surface) *
+            cairo_image_surface_get_height(surface);
+    }
+
+    char* buffer = (char*) calloc(1, fileSize);
+    if (!buffer) {
+        return;
+    }
+
+    // Fill it.
+    StormShapeCacheHeader* header = (StormShapeCacheHeader*) buffer;
+    header->magic = STORM_SHAPE_CACHE_MAGIC;
+    header->version = STORM_SHAPE_CACHE_VERSION;
+    header->headerSize = sizeof(StormShapeCacheHeader);
+    header->recordSize = sizeof(StormShapeCacheRecord);
+    header->recordCount = count;
+    header->fileSize = fileSize;
+    header->key = *key;
+
+    StormShapeCacheRecord* records = (StormShapeCacheRecord*)
+        (buffer + sizeof(StormShapeCacheHeader));
+    size_t pixelsOffset = recordsEnd;
+    for (int i = 0; i < count; i++) {
+        cairo_surface_t* surface = surfaces[i].surface;
+        cairo_surface_flush(surface);
+
+        pixelsOffset = (pixelsOffset + STORM_SHAPE_CACHE_ALIGNMENT - 1) &
+            ~(size_t) (STORM_SHAPE_CACHE_ALIGNMENT - 1);
+
+        records[i].width = cairo_image_surface_get_width(surface);
+        records[i].height = cairo_image_surface_get_height(surface);
+        records[i].stride = cairo_image_surface_get_stride(surface);
+        records[i].pixelsOffset = pixelsOffset;
+
+        const size_t pixelsSize = (size_t) records[i].stride *
+            records[i].height;
+        memcpy(buffer + pixelsOffset,
+            cairo_image_surface_get_data(surface), pixelsSize);
+        pixelsOffset += pixelsSize;
+    }
+
+    // Write it.
+    char* dirName = getStormShapeCacheDirName();
+    if (!dirName) {
+        free(buffer);
+        return;
+    }
+    char* fileName = getStormShapeCacheFileName(dirName, key);
+
+    // A lost cache file is only regenerated, not worth a disk sync.
+    const bool isWritten = writeFileAtomically(fileName, buffer,
+        fileSize, ATOMIC_WRITE_NO_SYNC);
+    if (isWritten) {
+        pruneStaleStormShapeCaches(dirName, fileName);
+    } else {
+        printf("%splasmastorm: Storm shape cache NOT saved: %s.%s\n",
+            COLOR_YELLOW, strerror(errno), COLOR_NORMAL);
+    }
+
+    g_free(fileName);
+    g_free(dirName);
+    free(buffer);
+}
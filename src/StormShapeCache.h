@@ -0,0 +1,97 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "plasmastorm.h"
+
+
+/***********************************************************
+ * Storm shape cache layout. All values are native endian,
+ * the file never leaves the machine
+ * ($XDG_CACHE_HOME/plasmastorm).
+ *
+ *   StormShapeCacheHeader
+ *   StormShapeCacheRecord[recordCount]
+ *   per record: CAIRO_FORMAT_ARGB32 pixels, stride * height,
+ *       16 byte aligned
+ *
+ * A file is only used when its key matches byte for byte. The
+ * key holds the settings, the program & gdk-pixbuf versions and
+ * a hash of the resource xpms. Code that shapes the pixels is
+ * covered by STORM_SHAPE_CACHE_VERSION: bump it whenever
+ * createRandomStormShape(), xpm coloring or the scaling in
+ * Storm.c changes.
+ */
+#define STORM_SHAPE_CACHE_MAGIC 0x48535350 // "PSSH"
+#define STORM_SHAPE_CACHE_VERSION 2
+
+#define STORM_SHAPE_CACHE_COLOR_LENGTH 32
+#define STORM_SHAPE_CACHE_PROGRAM_VERSION_LENGTH 32
+
+typedef struct _StormShapeCacheKey {
+    char programVersion[STORM_SHAPE_CACHE_PROGRAM_VERSION_LENGTH];
+    uint32_t generatorVersion;
+    uint32_t pixbufVersion;
+    uint64_t resourcesHash;
+    uint64_t seed;
+    uint32_t resourcesShapeCount;
+    uint32_t randomShapeCount;
+    int32_t shapeSizeFactor;
+    int32_t scale;
+    float windowScale;
+    float sizeAdjustment;
+    uint32_t colorToggle;
+    uint32_t reserved;
+    char color1[STORM_SHAPE_CACHE_COLOR_LENGTH];
+    char color2[STORM_SHAPE_CACHE_COLOR_LENGTH];
+} StormShapeCacheKey;
+
+typedef struct _StormShapeCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t recordCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+    StormShapeCacheKey key;
+} StormShapeCacheHeader;
+
+typedef struct _StormShapeCacheRecord {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t reserved;
+    uint64_t pixelsOffset;
+} StormShapeCacheRecord;
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern bool loadStormShapeCache(const StormShapeCacheKey*,
+    StormItemSurface* surfaces, int count);
+extern void saveStormShapeCache(const StormShapeCacheKey*,
+    const StormItemSurface* surfaces, int count);
+extern void releaseStormShapeCache();
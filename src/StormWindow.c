@@ -30,10 +30,15 @@
 #include "Application.h"
 #include "ColorCodes.h"
 #include "Prefs.h"
+#include "startupProfiler.h"
 #include "StormWindow.h"
 #include "Windows.h"
 #include "utils.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_APPLICATION
+#include "x11Stats.h"
+
 
 /** *********************************************************************
  ** Module globals and consts.
@@ -90,20 +95,8 @@ void createStormWindow() {
     } else {
         mGlobal.isCairoAvailable = true;
 
-        // Find global StormWindow based on desktop.
-        Window desktopAsStormWindow = None;
-        if (strncmp(getDesktopSession(), "LXDE", 4) == 0) {
-            desktopAsStormWindow = largest_window_with_name(
-                mGlobal.xdo, "^pcmanfm$");
-        }
-        if (!desktopAsStormWindow) {
-            desktopAsStormWindow = largest_window_with_name(
-            mGlobal.xdo, "^Desktop$");
-        }
-        if (!desktopAsStormWindow) {
-            desktopAsStormWindow = mGlobal.Rootwindow;
-        }
-        mGlobal.StormWindow = desktopAsStormWindow;
+        // Draw on the root window.
+        mGlobal.StormWindow = mGlobal.Rootwindow;
 
         printf("\n%splasmastorm:application: createStormWindow() "
             "Transparent click-thru StormWindow not available.%s\n\n",
@@ -141,6 +134,7 @@ void createStormWindow() {
     printf("%splasmastorm: createStormWindow() - "
         "StormWindow is visible.%s\n",
         COLOR_GREEN, COLOR_NORMAL);
+    markStartupPhase("StormWindow create & map wait");
 
     // Init screen size.
     initDisplayDimensions();
@@ -375,10 +369,11 @@ gboolean handleTransparentWindowDrawEvents(
 void setStormWindowScale() {
     float x = mGlobal.StormWindowWidth / 1000.0;
     float y = mGlobal.StormWindowHeight / 576.0;
+    const float newScale = (x < y) ? x : y;
 
-    if (x < y) {
-        mGlobal.WindowScale = x;
-    } else {
-        mGlobal.WindowScale = y;
+    // Scale observers size storm items & stars from WindowScale.
+    if (newScale != mGlobal.WindowScale) {
+        mGlobal.WindowScale = newScale;
+        notifyPrefChanged(PREF_SCALE);
     }
 }
@@ -29,6 +29,7 @@
 #include "plasmastorm.h"
 #include "utils.h"
 #include "Wind.h"
+#include "WindField.h"
 #include "Windows.h"
 
 
@@ -53,32 +54,34 @@ void initWindModule() {
         DO_LONG_WIND_EVENT_TIME, doLongWindEvent);
     addMethodToMainloop(PRIORITY_DEFAULT,
         DO_SHORT_WIND_EVENT_TIME, doShortWindEvent);
+    initWindField();
+
+    addPrefObserver(PREF_SHOW_WIND, respondToWindSettingsChanges);
+    addPrefObserver(PREF_WHIRL_FACTOR, respondToWindSettingsChanges);
+    addPrefObserver(PREF_WHIRL_TIMER, respondToWindSettingsChanges);
 }
 
 /** *********************************************************************
  ** This method ...
  **/
-void respondToWindSettingsChanges() {
-    //UIDO(ShowWind,
-    if (Flags.ShowWind != OldFlags.ShowWind) {
-        OldFlags.ShowWind = Flags.ShowWind;
-        mGlobal.Wind = 0;
-        mGlobal.NewWind = 0;
-        Flags.mHaveFlagsChanged++;
-    }
+void respondToWindSettingsChanges(PrefKey key) {
+    switch (key) {
+        case PREF_SHOW_WIND:
+            mGlobal.Wind = 0;
+            mGlobal.NewWind = 0;
+            resetWindField();
+            break;
 
-    //UIDO(WhirlFactor,
-    if (Flags.WhirlFactor != OldFlags.WhirlFactor) {
-        OldFlags.WhirlFactor = Flags.WhirlFactor;
-        setWindWhirlValue();
-        Flags.mHaveFlagsChanged++;
-    }
+        case PREF_WHIRL_FACTOR:
+            setWindWhirlValue();
+            break;
 
-    //UIDO(WhirlTimer,
-    if (Flags.WhirlTimer != OldFlags.WhirlTimer) {
-        OldFlags.WhirlTimer = Flags.WhirlTimer;
-        setWindWhirlTimers();
-        Flags.mHaveFlagsChanged++;
+        case PREF_WHIRL_TIMER:
+            setWindWhirlTimers();
+            break;
+
+        default:
+            break;
     }
 }
 
@@ -20,8 +20,10 @@
  */
 #pragma once
 
+#include "Prefs.h"
+
 extern void initWindModule();
-extern void respondToWindSettingsChanges();
+extern void respondToWindSettingsChanges(PrefKey);
 
 void setWindWhirlValue();
 void setWindWhirlTimers();
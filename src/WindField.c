@@ -0,0 +1,346 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gtk/gtk.h>
+
+#include "ClockHelper.h"
+#include "ColorCodes.h"
+#include "Prefs.h"
+#include "plasmastorm.h"
+#include "safeMalloc.h"
+#include "utils.h"
+#include "WindField.h"
+#include "Windows.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+
+// Grid node spacing in pixels at full CpuLoad. Lower CpuLoad
+// (larger cpufactor) coarsens the grid to save CPU.
+#define WIND_FIELD_CELL_SIZE 96
+#define WIND_FIELD_MIN_CELL_SIZE 64
+#define WIND_FIELD_MAX_CELL_SIZE 384
+
+// Gust noise: lattice cell size in grid cells, strength as a
+// fraction of windWhirlValue, and how fast it changes in place
+// (lattice cells / sec) as it drifts with the mean wind.
+#define WIND_NOISE_CELLS 3.0f
+#define WIND_NOISE_STRENGTH 0.35f
+#define WIND_NOISE_VERTICAL_STRENGTH 0.1f
+#define WIND_NOISE_EVOLVE_RATE 0.15f
+#define WIND_NOISE_WRAP 4096.0f
+
+#define MAX_WIND_WHIRLS 4
+
+typedef struct {
+    float x;
+    float y;
+} WindVector;
+
+typedef struct {
+    float x;
+    float y;
+    float radius;
+    float strength; // Peak spin speed, sign is the direction.
+    float age;
+    float lifetime;
+} WindWhirl;
+
+static WindVector* mWindField = NULL;
+static int mWindFieldColumns = 0;
+static int mWindFieldRows = 0;
+static int mWindFieldCellSize = 0;
+static float mWindFieldInverseCellSize = 0;
+
+static uint32_t mWindNoiseSeed;
+static float mWindNoiseOffset = 0;
+static float mWindNoiseTime = 0;
+
+static WindWhirl mWindWhirls[MAX_WIND_WHIRLS];
+static int mWindWhirlCount = 0;
+
+static double mPreviousWindFieldTime = 0;
+
+
+/** *********************************************************************
+ ** This method initializes the wind field & starts its updates.
+ **/
+void initWindField() {
+    mWindNoiseSeed = (uint32_t) (drand48() * UINT32_MAX);
+    mPreviousWindFieldTime = wallclock();
+
+    addMethodToMainloop(PRIORITY_DEFAULT,
+        DO_WIND_FIELD_EVENT_TIME, doWindFieldEvent);
+}
+
+/** *********************************************************************
+ ** This method calms the field, ie: when wind is switched off.
+ **/
+void resetWindField() {
+    mWindWhirlCount = 0;
+
+    if (mWindField) {
+        memset(mWindField, 0, sizeof(WindVector) *
+            mWindFieldColumns * mWindFieldRows);
+    }
+}
+
+/** *********************************************************************
+ ** This method (re)sizes the grid for the StormWindow & CPU budget.
+ ** Nodes sit on cell corners, so the far edges need one extra.
+ **/
+static void updateWindFieldSize() {
+    int cellSize = WIND_FIELD_CELL_SIZE * mGlobal.cpufactor;
+    if (cellSize < WIND_FIELD_MIN_CELL_SIZE) {
+        cellSize = WIND_FIELD_MIN_CELL_SIZE;
+    }
+    if (cellSize > WIND_FIELD_MAX_CELL_SIZE) {
+        cellSize = WIND_FIELD_MAX_CELL_SIZE;
+    }
+
+    const int columns = mGlobal.StormWindowWidth / cellSize + 2;
+    const int rows = mGlobal.StormWindowHeight / cellSize + 2;
+
+    if (mWindField && cellSize == mWindFieldCellSize &&
+        columns == mWindFieldColumns && rows == mWindFieldRows) {
+        return;
+    }
+
+    mWindField = (WindVector*) realloc(mWindField,
+        sizeof(WindVector) * columns * rows);
+    REALLOC_CHECK(mWindField);
+
+    mWindFieldCellSize = cellSize;
+    mWindFieldInverseCellSize = 1.0f / cellSize;
+    mWindFieldColumns = columns;
+    mWindFieldRows = rows;
+
+    printf("%splasmastorm: Wind field %dx%d, %d px cells.%s\n",
+        COLOR_BLUE, columns, rows, cellSize, COLOR_NORMAL);
+}
+
+/** *********************************************************************
+ ** Value noise helpers. Lattice values are hashed from their
+ ** coordinates, so moving the noise never regenerates anything.
+ **/
+static float getWindLatticeValue(int x, int y, int z) {
+    uint32_t hash = mWindNoiseSeed ^
+        ((uint32_t) x * 0x8da6b343u) ^
+        ((uint32_t) y * 0xd8163841u) ^
+        ((uint32_t) z * 0xcb1ab31fu);
+
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    hash *= 0x297a2d39u;
+    hash ^= hash >> 15;
+
+    return (hash & 0xffff) * (2.0f / 0xffff) - 1.0f;
+}
+
+static float getWindNoise(float x, float y, float z) {
+    const float x0 = floorf(x);
+    const float y0 = floorf(y);
+    const float z0 = floorf(z);
+
+    float fx = x - x0;
+    float fy = y - y0;
+    float fz = z - z0;
+    fx = fx * fx * (3 - 2 * fx);
+    fy = fy * fy * (3 - 2 * fy);
+    fz = fz * fz * (3 - 2 * fz);
+
+    const int ix = (int) x0;
+    const int iy = (int) y0;
+    const int iz = (int) z0;
+
+    float plane[2];
+    for (int k = 0; k < 2; k++) {
+        const float top =
+            getWindLatticeValue(ix, iy, iz + k) * (1 - fx) +
+            getWindLatticeValue(ix + 1, iy, iz + k) * fx;
+        const float bottom =
+            getWindLatticeValue(ix, iy + 1, iz + k) * (1 - fx) +
+            getWindLatticeValue(ix + 1, iy + 1, iz + k) * fx;
+        plane[k] = top * (1 - fy) + bottom * fy;
+    }
+
+    return plane[0] * (1 - fz) + plane[1] * fz;
+}
+
+/** *********************************************************************
+ ** This method ages, drifts & spawns whirls. At WhirlFactor 100
+ ** one starts every WhirlTimer seconds on average.
+ **/
+static void updateWindWhirls(float elapsed) {
+    for (int i = 0; i < mWindWhirlCount; ) {
+        WindWhirl* whirl = &mWindWhirls[i];
+
+        whirl->age += elapsed;
+        if (whirl->age >= whirl->lifetime) {
+            *whirl = mWindWhirls[--mWindWhirlCount];
+            continue;
+        }
+
+        whirl->x += mGlobal.NewWind * elapsed * 0.5f;
+        i++;
+    }
+
+    const float spawnChance = elapsed * Flags.WhirlFactor * 0.01f /
+        mGlobal.windWhirlTimerStart;
+    if (mWindWhirlCount >= MAX_WIND_WHIRLS || drand48() > spawnChance) {
+        return;
+    }
+
+    WindWhirl* whirl = &mWindWhirls[mWindWhirlCount++];
+    whirl->x = drand48() * mGlobal.StormWindowWidth;
+    whirl->y = drand48() * mGlobal.StormWindowHeight * 0.75;
+    whirl->radius = mGlobal.StormWindowHeight *
+        (0.08 + 0.12 * drand48());
+    whirl->strength = mGlobal.windWhirlValue * (0.5 + drand48()) *
+        (drand48() > 0.5 ? 1 : -1);
+    whirl->age = 0;
+    whirl->lifetime = mGlobal.windWhirlTimerStart *
+        (0.2 + 0.3 * drand48());
+}
+
+/** *********************************************************************
+ ** This method refreshes the wind field, once per tick for all
+ ** items.
+ **/
+int doWindFieldEvent() {
+    if (Flags.shutdownRequested) {
+        return false;
+    }
+
+    const double timeNow = wallclock();
+    float elapsed = timeNow - mPreviousWindFieldTime;
+    mPreviousWindFieldTime = timeNow;
+    if (elapsed > 0.5f) {
+        elapsed = 0.5f;
+    }
+
+    if (!WorkspaceActive() || !Flags.ShowWind) {
+        return true;
+    }
+
+    updateWindFieldSize();
+    updateWindWhirls(elapsed);
+
+    // Noise drifts downwind & slowly changes in place.
+    const float noiseCellSize = mWindFieldCellSize * WIND_NOISE_CELLS;
+    mWindNoiseOffset = fmodf(mWindNoiseOffset +
+        mGlobal.NewWind * elapsed / noiseCellSize, WIND_NOISE_WRAP);
+    mWindNoiseTime = fmodf(mWindNoiseTime +
+        WIND_NOISE_EVOLVE_RATE * elapsed, WIND_NOISE_WRAP);
+
+    const float noiseStrength = mGlobal.windWhirlValue *
+        WIND_NOISE_STRENGTH;
+    const float noiseVerticalStrength = mGlobal.windWhirlValue *
+        WIND_NOISE_VERTICAL_STRENGTH;
+
+    WindVector* node = mWindField;
+    for (int row = 0; row < mWindFieldRows; row++) {
+        const float y = row * mWindFieldCellSize;
+        const float noiseY = row / WIND_NOISE_CELLS;
+
+        for (int column = 0; column < mWindFieldColumns; column++) {
+            const float x = column * mWindFieldCellSize;
+            const float noiseX = column / WIND_NOISE_CELLS -
+                mWindNoiseOffset;
+
+            float windX = mGlobal.NewWind + noiseStrength *
+                getWindNoise(noiseX, noiseY, mWindNoiseTime);
+            float windY = noiseVerticalStrength *
+                getWindNoise(noiseX, noiseY + 512, mWindNoiseTime);
+
+            // Whirls spin around their center, fading in & out.
+            for (int i = 0; i < mWindWhirlCount; i++) {
+                const WindWhirl* whirl = &mWindWhirls[i];
+                const float dx = (x - whirl->x) / whirl->radius;
+                const float dy = (y - whirl->y) / whirl->radius;
+                const float distance = dx * dx + dy * dy;
+                if (distance > 9) {
+                    continue;
+                }
+
+                const float spin = whirl->strength * expf(-distance) *
+                    sinf(M_PI * whirl->age / whirl->lifetime);
+                windX -= dy * spin;
+                windY += dx * spin;
+            }
+
+            node->x = windX;
+            node->y = windY;
+            node++;
+        }
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** This method returns the wind at a StormWindow position, bilinear
+ ** between the four surrounding grid nodes.
+ **/
+void sampleWindField(float x, float y, float* windX, float* windY) {
+    if (!mWindField) {
+        *windX = mGlobal.NewWind;
+        *windY = 0;
+        return;
+    }
+
+    float gridX = x * mWindFieldInverseCellSize;
+    float gridY = y * mWindFieldInverseCellSize;
+
+    // Keep all four nodes in the grid.
+    const float maxGridX = mWindFieldColumns - 1.001f;
+    const float maxGridY = mWindFieldRows - 1.001f;
+    gridX = gridX < 0 ? 0 : (gridX > maxGridX ? maxGridX : gridX);
+    gridY = gridY < 0 ? 0 : (gridY > maxGridY ? maxGridY : gridY);
+
+    const int column = (int) gridX;
+    const int row = (int) gridY;
+    const float fx = gridX - column;
+    const float fy = gridY - row;
+
+    const WindVector* topLeft =
+        &mWindField[row * mWindFieldColumns + column];
+    const WindVector* bottomLeft = topLeft + mWindFieldColumns;
+
+    const float topX = topLeft[0].x + (topLeft[1].x - topLeft[0].x) * fx;
+    const float topY = topLeft[0].y + (topLeft[1].y - topLeft[0].y) * fx;
+    const float bottomX = bottomLeft[0].x +
+        (bottomLeft[1].x - bottomLeft[0].x) * fx;
+    const float bottomY = bottomLeft[0].y +
+        (bottomLeft[1].y - bottomLeft[0].y) * fx;
+
+    *windX = topX + (bottomX - topX) * fy;
+    *windY = topY + (bottomY - topY) * fy;
+}
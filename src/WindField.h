@@ -0,0 +1,39 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+
+
+/***********************************************************
+ * Wind field. A coarse grid of wind velocities over the
+ * StormWindow, refreshed every DO_WIND_FIELD_EVENT_TIME
+ * from the global gust state (mGlobal.NewWind), drifting
+ * value noise & short lived whirls. Items sample it where
+ * they are instead of all using mGlobal.NewWind.
+ */
+extern void initWindField();
+extern void resetWindField();
+
+int doWindFieldEvent();
+
+extern void sampleWindField(float x, float y,
+    float* windX, float* windY);
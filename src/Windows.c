@@ -22,6 +22,7 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 // X11 headers.
 #include <X11/Intrinsic.h>
@@ -37,14 +38,23 @@
 #include "ColorCodes.h"
 #include "Fallen.h"
 #include "Prefs.h"
+#include "hashTableHelper.h"
 #include "mygettext.h"
 #include "safeMalloc.h"
 #include "StormWindow.h"
 #include "utils.h"
 #include "Windows.h"
+#include "x11AtomHelper.h"
+#include "x11InputHelper.h"
+#include "x11RootHelper.h"
+#include "x11ScanHelper.h"
 #include "x11WindowHelper.h"
 #include "xdo.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_WINDOWS
+#include "x11Stats.h"
+
 
 /** *********************************************************************
  ** Module globals and consts.
@@ -63,10 +73,25 @@ Window mWindowBeingDragged = None;
 Window mActiveAppDragWindowCandidate = None;
 
 //**
-// Main WinInfo (Windows) list & helpers.
+// Main WinInfo (Windows) list & helpers. The list is a cache
+// kept current by X events: entries are added & removed as
+// _NET_CLIENT_LIST changes, and marked stale for a fresh probe
+// on Configure / Map / Unmap / Property events. A full resync
+// only happens on request or after an X11 error.
 static int mWinInfoListLength = 0;
+static int mWinInfoListCapacity = 0;
 static WinInfo* mWinInfoList = NULL;
 
+static bool mIsWinInfoListResyncNeeded = true;
+
+// Client properties a WinInfo probe depends on.
+static const X11AtomId WININFO_PROPERTY_ATOMS[] = {
+    X11_ATOM__NET_WM_STATE, X11_ATOM__NET_WM_DESKTOP,
+    X11_ATOM__WIN_WORKSPACE, X11_ATOM__NET_WM_WINDOW_TYPE,
+    X11_ATOM_WM_STATE, X11_ATOM__GTK_FRAME_EXTENTS,
+    X11_ATOM__NET_FRAME_EXTENTS };
+#define WININFO_PROPERTY_COUNT 7
+
 const int mWindowXOffset = 4; // magic
 const int mWindowWOffset = -8; // magic
 
@@ -133,6 +158,9 @@ int do_sendevent() {
 void udpateWorkspaceInfo() {
     mGlobal.visibleWorkspaceCount = 1;
     mGlobal.workspaceArray[0] = mGlobal.currentWS;
+
+    // Newly visible fallen may have redraws pending.
+    signalFallenThread();
 }
 
 /** *********************************************************************
@@ -158,9 +186,6 @@ void initDisplayDimensions() {
  ** This method ...
  **/
 void updateDisplayDimensions() {
-
-    lockFallenSemaphore();
-
     // Log & wait for StormWindow visibility.
     logCurrentTimestamp();
     printf("%splasmastorm: updateDisplayDimensions() - "
@@ -180,6 +205,10 @@ void updateDisplayDimensions() {
     XGetGeometry(mGlobal.display, mGlobal.StormWindow,
         &root, &x, &y, &w, &h, &b, &d);
 
+    // Only hold the fallen lock for the updates, never while waiting
+    // on the X server.
+    lockFallenSemaphore();
+
     mGlobal.StormWindowWidth = w;
     mGlobal.StormWindowHeight = h +
         Flags.DesktopFallenTopOffset;
@@ -203,11 +232,6 @@ int updateWindowsList() {
         return false;
     }
 
-    static int lockcounter = 0;
-    if (softLockFallenBaseSemaphore(3, &lockcounter)) {
-        return true;
-    }
-
     // Once in a while, we force updating windows.
     static int wcounter = 0;
     wcounter++;
@@ -216,13 +240,20 @@ int updateWindowsList() {
         wcounter = 0;
     }
     if (!mGlobal.windowsWereDraggedOrMapped) {
-        unlockFallenSemaphore();
+        return true;
+    }
+
+    sampleX11DisplayLockStall(mGlobal.display);
+
+    // Only now take the list exclusively.
+    static int lockcounter = 0;
+    if (softLockFallenBaseSemaphore(3, &lockcounter)) {
         return true;
     }
     mGlobal.windowsWereDraggedOrMapped = 0;
 
     // Update on Workspace change.
-    mGlobal.currentWS = getCurrentWorkspace();
+    mGlobal.currentWS = getCachedCurrentWorkspace();
 
     if (!mIsPreviousWSValueValid) {
         mIsPreviousWSValueValid = true;
@@ -242,11 +273,11 @@ int updateWindowsList() {
         return true;
     }
 
-    // Update windows list.
-    getWinInfoList();
-    for (int i = 0; i < mWinInfoListLength; i++) {
-        mWinInfoList[i].x += mGlobal.windowOffsetX - mGlobal.StormWindowX;
-        mWinInfoList[i].y += mGlobal.windowOffsetY - mGlobal.StormWindowY;
+    // Update windows list, only what changed.
+    if (mIsWinInfoListResyncNeeded) {
+        getWinInfoList();
+    } else {
+        refreshStaleWinInfoList();
     }
 
     updateFallenRegions();
@@ -259,10 +290,7 @@ int updateWindowsList() {
  ** This method returns the Active window (can be null.)
  **/
 Window getActiveX11Window() {
-    Window activeWindow = None;
-    getActiveWindowFromXDO(mGlobal.xdo, &activeWindow);
-
-    return activeWindow;
+    return getCachedActiveX11Window();
 }
 
 /** *********************************************************************
@@ -378,8 +406,11 @@ void onAppWindowChange(Window window) {
  ** This method handles X11 Windows being created.
  **/
 void onWindowCreated(XEvent* event) {
-    // Update our list to include the created one.
-    getWinInfoList();
+    parent_insert(event->xcreatewindow.window,
+        event->xcreatewindow.parent);
+
+    // New clients join our list through _NET_CLIENT_LIST,
+    // once the window manager has taken them on.
 
     // Is this a signature of a transient Plasma DRAG Window
     // being created? If not, early exit.
@@ -416,13 +447,89 @@ void onWindowCreated(XEvent* event) {
 /** *********************************************************************
  ** This method handles X11 Windows being reparented.
  **/
-void onWindowReparent(__attribute__((unused)) XEvent* event) {
+void onWindowReparent(XEvent* event) {
+    parent_insert(event->xreparent.window,
+        event->xreparent.parent);
+
+    // Client has a new frame, find it on next probe.
+    WinInfo* winInfoItem = findWinInfoByWindowId(
+        event->xreparent.window);
+    if (winInfoItem) {
+        winInfoItem->frame = None;
+    }
+
+    markWinInfoStale(event->xreparent.window);
 }
 
 /** *********************************************************************
  ** This method handles X11 Windows being moved, sized, changed.
  **/
-void onWindowChanged(__attribute__((unused)) XEvent* event) {
+void onWindowChanged(XEvent* event) {
+    markWinInfoStale(event->xconfigure.window);
+
+    // The active window moving or sizing with the button
+    // held is a drag, shake its fallen now.
+    if (isWindowBeingDragged() || !isX11PointerButtonHeld()) {
+        return;
+    }
+    const Window activeWindow = getActiveAppWindow();
+    if (activeWindow == None) {
+        return;
+    }
+    const WinInfo* activeWinInfo =
+        findWinInfoByWindowId(activeWindow);
+    if (event->xconfigure.window == activeWindow ||
+        (activeWinInfo && event->xconfigure.window ==
+            activeWinInfo->frame)) {
+        setIsWindowBeingDragged(true);
+        setWindowBeingDragged(activeWindow);
+        removeFallenFromWindow(activeWindow);
+    }
+}
+
+/** *********************************************************************
+ ** This method handles X11 Window property changes, on the root
+ ** window (client list, desktop) or on clients (state, extents).
+ **/
+void onWindowPropertyChanged(XEvent* event) {
+    const Window window = event->xproperty.window;
+    const Atom atom = event->xproperty.atom;
+
+    if (window != mGlobal.Rootwindow) {
+        for (int i = 0; i < WININFO_PROPERTY_COUNT; i++) {
+            if (atom == getX11Atom(WININFO_PROPERTY_ATOMS[i])) {
+                markWinInfoStale(window);
+                break;
+            }
+        }
+        return;
+    }
+
+    // Refetch the root value, only when it's one of ours.
+    if (!updateX11RootCache(atom)) {
+        return;
+    }
+
+    if (atom == X11_ATOM(_NET_CLIENT_LIST) ||
+        atom == X11_ATOM(_WIN_CLIENT_LIST)) {
+        updateWinInfoListClients();
+        mGlobal.windowsWereDraggedOrMapped++;
+        return;
+    }
+
+    // Every window's hidden state depends on it.
+    if (atom == X11_ATOM(_NET_SHOWING_DESKTOP)) {
+        for (int i = 0; i < mWinInfoListLength; i++) {
+            mWinInfoList[i].stale = true;
+        }
+        mGlobal.windowsWereDraggedOrMapped++;
+        return;
+    }
+
+    if (atom == X11_ATOM(_NET_CURRENT_DESKTOP) ||
+        atom == X11_ATOM(_WIN_WORKSPACE)) {
+        mGlobal.windowsWereDraggedOrMapped++;
+    }
 }
 
 /** *********************************************************************
@@ -432,15 +539,18 @@ void onWindowChanged(__attribute__((unused)) XEvent* event) {
  **/
 void onWindowMapped(XEvent* event) {
     // Update our list for visibility change.
-    getWinInfoList();
+    markWinInfoStale(event->xmap.window);
 
     // Determine window drag state.
     if (!isWindowBeingDragged()) {
         if (isMouseClickedAndHeldInWindow(
             event->xmap.window)) {
             if (event->xmap.window != None) {
-                const Window focusedWindow =
-                    getFocusedX11Window();
+                // Active window is cached, focus is a round trip.
+                Window focusedWindow = getActiveX11Window();
+                if (focusedWindow == None) {
+                    focusedWindow = getFocusedX11Window();
+                }
                 if (focusedWindow != None) {
                     const Window dragWindow =
                         getDragWindowOf(focusedWindow);
@@ -503,9 +613,9 @@ void onWindowBlurred(__attribute__((unused)) XEvent* event) {
  **
  ** Our main job is to clear window drag state.
  **/
-void onWindowUnmapped(__attribute__((unused)) XEvent* event) {
+void onWindowUnmapped(XEvent* event) {
     // Update our list for visibility change.
-    getWinInfoList();
+    markWinInfoStale(event->xunmap.window);
 
     // Clear window drag state.
     if (isWindowBeingDragged()) {
@@ -516,9 +626,10 @@ void onWindowUnmapped(__attribute__((unused)) XEvent* event) {
 /** *********************************************************************
  ** This method handles X11 Windows being destroyed.
  **/
-void onWindowDestroyed(__attribute__((unused)) XEvent* event) {
+void onWindowDestroyed(XEvent* event) {
     // Update our list to reflect the destroyed one.
-    getWinInfoList();
+    removeWinInfo(event->xdestroywindow.window);
+    parent_erase(event->xdestroywindow.window);
 
     // Clear window drag state.
     if (isWindowBeingDragged()) {
@@ -528,34 +639,23 @@ void onWindowDestroyed(__attribute__((unused)) XEvent* event) {
 
 /** *********************************************************************
  ** This method decides if the user ia dragging a window via a mouse
- ** click-and-hold on the titlebar.
+ ** click-and-hold on the titlebar. Button state is tracked from
+ ** XInput2 raw events, see x11InputHelper.c.
  **/
-bool isMouseClickedAndHeldInWindow(Window window) {
-    // printf("%sApplication: isMouseClickedAndHeldInWindow() "
-    //     "Starts.%s\n", COLOR_YELLOW, COLOR_NORMAL);
-
-    //  Find the focused window pointer click state.
-    Window root_return, child_return;
-    int root_x_return, root_y_return;
-    int win_x_return, win_y_return;
-    unsigned int pointerState;
-
-    bool foundPointerState = XQueryPointer(
-        mGlobal.display, window,
-        &root_return, &child_return,
-        &root_x_return, &root_y_return,
-        &win_x_return, &win_y_return,
-        &pointerState);
-
-    // If click-state is clicked-down, we're dragging.
-    const unsigned int POINTER_CLICKDOWN = 256;
-    const bool result = foundPointerState &&
-        (pointerState & POINTER_CLICKDOWN);
-
-    // printf("%sApplication: isMouseClickedAndHeldInWindow() "
-    //     "Finishes.%s\n", COLOR_YELLOW, COLOR_NORMAL);
+bool isMouseClickedAndHeldInWindow(__attribute__((unused))
+    Window window) {
+    return isX11PointerButtonHeld();
+}
 
-    return result;
+/** *********************************************************************
+ ** This method handles the primary pointer button being released,
+ ** ending any window drag.
+ **/
+void onPointerButtonReleased() {
+    if (isWindowBeingDragged()) {
+        clearAllDragFields();
+        mGlobal.windowsWereDraggedOrMapped++;
+    }
 }
 
 /** *********************************************************************
@@ -593,34 +693,39 @@ void setActiveAppDragWindowCandidate(Window candidate) {
  ** This method determines which window is being dragged on user
  ** click and hold window. Returns self or ancestor whose Window
  ** is in mWinInfoList (visible window on screen).
+ **
+ ** Parents come from the cache kept by Create & Reparent events,
+ ** only unknown links cost an XQueryTree, remembered after.
  **/
 Window getDragWindowOf(Window window) {
-
     Window windowNode = window;
-    while (true) {
+    while (windowNode != None &&
+        windowNode != mGlobal.Rootwindow) {
         // Is current node in windows list?
-        WinInfo* windowListItem = mWinInfoList;
-        for (int i = 0; i < mWinInfoListLength; i++) {
-            if (windowNode == windowListItem->window) {
-                return windowNode;
-            }
-            windowListItem++;
+        if (findWinInfoByWindowId(windowNode)) {
+            return windowNode;
         }
 
         // If not in list, move up to parent and loop.
-        Window root, parent;
-        Window* children = NULL;
-        unsigned int windowChildCount;
-        if (!(XQueryTree(mGlobal.display, windowNode,
-                &root, &parent, &children, &windowChildCount))) {
-            return None;
-        }
-        if (children) {
-            XFree((char *) children);
+        Window parent = parent_get(windowNode);
+        if (parent == None) {
+            Window root;
+            Window* children = NULL;
+            unsigned int windowChildCount;
+            if (!(XQueryTree(mGlobal.display, windowNode,
+                    &root, &parent, &children, &windowChildCount))) {
+                return None;
+            }
+            if (children) {
+                XFree((char *) children);
+            }
+            parent_insert(windowNode, parent);
         }
 
         windowNode = parent;
     }
+
+    return None;
 }
 
 /** *********************************************************************
@@ -685,13 +790,182 @@ void logWindowAndAllParents(Window window) {
 
 /** *********************************************************************
  ** This method frees existing list, and refreshes it.
+ ** The full resync, see refreshStaleWinInfoList().
  **/
 void getWinInfoList() {
     if (mWinInfoList) {
         free(mWinInfoList);
     }
 
+    refreshX11RootCache();
     getX11WindowsList(&mWinInfoList, &mWinInfoListLength);
+    mWinInfoListCapacity = mWinInfoListLength;
+    mIsWinInfoListResyncNeeded = false;
+
+    for (int i = 0; i < mWinInfoListLength; i++) {
+        applyWinInfoOffsets(&mWinInfoList[i]);
+        selectWinInfoEvents(mWinInfoList[i].window);
+    }
+}
+
+/** *********************************************************************
+ ** This method asks for a full resync on the next update,
+ ** after an X11 error may have left the cache behind.
+ **/
+void requestWinInfoListResync() {
+    mIsWinInfoListResyncNeeded = true;
+    mGlobal.windowsWereDraggedOrMapped++;
+}
+
+/** *********************************************************************
+ ** This method asks for the client events that change a WinInfo.
+ ** Frame moves arrive through the root SubstructureNotify.
+ **/
+void selectWinInfoEvents(Window window) {
+    if (window == mGlobal.StormWindow) {
+        return;
+    }
+
+    XSelectInput(mGlobal.display, window,
+        StructureNotifyMask | PropertyChangeMask);
+}
+
+/** *********************************************************************
+ ** This method moves a probed WinInfo into StormWindow space.
+ **/
+void applyWinInfoOffsets(WinInfo* winInfoItem) {
+    winInfoItem->x += mGlobal.windowOffsetX - mGlobal.StormWindowX;
+    winInfoItem->y += mGlobal.windowOffsetY - mGlobal.StormWindowY;
+}
+
+/** *********************************************************************
+ ** This method marks the WinInfo of a client, or of its frame,
+ ** for a fresh probe on the next update.
+ **/
+void markWinInfoStale(Window window) {
+    for (int i = 0; i < mWinInfoListLength; i++) {
+        if (mWinInfoList[i].window == window ||
+            mWinInfoList[i].frame == window) {
+            mWinInfoList[i].stale = true;
+            mGlobal.windowsWereDraggedOrMapped++;
+            return;
+        }
+    }
+}
+
+/** *********************************************************************
+ ** This method appends an unprobed WinInfo for a new client.
+ **/
+void addWinInfo(Window window) {
+    if (mWinInfoListLength == mWinInfoListCapacity) {
+        mWinInfoListCapacity = (mWinInfoListCapacity > 0) ?
+            2 * mWinInfoListCapacity : 16;
+        mWinInfoList = (WinInfo*) realloc(mWinInfoList,
+            mWinInfoListCapacity * sizeof(WinInfo));
+        REALLOC_CHECK(mWinInfoList);
+    }
+
+    WinInfo* winInfoItem = &mWinInfoList[mWinInfoListLength++];
+    memset(winInfoItem, 0, sizeof(WinInfo));
+    winInfoItem->window = window;
+    winInfoItem->state = WINDOW_STATE_HIDDEN;
+    winInfoItem->stale = true;
+
+    selectWinInfoEvents(window);
+}
+
+/** *********************************************************************
+ ** These methods drop a WinInfo, keeping list order. By Window,
+ ** the client or its frame.
+ **/
+static void removeWinInfoAt(int index) {
+    memmove(&mWinInfoList[index], &mWinInfoList[index + 1],
+        (mWinInfoListLength - index - 1) * sizeof(WinInfo));
+    mWinInfoListLength--;
+    mGlobal.windowsWereDraggedOrMapped++;
+}
+
+void removeWinInfo(Window window) {
+    for (int i = 0; i < mWinInfoListLength; i++) {
+        if (mWinInfoList[i].window == window ||
+            mWinInfoList[i].frame == window) {
+            removeWinInfoAt(i);
+            return;
+        }
+    }
+}
+
+/** *********************************************************************
+ ** This method applies a _NET_CLIENT_LIST change from the root
+ ** cache, adding or removing only the entries that changed.
+ **/
+void updateWinInfoListClients() {
+    const Window* clients;
+    const int clientCount = getCachedX11ClientWindows(&clients);
+
+    // Drop WinInfos no longer listed.
+    for (int i = mWinInfoListLength - 1; i >= 0; i--) {
+        bool isListed = false;
+        for (int j = 0; j < clientCount; j++) {
+            if (clients[j] == mWinInfoList[i].window) {
+                isListed = true;
+                break;
+            }
+        }
+        if (!isListed) {
+            removeWinInfoAt(i);
+        }
+    }
+
+    // Add new clients, probed on next update.
+    for (int j = 0; j < clientCount; j++) {
+        if (!findWinInfoByWindowId(clients[j])) {
+            addWinInfo(clients[j]);
+        }
+    }
+}
+
+/** *********************************************************************
+ ** This method probes only stale WinInfos, all in one pipelined
+ ** scan, dropping any whose window has gone away.
+ **/
+void refreshStaleWinInfoList() {
+    int staleCount = 0;
+    for (int i = 0; i < mWinInfoListLength; i++) {
+        staleCount += mWinInfoList[i].stale;
+    }
+    if (staleCount == 0) {
+        return;
+    }
+
+    WinInfo** staleItems = (WinInfo**)
+        malloc(staleCount * sizeof(WinInfo*));
+    MALLOC_CHECK(staleItems);
+    bool* isAlive = (bool*) malloc(staleCount * sizeof(bool));
+    MALLOC_CHECK(isAlive);
+
+    int k = 0;
+    for (int i = 0; i < mWinInfoListLength; i++) {
+        if (mWinInfoList[i].stale) {
+            mWinInfoList[i].stale = false;
+            staleItems[k++] = &mWinInfoList[i];
+        }
+    }
+    scanX11WindowInfos(mGlobal.display, mGlobal.Rootwindow,
+        mGlobal.StormWindow, isCachedShowingDesktop(),
+        staleItems, staleCount, isAlive);
+
+    // Offsets, then drop the dead back to front.
+    for (k = staleCount - 1; k >= 0; k--) {
+        if (isAlive[k]) {
+            applyWinInfoOffsets(staleItems[k]);
+        } else {
+            removeWinInfoAt(staleItems[k] - mWinInfoList);
+        }
+    }
+
+    free(isAlive);
+    free(staleItems);
 }
 
 /** *********************************************************************
@@ -763,8 +1037,13 @@ void updateFallenRegions() {
     for (int i = 0; i < mWinInfoListLength; i++) {
         fallen = findFallenItemByWindow(mGlobal.FallenFirst, addWin->window);
         if (fallen) {
+            const bool wasVisible = isFallenVisible(fallen);
             fallen->winInfo = *addWin;
-            if ((!fallen->winInfo.sticky) &&
+            if (!wasVisible && isFallenVisible(fallen) &&
+                fallen->isDirty) {
+                signalFallenThread();
+            }
+            if (!(fallen->winInfo.state & WINDOW_STATE_STICKY) &&
                 fallen->winInfo.ws != mGlobal.currentWS) {
                 eraseFallenOnDisplay(fallen, 0, fallen->w);
             }
@@ -776,7 +1055,7 @@ void updateFallenRegions() {
         // and also not if this window is a "dock"
         if (!fallen) {
             if (addWin->window != mGlobal.StormWindow &&
-                addWin->y > 0 && !(addWin->dock)) {
+                addWin->y > 0 && !(addWin->state & WINDOW_STATE_DOCK)) {
                 if ((int) (addWin->w) == mGlobal.StormWindowWidth &&
                     addWin->x == 0 && addWin->y < 100) {
                     continue;
@@ -816,7 +1095,7 @@ void updateFallenRegions() {
     while (fallen) {
         if (fallen->winInfo.window != None) {
             // Test if fallen->winInfo.window is hidden.
-            if (fallen->winInfo.hidden) {
+            if (fallen->winInfo.state & WINDOW_STATE_HIDDEN) {
                 eraseFallenOnDisplay(fallen, 0, fallen->w);
                 generateFallenStormItems(fallen, 0, fallen->w, -10.0);
                 toremove[ntoremove++] = fallen->winInfo.window;
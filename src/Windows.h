@@ -38,13 +38,21 @@ void updateDisplayDimensions(void);
 void SetBackground(void);
 
 void getWinInfoList();
+void requestWinInfoListResync();
+
+void selectWinInfoEvents(Window);
+void applyWinInfoOffsets(WinInfo*);
+
+void markWinInfoStale(Window);
+void addWinInfo(Window);
+void removeWinInfo(Window);
+
+void updateWinInfoListClients();
+void refreshStaleWinInfoList();
 
 /***********************************************************
  * Externally provided to this Module.
  */
-bool is_NET_WM_STATE_Hidden(Window window);
-bool is_WM_STATE_Hidden(Window window);
-
 void uninitQPickerDialog();
 
 
@@ -84,6 +92,7 @@ extern void onAppWindowChange(Window);
 extern void onWindowCreated(XEvent*);
 extern void onWindowReparent(XEvent*);
 extern void onWindowChanged(XEvent*);
+extern void onWindowPropertyChanged(XEvent*);
 
 extern void onWindowMapped(XEvent*);
 extern void onWindowFocused(XEvent*);
@@ -91,6 +100,7 @@ extern void onWindowBlurred(XEvent*);
 extern void onWindowUnmapped(XEvent*);
 
 extern void onWindowDestroyed(XEvent*);
+extern void onPointerButtonReleased();
 
 //**
 // Windows life-cycle helper methods.
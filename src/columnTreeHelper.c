@@ -0,0 +1,231 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <limits.h>
+#include <stdlib.h>
+
+#include "columnTreeHelper.h"
+#include "safeMalloc.h"
+
+
+/** *********************************************************************
+ ** This method creates a tree summarizing width heights.
+ **/
+ColumnTree* createColumnTree(const short int* heights, int width) {
+    ColumnTree* tree = (ColumnTree*) malloc(sizeof(ColumnTree));
+    MALLOC_CHECK(tree);
+
+    tree->width = width;
+    tree->size = 1;
+    while (tree->size < width) {
+        tree->size *= 2;
+    }
+
+    tree->maxHeights = (short int*) malloc(
+        2 * tree->size * sizeof(short int));
+    MALLOC_CHECK(tree->maxHeights);
+    tree->minHeights = (short int*) malloc(
+        2 * tree->size * sizeof(short int));
+    MALLOC_CHECK(tree->minHeights);
+
+    // Padding never wins a max or min.
+    for (int i = width; i < tree->size; i++) {
+        tree->maxHeights[tree->size + i] = SHRT_MIN;
+        tree->minHeights[tree->size + i] = SHRT_MAX;
+    }
+
+    rebuildColumnTree(tree, heights);
+    return tree;
+}
+
+/** *********************************************************************
+ ** This method frees a tree.
+ **/
+void destroyColumnTree(ColumnTree* tree) {
+    if (!tree) {
+        return;
+    }
+
+    free(tree->maxHeights);
+    free(tree->minHeights);
+    free(tree);
+}
+
+/** *********************************************************************
+ ** This method recomputes a parent node from its children.
+ **/
+static inline void updateColumnTreeNode(ColumnTree* tree, int node) {
+    const short int* maxHeights = tree->maxHeights;
+    const short int* minHeights = tree->minHeights;
+
+    tree->maxHeights[node] = (maxHeights[2 * node] > maxHeights[2 * node + 1]) ?
+        maxHeights[2 * node] : maxHeights[2 * node + 1];
+    tree->minHeights[node] = (minHeights[2 * node] < minHeights[2 * node + 1]) ?
+        minHeights[2 * node] : minHeights[2 * node + 1];
+}
+
+/** *********************************************************************
+ ** This method reloads every leaf, O(w).
+ **/
+void rebuildColumnTree(ColumnTree* tree, const short int* heights) {
+    for (int i = 0; i < tree->width; i++) {
+        tree->maxHeights[tree->size + i] = heights[i];
+        tree->minHeights[tree->size + i] = heights[i];
+    }
+
+    for (int node = tree->size - 1; node >= 1; node--) {
+        updateColumnTreeNode(tree, node);
+    }
+}
+
+/** *********************************************************************
+ ** This method reloads leaves first .. last - 1 & their ancestors,
+ ** one tree level at a time, O(range + log w).
+ **/
+void updateColumnTreeRange(ColumnTree* tree,
+    const short int* heights, int first, int last) {
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > tree->width) {
+        last = tree->width;
+    }
+    if (first >= last) {
+        return;
+    }
+
+    for (int i = first; i < last; i++) {
+        tree->maxHeights[tree->size + i] = heights[i];
+        tree->minHeights[tree->size + i] = heights[i];
+    }
+
+    int lowNode = (tree->size + first) / 2;
+    int highNode = (tree->size + last - 1) / 2;
+    while (lowNode >= 1) {
+        for (int node = lowNode; node <= highNode; node++) {
+            updateColumnTreeNode(tree, node);
+        }
+        lowNode /= 2;
+        highNode /= 2;
+    }
+}
+
+/** *********************************************************************
+ ** These methods return the max / min height over first .. last - 1.
+ **/
+short int getColumnTreeMax(ColumnTree* tree, int first, int last) {
+    short int result = SHRT_MIN;
+
+    int low = tree->size + ((first < 0) ? 0 : first);
+    int high = tree->size + ((last > tree->width) ? tree->width : last);
+    while (low < high) {
+        if (low & 1) {
+            if (tree->maxHeights[low] > result) {
+                result = tree->maxHeights[low];
+            }
+            low++;
+        }
+        if (high & 1) {
+            high--;
+            if (tree->maxHeights[high] > result) {
+                result = tree->maxHeights[high];
+            }
+        }
+        low /= 2;
+        high /= 2;
+    }
+
+    return result;
+}
+
+short int getColumnTreeMin(ColumnTree* tree, int first, int last) {
+    short int result = SHRT_MAX;
+
+    int low = tree->size + ((first < 0) ? 0 : first);
+    int high = tree->size + ((last > tree->width) ? tree->width : last);
+    while (low < high) {
+        if (low & 1) {
+            if (tree->minHeights[low] < result) {
+                result = tree->minHeights[low];
+            }
+            low++;
+        }
+        if (high & 1) {
+            high--;
+            if (tree->minHeights[high] < result) {
+                result = tree->minHeights[high];
+            }
+        }
+        low /= 2;
+        high /= 2;
+    }
+
+    return result;
+}
+
+/** *********************************************************************
+ ** This method is the descent for findFirstColumnAbove(). Subtrees
+ ** whose max can't beat threshold are skipped whole, and a subtree
+ ** inside the range whose min beats it answers immediately.
+ **/
+static int findFirstColumnAboveInNode(ColumnTree* tree, int node,
+    int nodeFirst, int nodeLast, int first, int last, int threshold) {
+
+    if (nodeLast <= first || nodeFirst >= last ||
+        tree->maxHeights[node] <= threshold) {
+        return -1;
+    }
+
+    if (nodeFirst >= first && tree->minHeights[node] > threshold) {
+        return nodeFirst;
+    }
+
+    if (nodeLast - nodeFirst == 1) {
+        return nodeFirst;
+    }
+
+    const int middle = (nodeFirst + nodeLast) / 2;
+    const int result = findFirstColumnAboveInNode(tree, 2 * node,
+        nodeFirst, middle, first, last, threshold);
+
+    return (result >= 0) ? result :
+        findFirstColumnAboveInNode(tree, 2 * node + 1,
+            middle, nodeLast, first, last, threshold);
+}
+
+/** *********************************************************************
+ ** This method returns the first column in first .. last - 1 whose
+ ** height is above threshold, or -1 if there's none.
+ **/
+int findFirstColumnAbove(ColumnTree* tree, int first, int last,
+    int threshold) {
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > tree->width) {
+        last = tree->width;
+    }
+    if (first >= last) {
+        return -1;
+    }
+
+    return findFirstColumnAboveInNode(tree, 1, 0, tree->size,
+        first, last, threshold);
+}
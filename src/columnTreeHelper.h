@@ -0,0 +1,52 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+/***********************************************************
+ * Min / max tree over an array of column heights.
+ *
+ * Leaves are padded up to a power of two; node 1 is the root
+ * and node n has children 2n and 2n+1.
+ */
+typedef struct _ColumnTree {
+    int width;               // real columns.
+    int size;                // leaves, power of two >= width.
+
+    short int* maxHeights;   // 2 * size nodes.
+    short int* minHeights;   // 2 * size nodes.
+} ColumnTree;
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern ColumnTree* createColumnTree(const short int* heights,
+    int width);
+extern void destroyColumnTree(ColumnTree*);
+
+extern void rebuildColumnTree(ColumnTree*, const short int* heights);
+extern void updateColumnTreeRange(ColumnTree*,
+    const short int* heights, int first, int last);
+
+extern short int getColumnTreeMax(ColumnTree*, int first, int last);
+extern short int getColumnTreeMin(ColumnTree*, int first, int last);
+extern int findFirstColumnAbove(ColumnTree*, int first, int last,
+    int threshold);
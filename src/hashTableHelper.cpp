@@ -71,6 +71,15 @@ extern "C" {
 
     void set_clear() { myset.clear(); }
 
+    // Make room for count more keys at once.
+    void set_reserve(unsigned int count) {
+#ifdef HAVE_UNORDERED_SET
+        myset.reserve(myset.size() + count);
+#else
+        (void) count;
+#endif
+    }
+
     /* example:
      *    set_begin();
      *    void *p;
@@ -92,3 +101,21 @@ extern "C" {
 
     unsigned int set_size() { return myset.size(); }
 }
+
+// Window parent chain, 0 when unknown.
+static MAP<unsigned long, unsigned long> parents;
+
+extern "C" {
+    void parent_insert(unsigned long window, unsigned long parent) {
+        parents[window] = parent;
+    }
+
+    unsigned long parent_get(unsigned long window) {
+        MAP<unsigned long, unsigned long>::iterator it =
+            parents.find(window);
+        return (it == parents.end()) ? 0 : it->second;
+    }
+
+    void parent_erase(unsigned long window) { parents.erase(window); }
+    void parent_clear() { parents.clear(); }
+}
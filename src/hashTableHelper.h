@@ -31,10 +31,16 @@ extern void set_insert(void *key);
 extern void set_erase(void *key);
 extern int set_count(void *key);
 extern void set_clear(void);
+extern void set_reserve(unsigned int count);
 extern void set_begin(void);
 extern void *set_next(void);
 extern unsigned int set_size(void);
 
+extern void parent_insert(unsigned long window, unsigned long parent);
+extern unsigned long parent_get(unsigned long window);
+extern void parent_erase(unsigned long window);
+extern void parent_clear(void);
+
 #ifdef __cplusplus
 }
 #endif
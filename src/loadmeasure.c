@@ -19,12 +19,17 @@
 #-# 
 */
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
 
 #include <gtk/gtk.h>
 
+#include "Application.h"
 #include "ClockHelper.h"
+#include "ColorCodes.h"
 #include "loadmeasure.h"
 #include "MainWindow.h"
 #include "plasmastorm.h"
@@ -51,6 +56,50 @@ int mLoadPressure = 0;
 int mWarningCount = 0;
 double mPreviousTime = 0;
 
+// Governor budget, percent of one core at CpuLoad 100. The CpuLoad
+// slider scales it.
+#define QUALITY_CPU_BUDGET_PCT 5.0
+
+// Hysteresis: raise the level after this many governor ticks over
+// budget, drop it after this many well under, & hold any new level
+// a few ticks so its effect shows before the next decision.
+#define QUALITY_RAISE_USAGE 1.0
+#define QUALITY_DROP_USAGE 0.6
+#define QUALITY_RAISE_TICKS 2
+#define QUALITY_DROP_TICKS 5
+#define QUALITY_HOLD_TICKS 3
+
+typedef struct {
+    float itemScale;           // StormItemCountMax & spawn rate.
+    float blowoffScale;        // Detail, blown off items.
+    float fallenIntervalScale; // Fallen redraw batch window.
+    float frameTimeScale;      // StormWindow draw period.
+} QualityLevel;
+
+static const QualityLevel mQualityLevels[] = {
+    { 1.00, 1.00, 1.0, 1.00 },
+    { 0.80, 0.75, 1.5, 1.00 },
+    { 0.60, 0.50, 2.0, 1.25 },
+    { 0.45, 0.25, 2.5, 1.50 },
+    { 0.30, 0.00, 3.0, 2.00 },
+};
+#define QUALITY_LEVEL_MAX ((int) (sizeof(mQualityLevels) / \
+    sizeof(mQualityLevels[0])) - 1)
+
+// Read by the fallen thread, so accessed atomically.
+static int mQualityLevel = 0;
+
+static uint64_t mLoadCostNanoseconds[LOAD_COST_COUNT];
+static uint64_t mLoadCostCount[LOAD_COST_COUNT];
+
+static LoadGovernorStats mGovernorStats;
+static double mGovernorPreviousTime = 0;
+static double mGovernorPreviousCpuTime = 0;
+
+static int mOverBudgetTicks = 0;
+static int mUnderBudgetTicks = 0;
+static int mHoldTicks = 0;
+
 
 /** *********************************************************************
  ** Add update method to mainloop.
@@ -58,6 +107,8 @@ double mPreviousTime = 0;
 void addLoadMonitorToMainloop() {
     addMethodToMainloop(PRIORITY_DEFAULT,
         DO_LOAD_MONITOR_EVENT_TIME, updateLoadMonitor);
+    addMethodToMainloop(PRIORITY_DEFAULT,
+        DO_QUALITY_GOVERNOR_EVENT_TIME, updateQualityGovernor);
 }
 
 /** *********************************************************************
@@ -99,3 +150,181 @@ int updateLoadMonitor() {
     // Pressure normal.
     return true;
 }
+
+/** *********************************************************************
+ ** Phase cost helpers. Physics is timed per storm item, so it uses
+ ** the cheap monotonic clock; fallen & render are timed once per
+ ** frame on their own thread, so they get true thread CPU time.
+ **/
+static uint64_t getLoadCostClock(LoadCost cost) {
+    struct timespec now;
+    clock_gettime(cost == LOAD_COST_PHYSICS ?
+        CLOCK_MONOTONIC : CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+uint64_t startLoadCost(LoadCost cost) {
+    return getLoadCostClock(cost);
+}
+
+void endLoadCost(LoadCost cost, uint64_t startTime) {
+    __atomic_fetch_add(&mLoadCostNanoseconds[cost],
+        getLoadCostClock(cost) - startTime, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&mLoadCostCount[cost], 1, __ATOMIC_RELAXED);
+}
+
+/** *********************************************************************
+ ** This method moves to a new quality level & applies the part of
+ ** it that isn't read live, the draw period.
+ **/
+static void setQualityLevel(int level) {
+    const int previousLevel = mQualityLevel;
+    __atomic_store_n(&mQualityLevel, level, __ATOMIC_RELAXED);
+
+    mGovernorStats.qualityLevel = level;
+    if (level > previousLevel) {
+        mGovernorStats.levelRaises++;
+    } else {
+        mGovernorStats.levelDrops++;
+    }
+
+    mOverBudgetTicks = 0;
+    mUnderBudgetTicks = 0;
+    mHoldTicks = QUALITY_HOLD_TICKS;
+
+    printf("%splasmastorm: Quality level %d -> %d, CPU %.1f%% of "
+        "%.1f%% budget.%s\n", level > previousLevel ?
+        COLOR_YELLOW : COLOR_GREEN, previousLevel, level,
+        mGovernorStats.cpuPercent, mGovernorStats.budgetPercent,
+        COLOR_NORMAL);
+
+    if (mQualityLevels[level].frameTimeScale !=
+        mGlobal.frameTimeScale) {
+        mGlobal.frameTimeScale = mQualityLevels[level].frameTimeScale;
+        addWindowDrawMethodToMainloop();
+    }
+}
+
+/** *********************************************************************
+ ** Periodically measure what we cost & steer the quality level.
+ **/
+int updateQualityGovernor() {
+    if (Flags.shutdownRequested) {
+        return false;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double cpuTime =
+        usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+
+    const double timeNow = wallclock();
+    const double elapsedTime = timeNow - mGovernorPreviousTime;
+    const double cpuElapsedTime = cpuTime - mGovernorPreviousCpuTime;
+    mGovernorPreviousTime = timeNow;
+    mGovernorPreviousCpuTime = cpuTime;
+
+    // Take the phase costs for this window.
+    uint64_t costNanoseconds[LOAD_COST_COUNT];
+    uint64_t costCount[LOAD_COST_COUNT];
+    for (int i = 0; i < LOAD_COST_COUNT; i++) {
+        costNanoseconds[i] = __atomic_exchange_n(
+            &mLoadCostNanoseconds[i], 0, __ATOMIC_RELAXED);
+        costCount[i] = __atomic_exchange_n(
+            &mLoadCostCount[i], 0, __ATOMIC_RELAXED);
+    }
+
+    // First call, or back from suspend: nothing to judge.
+    if (elapsedTime <= 0 || elapsedTime >
+        10 * DO_QUALITY_GOVERNOR_EVENT_TIME) {
+        return true;
+    }
+
+    // Smoothed, one busy second shouldn't cost quality.
+    const double cpuPercent = 100 * cpuElapsedTime / elapsedTime;
+    mGovernorStats.cpuPercent = (mGovernorStats.cpuPercent > 0) ?
+        0.5 * (mGovernorStats.cpuPercent + cpuPercent) : cpuPercent;
+
+    mGovernorStats.budgetPercent = QUALITY_CPU_BUDGET_PCT *
+        ((Flags.CpuLoad > 0) ? Flags.CpuLoad : 100) * 0.01;
+    mGovernorStats.budgetUsage = mGovernorStats.cpuPercent /
+        mGovernorStats.budgetPercent;
+
+    mGovernorStats.physicsMsPerSecond =
+        costNanoseconds[LOAD_COST_PHYSICS] * 1e-6 / elapsedTime;
+    mGovernorStats.fallenMsPerFrame = costCount[LOAD_COST_FALLEN] ?
+        costNanoseconds[LOAD_COST_FALLEN] * 1e-6 /
+        costCount[LOAD_COST_FALLEN] : 0;
+    mGovernorStats.renderMsPerFrame = costCount[LOAD_COST_RENDER] ?
+        costNanoseconds[LOAD_COST_RENDER] * 1e-6 /
+        costCount[LOAD_COST_RENDER] : 0;
+
+    // Hysteresis.
+    if (mGovernorStats.budgetUsage > QUALITY_RAISE_USAGE) {
+        mOverBudgetTicks++;
+        mUnderBudgetTicks = 0;
+    } else if (mGovernorStats.budgetUsage < QUALITY_DROP_USAGE) {
+        mUnderBudgetTicks++;
+        mOverBudgetTicks = 0;
+    } else {
+        mOverBudgetTicks = 0;
+        mUnderBudgetTicks = 0;
+    }
+
+    if (mHoldTicks > 0) {
+        mHoldTicks--;
+        return true;
+    }
+
+    if (mOverBudgetTicks >= QUALITY_RAISE_TICKS &&
+        mQualityLevel < QUALITY_LEVEL_MAX) {
+        setQualityLevel(mQualityLevel + 1);
+    } else if (mUnderBudgetTicks >= QUALITY_DROP_TICKS &&
+        mQualityLevel > 0) {
+        setQualityLevel(mQualityLevel - 1);
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** Quality level getters, safe from any thread.
+ **/
+static const QualityLevel* getQualityLevel() {
+    return &mQualityLevels[__atomic_load_n(&mQualityLevel,
+        __ATOMIC_RELAXED)];
+}
+
+float getQualityItemScale() {
+    return getQualityLevel()->itemScale;
+}
+
+float getQualityBlowoffScale() {
+    return getQualityLevel()->blowoffScale;
+}
+
+float getQualityFallenIntervalScale() {
+    return getQualityLevel()->fallenIntervalScale;
+}
+
+/** *********************************************************************
+ ** Governor metrics.
+ **/
+void getLoadGovernorStats(LoadGovernorStats* stats) {
+    *stats = mGovernorStats;
+}
+
+void logLoadGovernorStats() {
+    printf("%splasmastorm: Quality level %d (raised %u, dropped %u), "
+        "CPU %.1f%% of %.1f%% budget (%.0f%%).%s\n", COLOR_BLUE,
+        mGovernorStats.qualityLevel, mGovernorStats.levelRaises,
+        mGovernorStats.levelDrops, mGovernorStats.cpuPercent,
+        mGovernorStats.budgetPercent,
+        100 * mGovernorStats.budgetUsage, COLOR_NORMAL);
+    printf("%splasmastorm: Physics %.2f ms/s, fallen %.2f ms/frame, "
+        "render %.2f ms/frame.%s\n", COLOR_BLUE,
+        mGovernorStats.physicsMsPerSecond,
+        mGovernorStats.fallenMsPerFrame,
+        mGovernorStats.renderMsPerFrame, COLOR_NORMAL);
+}
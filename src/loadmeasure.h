@@ -21,7 +21,49 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 extern void addLoadMonitorToMainloop(void);
 
 int updateLoadMonitor();
+
+
+/***********************************************************
+ * Quality governor. Measures what the app really costs,
+ * process CPU from getrusage() plus per phase timings,
+ * against a CPU budget & steps a quality level up or down
+ * with hysteresis. Level 0 is full quality.
+ */
+typedef enum {
+    LOAD_COST_PHYSICS,
+    LOAD_COST_FALLEN,
+    LOAD_COST_RENDER,
+
+    LOAD_COST_COUNT
+} LoadCost;
+
+typedef struct _LoadGovernorStats {
+    int qualityLevel;
+    double cpuPercent;
+    double budgetPercent;
+    double budgetUsage;
+
+    double physicsMsPerSecond;
+    double fallenMsPerFrame;
+    double renderMsPerFrame;
+
+    unsigned int levelRaises;
+    unsigned int levelDrops;
+} LoadGovernorStats;
+
+extern uint64_t startLoadCost(LoadCost);
+extern void endLoadCost(LoadCost, uint64_t startTime);
+
+int updateQualityGovernor();
+
+extern float getQualityItemScale();
+extern float getQualityBlowoffScale();
+extern float getQualityFallenIntervalScale();
+
+extern void getLoadGovernorStats(LoadGovernorStats*);
+extern void logLoadGovernorStats();
@@ -40,15 +40,17 @@
  * Timer consts.
  */
 #define DO_LOAD_MONITOR_EVENT_TIME 0.1
+#define DO_QUALITY_GOVERNOR_EVENT_TIME 1.0
 #define DO_DISPLAY_RECONFIGURATION_EVENT_TIME 0.5
-#define DO_HANDLE_X11_EVENT_TIME 0.1
-#define DO_UI_SETTINGS_UPDATES_EVENT_TIME 0.25
-#define DO_FALLEN_THREAD_EVENT_TIME 0.2
-#define DO_CAIRO_DRAW_EVENT_TIME (0.04 * mGlobal.cpufactor)
+#define DO_FALLEN_THREAD_EVENT_TIME 0.04
+#define DO_FALLEN_THREAD_MAX_LATENCY_TIME 0.50
+#define DO_CAIRO_DRAW_EVENT_TIME (0.04 * mGlobal.cpufactor * \
+    mGlobal.frameTimeScale)
 #define DO_STORMITEM_UPDATE_EVENT_TIME (0.02 * mGlobal.cpufactor)
 #define DO_BLOWOFF_EVENT_TIME 0.50
 #define DO_LONG_WIND_EVENT_TIME 1.00
 #define DO_SHORT_WIND_EVENT_TIME 0.10
+#define DO_WIND_FIELD_EVENT_TIME 0.10
 #define DO_STALL_CREATE_STORMITEM_EVENT_TIME 0.2
 #define DO_CREATE_STORMITEM_EVENT 0.1
 
@@ -137,23 +139,31 @@ typedef struct _StarCoordinate {
         int y;
 
         int color;
+        bool isColorChanged;
 } StarCoordinate;
 
 /***********************************************************
  * WinInfo object.
  */
+#define WINDOW_STATE_STICKY     (1 << 0) // visible on all workspaces
+#define WINDOW_STATE_HIDDEN     (1 << 1) // hidden / iconized
+#define WINDOW_STATE_DOCK       (1 << 2) // a "dock" (panel)
+#define WINDOW_STATE_FULLSCREEN (1 << 3)
+#define WINDOW_STATE_ABOVE      (1 << 4)
+#define WINDOW_STATE_BELOW      (1 << 5)
+
 typedef struct _WinInfo {
 
         Window window;     // Window.
+        Window frame;      // top level ancestor, WM frame.
         long ws;           // workspace
 
         int x, y;          // x,y coordinates
         int xa, ya;        // x,y coordinates absolute
         unsigned int w, h; // width, height
 
-        unsigned int sticky BITS(1); // is visible on all workspaces
-        unsigned int dock BITS(1);   // is a "dock" (panel)
-        unsigned int hidden BITS(1); // is hidden / iconized
+        unsigned int state;          // WINDOW_STATE_* bits
+        unsigned int stale BITS(1);  // needs a fresh probe
 } WinInfo;
 
 
@@ -173,9 +183,13 @@ typedef struct _FallenItem {
         int prevx, prevy;         // x, y of last draw.
         int prevw, prevh;         // w, h of last draw.
 
+        bool isDirty;             // needs fallen thread redraw.
+        unsigned int swapPaintSequence; // paint seq at last swap.
+
         GdkRGBA* columnColor;     // Color array.
         short int* fallenHeight;    // actual heights.
         short int* maxFallenHeight; // desired heights.
+        struct _ColumnTree* heightTree; // min / max of fallenHeight.
 } FallenItem;
 
 
@@ -188,7 +202,6 @@ extern struct _mGlobal {
 
         char* DesktopSession;
         int windowsWereDraggedOrMapped;
-        bool languageChangeRestart;
 
         Window StormWindow;
         unsigned int MaxStormItemHeight;
@@ -208,6 +221,7 @@ extern struct _mGlobal {
         FallenItem* FallenFirst;
 
         double cpufactor;
+        float frameTimeScale; // Set by the quality governor.
         float WindowScale;
 
         int visibleWorkspaceCount;
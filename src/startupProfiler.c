@@ -0,0 +1,241 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gtk/gtk.h>
+
+#include "ColorCodes.h"
+#include "startupProfiler.h"
+#include "utils.h"
+#include "versionHelper.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+#define STARTUP_PROFILE_FILE_NAME "plasmastorm-startup.json"
+
+#define STARTUP_PROFILE_MAX_PHASES 32
+
+typedef struct {
+    const char* name;
+    gint64 endTime;
+} StartupPhase;
+
+static StartupPhase mStartupPhases[STARTUP_PROFILE_MAX_PHASES];
+static int mStartupPhaseCount = 0;
+
+static gint64 mStartupTime = 0;
+static double mPreMainMsecs = -1;
+
+static bool mStartupProfileComplete = false;
+
+
+/** *********************************************************************
+ ** This method returns how long the process ran before main(),
+ ** ie: exec, dynamic linking & static initializers, in msecs.
+ ** Kernel start time has clock tick resolution (usually 10 ms).
+ **/
+static double getPreMainMsecs() {
+    FILE* statFile = fopen("/proc/self/stat", "r");
+    if (!statFile) {
+        return -1;
+    }
+
+    char buffer[1024];
+    const size_t length = fread(buffer, 1, sizeof(buffer) - 1, statFile);
+    fclose(statFile);
+    buffer[length] = '\0';
+
+    // Field 22 (starttime) counts from the ')' closing field 2.
+    const char* field = strrchr(buffer, ')');
+    if (!field) {
+        return -1;
+    }
+    for (int i = 2; i < 22 && field; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    if (!field) {
+        return -1;
+    }
+
+    const double startTicks = strtod(field + 1, NULL);
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+
+    struct timespec now;
+    if (ticksPerSecond <= 0 ||
+        clock_gettime(CLOCK_BOOTTIME, &now) != 0) {
+        return -1;
+    }
+
+    const double nowMsecs = now.tv_sec * 1000.0 +
+        now.tv_nsec / 1000000.0;
+    const double msecs = nowMsecs -
+        startTicks * 1000.0 / ticksPerSecond;
+    return msecs < 0 ? 0 : msecs;
+}
+
+/** *********************************************************************
+ ** This method starts the startup clock. Call first thing in
+ ** startApplication().
+ **/
+void initStartupProfiler() {
+    mStartupTime = g_get_monotonic_time();
+    mPreMainMsecs = getPreMainMsecs();
+    mStartupPhaseCount = 0;
+    mStartupProfileComplete = false;
+}
+
+/** *********************************************************************
+ ** This method closes the current phase under phaseName.
+ **/
+void markStartupPhase(const char* phaseName) {
+    if (mStartupProfileComplete ||
+        mStartupPhaseCount >= STARTUP_PROFILE_MAX_PHASES) {
+        return;
+    }
+
+    mStartupPhases[mStartupPhaseCount].name = phaseName;
+    mStartupPhases[mStartupPhaseCount].endTime =
+        g_get_monotonic_time();
+    mStartupPhaseCount++;
+}
+
+/** *********************************************************************
+ ** This method closes the final phase when the first real frame
+ ** is drawn, then reports. Later calls are ignored.
+ **/
+void markStartupFirstFrame() {
+    if (mStartupProfileComplete) {
+        return;
+    }
+
+    markStartupPhase("First frame drawn");
+    mStartupProfileComplete = true;
+
+    logStartupProfile();
+
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && runtimeDir[0]) {
+        char fileName[PATH_MAX];
+        snprintf(fileName, sizeof(fileName), "%s/%s",
+            runtimeDir, STARTUP_PROFILE_FILE_NAME);
+        writeStartupProfileJson(fileName);
+    }
+}
+
+/** *********************************************************************
+ ** This method ...
+ **/
+bool isStartupProfileComplete() {
+    return mStartupProfileComplete;
+}
+
+/** *********************************************************************
+ ** Helpers for phase times, msecs.
+ **/
+static double getPhaseStartMsecs(int phase) {
+    const gint64 start = (phase == 0) ? mStartupTime :
+        mStartupPhases[phase - 1].endTime;
+    return (start - mStartupTime) / 1000.0;
+}
+
+static double getPhaseEndMsecs(int phase) {
+    return (mStartupPhases[phase].endTime - mStartupTime) / 1000.0;
+}
+
+/** *********************************************************************
+ ** This method prints the phase table.
+ **/
+void logStartupProfile() {
+    if (mStartupTime == 0) {
+        return;
+    }
+
+    printf("\n%splasmastorm: Startup profile%s%s\n", COLOR_BLUE,
+        mStartupProfileComplete ? "." : " (first frame not drawn yet).",
+        COLOR_NORMAL);
+    printf("  %-36s %10s %10s\n", "Phase", "Msecs", "At msecs");
+
+    if (mPreMainMsecs >= 0) {
+        printf("  %-36s %10.1f %10s\n", "Exec to main()",
+            mPreMainMsecs, "-");
+    }
+
+    double slowest = 0;
+    int slowestPhase = -1;
+    for (int i = 0; i < mStartupPhaseCount; i++) {
+        const double msecs = getPhaseEndMsecs(i) -
+            getPhaseStartMsecs(i);
+        if (msecs > slowest) {
+            slowest = msecs;
+            slowestPhase = i;
+        }
+        printf("  %-36s %10.1f %10.1f\n", mStartupPhases[i].name,
+            msecs, getPhaseEndMsecs(i));
+    }
+
+    if (mStartupPhaseCount > 0) {
+        printf("  %-36s %10.1f\n", "Total since main()",
+            getPhaseEndMsecs(mStartupPhaseCount - 1));
+    }
+    if (slowestPhase >= 0) {
+        printf("  Slowest phase: %s.\n",
+            mStartupPhases[slowestPhase].name);
+    }
+}
+
+/** *********************************************************************
+ ** This method writes the phase table as JSON. Phase names are our
+ ** own literals, no escaping needed.
+ **/
+bool writeStartupProfileJson(const char* fileName) {
+    GString* json = g_string_new("{\n");
+    g_string_append_printf(json, "  \"version\": \"%s\",\n", VERSION);
+    g_string_append_printf(json, "  \"pid\": %d,\n", (int) getpid());
+    g_string_append_printf(json, "  \"complete\": %s,\n",
+        mStartupProfileComplete ? "true" : "false");
+    g_string_append_printf(json, "  \"preMainMsecs\": %.1f,\n",
+        mPreMainMsecs);
+    g_string_append_printf(json, "  \"totalMsecs\": %.3f,\n",
+        mStartupPhaseCount > 0 ?
+        getPhaseEndMsecs(mStartupPhaseCount - 1) : 0.0);
+    g_string_append(json, "  \"phases\": [\n");
+    for (int i = 0; i < mStartupPhaseCount; i++) {
+        g_string_append_printf(json, "    { \"name\": \"%s\", "
+            "\"startMsecs\": %.3f, \"msecs\": %.3f }%s\n",
+            mStartupPhases[i].name, getPhaseStartMsecs(i),
+            getPhaseEndMsecs(i) - getPhaseStartMsecs(i),
+            (i + 1 < mStartupPhaseCount) ? "," : "");
+    }
+    g_string_append(json, "  ]\n}\n");
+
+    const bool written = writeFileAtomically(fileName, json->str,
+        json->len, ATOMIC_WRITE_NO_SYNC);
+    g_string_free(json, TRUE);
+    return written;
+}
@@ -0,0 +1,42 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+
+
+/***********************************************************
+ * Startup phase profiler.
+ *
+ * Each markStartupPhase() call closes the phase that began at
+ * the previous mark, so name a mark for the work just done.
+ * markStartupFirstFrame() closes the last phase, logs the
+ * summary table & writes the JSON report
+ * ($XDG_RUNTIME_DIR/plasmastorm-startup.json).
+ */
+extern void initStartupProfiler();
+
+extern void markStartupPhase(const char* phaseName);
+extern void markStartupFirstFrame();
+extern bool isStartupProfileComplete();
+
+extern void logStartupProfile();
+extern bool writeStartupProfileJson(const char* fileName);
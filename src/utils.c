@@ -18,6 +18,8 @@
 #-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #-# 
 */
+#include <errno.h>
+#include <fcntl.h>
 #include <gsl/gsl_sort.h>
 #include <math.h>
 #include <pthread.h>
@@ -118,6 +120,85 @@ ssize_t mywrite(int fd, const void *buf, size_t count) {
     return 0;
 }
 
+/** *********************************************************************
+ ** This method replaces fileName with the buffer through a mkstemp()
+ ** temp file & rename(), so a reader sees the old or the new file,
+ ** never a partial one. A symlinked fileName is written through to
+ ** its target, and the file keeps its mode. syncPolicy picks how much
+ ** reaches the disk before returning. On failure errno is kept for
+ ** the caller.
+ **/
+bool writeFileAtomically(const char* fileName, const void* buffer,
+    size_t size, AtomicWriteSync syncPolicy) {
+    // Replace the symlink target, not the link itself.
+    char* targetName = realpath(fileName, NULL);
+    if (!targetName) {
+        targetName = strdup(fileName);
+    }
+
+    // Keep the existing mode, else what a plain create would get,
+    // not mkstemp()'s 0600.
+    mode_t fileMode;
+    struct stat fileStat;
+    if (stat(targetName, &fileStat) == 0) {
+        fileMode = fileStat.st_mode & 07777;
+    } else {
+        const mode_t mask = umask(0);
+        umask(mask);
+        fileMode = 0666 & ~mask;
+    }
+
+    const size_t tempLength = strlen(targetName) + 8;
+    char* tempFileName = (char*) malloc(tempLength);
+    snprintf(tempFileName, tempLength, "%s.XXXXXX", targetName);
+
+    const int fd = mkstemp(tempFileName);
+    if (fd < 0) {
+        const int savedErrno = errno;
+        free(tempFileName);
+        free(targetName);
+        errno = savedErrno;
+        return false;
+    }
+
+    // Data is on disk before the rename when asked, else a crash
+    // could leave an empty file where the old one was.
+    bool isWritten = (mywrite(fd, buffer, size) == 0) &&
+        (fchmod(fd, fileMode) == 0);
+    if (isWritten && syncPolicy != ATOMIC_WRITE_NO_SYNC) {
+        isWritten = (fdatasync(fd) == 0);
+    }
+    int savedErrno = errno;
+    close(fd);
+
+    if (isWritten) {
+        isWritten = (rename(tempFileName, targetName) == 0);
+        savedErrno = errno;
+    }
+    if (!isWritten) {
+        unlink(tempFileName);
+        free(tempFileName);
+        free(targetName);
+        errno = savedErrno;
+        return false;
+    }
+    free(tempFileName);
+
+    // Sync the directory too, so the rename() itself survives a crash.
+    if (syncPolicy == ATOMIC_WRITE_SYNC_DATA_AND_DIRECTORY) {
+        gchar* dirName = g_path_get_dirname(targetName);
+        const int dirFd = open(dirName, O_RDONLY | O_DIRECTORY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+        g_free(dirName);
+    }
+
+    free(targetName);
+    return true;
+}
+
 /** *********************************************************************
  ** Module MAINLOOP methods.
  **/
@@ -198,6 +279,74 @@ int randint(int m) {
     return (m <= 0) ? 0 : drand48() * m;
 }
 
+/** *********************************************************************
+ ** This method returns a standard normal deviate (Box-Muller).
+ **/
+double randomGaussian() {
+    const double u = 1.0 - drand48();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * drand48());
+}
+
+/** *********************************************************************
+ ** This method samples a Poisson count with the given mean. Small
+ ** means multiply uniforms, large ones use the normal approximation.
+ **/
+int randomPoisson(double mean) {
+    if (mean <= 0) {
+        return 0;
+    }
+
+    if (mean > 30) {
+        const int result = lrint(mean + sqrt(mean) * randomGaussian());
+        return (result < 0) ? 0 : result;
+    }
+
+    const double limit = exp(-mean);
+    double product = drand48();
+    int result = 0;
+    while (product > limit) {
+        product *= drand48();
+        result++;
+    }
+
+    return result;
+}
+
+/** *********************************************************************
+ ** This method samples a binomial count of successes in n trials.
+ ** Small expected counts skip between successes with geometric
+ ** waiting times, so cost follows n * p rather than n.
+ **/
+int randomBinomial(int n, double p) {
+    if (n <= 0 || p <= 0) {
+        return 0;
+    }
+    if (p >= 1) {
+        return n;
+    }
+    if (p > 0.5) {
+        return n - randomBinomial(n, 1 - p);
+    }
+
+    const double mean = n * p;
+    if (mean > 30) {
+        const int result = lrint(mean +
+            sqrt(mean * (1 - p)) * randomGaussian());
+        return (result < 0) ? 0 : (result > n) ? n : result;
+    }
+
+    const double logFailure = log(1 - p);
+    int result = 0;
+    int trial = 0;
+    while (true) {
+        trial += 1 + (int) (log(1.0 - drand48()) / logFailure);
+        if (trial > n) {
+            return result;
+        }
+        result++;
+    }
+}
+
 /** *********************************************************************
  ** This method ...
  **/
@@ -369,51 +518,6 @@ char* getLanguageFromEnvStrings() {
     return NULL;
 }
 
-/** *********************************************************************
- ** Helper methods ...
- **/
-// find largest window with name
-Window largest_window_with_name(xdo_t* myxdo,
-    const char* name) {
-
-    // Set search req.
-    xdo_search_t search;
-    memset(&search, 0, sizeof(xdo_search_t));
-    search.searchmask = SEARCH_NAME;
-    search.winname = name;
-    search.require = SEARCH_ANY;
-    search.max_depth = 4;
-    search.limit = 0;
-
-    // Set result fields and go.
-    Window* windowsArray = NULL;
-    unsigned int nwindows;
-    doXDOWindowSearch(myxdo, &search,
-        &windowsArray, &nwindows);
-
-    Window resultWindow = 0;
-    unsigned int maxsize = 0;
-    for (unsigned int i = 0; i < nwindows; i++) {
-        // Get this windowItem area.
-        unsigned int width, height;
-        xdo_get_window_size(myxdo, windowsArray[i], &width, &height);
-        const unsigned int windowArea = width * height;
-
-        // If it's the biggest,
-        // save its size, and Window.
-        if (windowArea > maxsize) {
-            maxsize = windowArea;
-            resultWindow = windowsArray[i];
-        }
-    }
-
-    if (windowsArray) {
-        free(windowsArray);
-    }
-
-    return resultWindow;
-}
-
 /** *********************************************************************
  ** Helper methods for Color.
  **/
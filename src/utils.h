@@ -30,6 +30,7 @@
 #include <X11/Intrinsic.h>
 #include <gtk/gtk.h>
 #include <math.h>
+#include <stdbool.h>
 
 #ifdef HAVE_EXECINFO_H
 #ifdef HAVE_BACKTRACE
@@ -40,6 +41,13 @@
 
 #include "xdo.h"
 
+// How much of writeFileAtomically() reaches the disk before it returns.
+typedef enum {
+    ATOMIC_WRITE_NO_SYNC,
+    ATOMIC_WRITE_SYNC_DATA,
+    ATOMIC_WRITE_SYNC_DATA_AND_DIRECTORY
+} AtomicWriteSync;
+
 extern guint addMethodToMainloop(gint prio,
     float time, GSourceFunc func);
 extern guint addMethodWithArgToMainloop(gint prio,
@@ -55,6 +63,9 @@ extern float getWindDirection(float x);
 extern float sq2(float x, float y);
 extern float sq3(float x, float y, float z);
 extern int randint(int m);
+extern double randomGaussian();
+extern int randomPoisson(double mean);
+extern int randomBinomial(int n, double p);
 
 extern Pixel IAllocNamedColor(const char* colorName, Pixel dfltPix);
 extern Pixel AllocNamedColor(const char* colorName, Pixel dfltPix);
@@ -68,12 +79,12 @@ extern void sanelyCheckAndClearDisplayArea(Display* display,
 extern int hasAppScaleChangedFrom(int* prev);
 extern int ValidColor(const char* color);
 extern ssize_t mywrite(int fd, const void* buf, size_t count);
+extern bool writeFileAtomically(const char* fileName,
+    const void* buffer, size_t size, AtomicWriteSync syncPolicy);
 extern int IsReadableFile(char* path);
 extern float gaussf(float x, float mu, float sigma);
 extern void traceback();
 extern char* getLanguageFromEnvStrings();
-extern Window largest_window_with_name(xdo_t* myxdo, const char* name);
-extern void fill_xdo_search(xdo_search_t* search);
 
 extern int is_little_endian(void);
 extern void logAppVersion(void);
@@ -0,0 +1,88 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "ColorCodes.h"
+#include "x11AtomHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_ATOMS
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+Atom mX11AtomTable[X11_ATOM_COUNT];
+
+#define X11_ATOM_NAME(name) #name,
+static const char* X11_ATOM_NAMES[X11_ATOM_COUNT] = {
+    X11_ATOM_LIST(X11_ATOM_NAME)
+};
+#undef X11_ATOM_NAME
+
+static bool mIsX11AtomTableInitialized = false;
+
+// Names not in our table, interned one by one.
+static unsigned long mX11AtomMisses = 0;
+
+
+/** *********************************************************************
+ ** This method interns the whole table, one round trip.
+ **/
+void initX11AtomTable(Display* display) {
+    XInternAtoms(display, (char**) X11_ATOM_NAMES, X11_ATOM_COUNT,
+        False, mX11AtomTable);
+    mIsX11AtomTableInitialized = true;
+}
+
+/** *********************************************************************
+ ** This method returns an atom by name, from the table when
+ ** we have it.
+ **/
+Atom getX11AtomByName(Display* display, const char* name) {
+    if (mIsX11AtomTableInitialized) {
+        for (int i = 0; i < X11_ATOM_COUNT; i++) {
+            if (strcmp(name, X11_ATOM_NAMES[i]) == 0) {
+                return getX11Atom((X11AtomId) i);
+            }
+        }
+    }
+
+    __atomic_fetch_add(&mX11AtomMisses, 1, __ATOMIC_RELAXED);
+    return XInternAtom(display, name, False);
+}
+
+/** *********************************************************************
+ ** This method logs how the atoms were interned: the table in one
+ ** round trip, names not in it one round trip each.
+ **/
+void logX11AtomStats() {
+    printf("%splasmastorm: atoms interned %d in 1 request, "
+        "%lu not in table.%s\n",
+        COLOR_BLUE, X11_ATOM_COUNT,
+        __atomic_load_n(&mX11AtomMisses, __ATOMIC_RELAXED),
+        COLOR_NORMAL);
+}
@@ -0,0 +1,88 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <X11/Xlib.h>
+
+
+/***********************************************************
+ * Every EWMH / ICCCM atom we use, interned once at startup
+ * by initX11AtomTable() in a single XInternAtoms request.
+ */
+#define X11_ATOM_LIST(ATOM) \
+    ATOM(_NET_ACTIVE_WINDOW) \
+    ATOM(_NET_CLIENT_LIST) \
+    ATOM(_NET_CLIENT_LIST_STACKING) \
+    ATOM(_NET_CURRENT_DESKTOP) \
+    ATOM(_NET_DESKTOP_VIEWPORT) \
+    ATOM(_NET_FRAME_EXTENTS) \
+    ATOM(_NET_NUMBER_OF_DESKTOPS) \
+    ATOM(_NET_SHOWING_DESKTOP) \
+    ATOM(_NET_SUPPORTED) \
+    ATOM(_NET_WM_DESKTOP) \
+    ATOM(_NET_WM_NAME) \
+    ATOM(_NET_WM_PID) \
+    ATOM(_NET_WM_STATE) \
+    ATOM(_NET_WM_STATE_ABOVE) \
+    ATOM(_NET_WM_STATE_BELOW) \
+    ATOM(_NET_WM_STATE_FULLSCREEN) \
+    ATOM(_NET_WM_STATE_HIDDEN) \
+    ATOM(_NET_WM_STATE_STICKY) \
+    ATOM(_NET_WM_WINDOW_TYPE) \
+    ATOM(_NET_WM_WINDOW_TYPE_DOCK) \
+    ATOM(_GTK_FRAME_EXTENTS) \
+    ATOM(_WIN_CLIENT_LIST) \
+    ATOM(_WIN_WORKSPACE) \
+    ATOM(STRING) \
+    ATOM(UTF8_STRING) \
+    ATOM(WM_NAME) \
+    ATOM(WM_STATE)
+
+#define X11_ATOM_ENUM(name) X11_ATOM_##name,
+typedef enum {
+    X11_ATOM_LIST(X11_ATOM_ENUM)
+    X11_ATOM_COUNT
+} X11AtomId;
+#undef X11_ATOM_ENUM
+
+
+/***********************************************************
+ * Table, see getX11Atom().
+ */
+extern Atom mX11AtomTable[X11_ATOM_COUNT];
+
+/***********************************************************
+ * This method returns an interned atom.
+ */
+static inline Atom getX11Atom(X11AtomId id) {
+    return mX11AtomTable[id];
+}
+
+#define X11_ATOM(name) getX11Atom(X11_ATOM_##name)
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void initX11AtomTable(Display*);
+extern Atom getX11AtomByName(Display*, const char* name);
+
+extern void logX11AtomStats();
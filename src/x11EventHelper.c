@@ -0,0 +1,265 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * X11 event source. The X connection's fd is polled by the GLib
+ * main loop, so we wake as soon as events arrive instead of on a
+ * timer, and sleep while the connection is idle.
+ *
+ * Xlib may also read events into its queue while waiting on a
+ * reply, leaving the fd quiet. prepare() checks XQLength() for
+ * those, so they're handled on the next main loop iteration.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include <gtk/gtk.h>
+
+#include "plasmastorm.h"
+
+#include "ClockHelper.h"
+#include "ColorCodes.h"
+#include "x11EventHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_APPLICATION
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+typedef struct _X11EventSource {
+    GSource source;
+    GPollFD pollFD;
+} X11EventSource;
+
+// Upper bucket limits, seconds. The last bucket is open ended.
+static const double X11_EVENT_LATENCY_LIMITS[
+    X11_EVENT_LATENCY_BUCKETS - 1] = {
+    0.0001, 0.0005, 0.001, 0.005, 0.010, 0.050, 0.100 };
+static const char* X11_EVENT_LATENCY_LABELS[
+    X11_EVENT_LATENCY_BUCKETS] = {
+    "<0.1ms", "<0.5ms", "<1ms", "<5ms",
+    "<10ms", "<50ms", "<100ms", ">=100ms" };
+
+static X11EventStats mX11EventStats;
+
+// When the queue last went from empty to ready, 0 when drained.
+static double mQueueReadyTime = 0;
+
+static int mBatchEventCount = 0;
+
+static double mRateWindowStart = 0;
+static unsigned long long mRateWindowEvents = 0;
+
+
+/** *********************************************************************
+ ** This method notes when events first became ready to handle.
+ **/
+static gboolean markX11EventsReady(bool isReady) {
+    if (isReady && mQueueReadyTime == 0) {
+        mQueueReadyTime = wallclock();
+    }
+    return isReady;
+}
+
+/** *********************************************************************
+ ** These are the GSource methods for the X connection.
+ **/
+static gboolean prepareX11EventSource(
+    __attribute__((unused)) GSource* source, gint* timeout) {
+    *timeout = -1;
+
+    // Requests must go out before we sleep on their answers.
+    XFlush(mGlobal.display);
+    return markX11EventsReady(XQLength(mGlobal.display) > 0);
+}
+
+static gboolean checkX11EventSource(GSource* source) {
+    X11EventSource* eventSource = (X11EventSource*) source;
+
+    if (eventSource->pollFD.revents & G_IO_IN) {
+        return markX11EventsReady(XPending(mGlobal.display) > 0);
+    }
+    return markX11EventsReady(XQLength(mGlobal.display) > 0);
+}
+
+static gboolean dispatchX11EventSource(
+    __attribute__((unused)) GSource* source,
+    GSourceFunc callback, gpointer userData) {
+    if (!callback) {
+        return G_SOURCE_REMOVE;
+    }
+
+    mBatchEventCount = 0;
+    mX11EventStats.dispatches++;
+    sampleX11DisplayLockStall(mGlobal.display);
+
+    const gboolean result = callback(userData);
+    if (mBatchEventCount >= X11_EVENT_BATCH_SIZE) {
+        mX11EventStats.fullBatches++;
+    }
+    return result;
+}
+
+static GSourceFuncs mX11EventSourceFuncs = {
+    prepareX11EventSource,
+    checkX11EventSource,
+    dispatchX11EventSource,
+    NULL, NULL, NULL
+};
+
+/** *********************************************************************
+ ** This method adds a source calling func whenever X events
+ ** are ready. func drains them with getNextX11Event().
+ **/
+guint addX11EventSourceToMainloop(gint priority, GSourceFunc func) {
+    GSource* source = g_source_new(&mX11EventSourceFuncs,
+        sizeof(X11EventSource));
+    X11EventSource* eventSource = (X11EventSource*) source;
+
+    eventSource->pollFD.fd = ConnectionNumber(mGlobal.display);
+    eventSource->pollFD.events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+    g_source_add_poll(source, &eventSource->pollFD);
+
+    g_source_set_priority(source, priority);
+    g_source_set_callback(source, func, NULL, NULL);
+
+    const guint tag = g_source_attach(source, NULL);
+    g_source_unref(source);
+
+    mRateWindowStart = wallclock();
+    return tag;
+}
+
+/** *********************************************************************
+ ** This method tells if candidate is a ConfigureNotify about the
+ ** same window, from the same event window.
+ **/
+static bool isSameWindowConfigure(const XEvent* candidate,
+    const XConfigureEvent* configure) {
+    return candidate->type == ConfigureNotify &&
+        candidate->xconfigure.window == configure->window &&
+        candidate->xconfigure.event == configure->event;
+}
+
+/** *********************************************************************
+ ** This method records one handled event in the stats.
+ **/
+static void countX11Event(double now) {
+    mX11EventStats.events++;
+
+    const double latency = now - mQueueReadyTime;
+    int bucket = 0;
+    while (bucket < X11_EVENT_LATENCY_BUCKETS - 1 &&
+        latency >= X11_EVENT_LATENCY_LIMITS[bucket]) {
+        bucket++;
+    }
+    mX11EventStats.latencyBuckets[bucket]++;
+
+    mRateWindowEvents++;
+    const double elapsed = now - mRateWindowStart;
+    if (elapsed >= 1.0) {
+        mX11EventStats.eventsPerSecond =
+            mRateWindowEvents / elapsed;
+        if (mX11EventStats.eventsPerSecond >
+            mX11EventStats.peakEventsPerSecond) {
+            mX11EventStats.peakEventsPerSecond =
+                mX11EventStats.eventsPerSecond;
+        }
+        mRateWindowStart = now;
+        mRateWindowEvents = 0;
+    }
+}
+
+/** *********************************************************************
+ ** This method gets the next queued event, false once the queue
+ ** is empty or this dispatch's batch is used up.
+ **
+ ** A ConfigureNotify is replaced by the last of a run queued
+ ** right behind it for the same window, the in-between geometry is
+ ** of no use to us. Only back to back ones are merged: a Configure
+ ** must not jump ahead of an Unmap, Reparent or button release
+ ** queued before it.
+ **/
+bool getNextX11Event(XEvent* event) {
+    if (mBatchEventCount >= X11_EVENT_BATCH_SIZE) {
+        return false;
+    }
+    if (XQLength(mGlobal.display) == 0 &&
+        XPending(mGlobal.display) == 0) {
+        mQueueReadyTime = 0;
+        return false;
+    }
+
+    const double now = wallclock();
+    if (mQueueReadyTime == 0) {
+        mQueueReadyTime = now;
+    }
+
+    XNextEvent(mGlobal.display, event);
+    mBatchEventCount++;
+    countX11Event(now);
+
+    if (event->type == ConfigureNotify) {
+        XEvent next;
+        while (XQLength(mGlobal.display) > 0) {
+            XPeekEvent(mGlobal.display, &next);
+            if (!isSameWindowConfigure(&next, &event->xconfigure)) {
+                break;
+            }
+            XNextEvent(mGlobal.display, event);
+            mX11EventStats.coalescedConfigures++;
+        }
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** These methods return or log the event stats.
+ **/
+void getX11EventStats(X11EventStats* stats) {
+    memcpy(stats, &mX11EventStats, sizeof(X11EventStats));
+}
+
+void logX11EventStats() {
+    X11EventStats stats;
+    getX11EventStats(&stats);
+
+    printf("%splasmastorm: X11 events: %llu handled in %llu "
+        "dispatches (%llu full batches), %llu ConfigureNotify "
+        "coalesced, %.1f/s last, %.1f/s peak.%s\n",
+        COLOR_BLUE, stats.events, stats.dispatches,
+        stats.fullBatches, stats.coalescedConfigures,
+        stats.eventsPerSecond, stats.peakEventsPerSecond,
+        COLOR_NORMAL);
+
+    printf("%splasmastorm: X11 event queue latency:", COLOR_BLUE);
+    for (int i = 0; i < X11_EVENT_LATENCY_BUCKETS; i++) {
+        printf(" %s %llu", X11_EVENT_LATENCY_LABELS[i],
+            stats.latencyBuckets[i]);
+    }
+    printf(".%s\n", COLOR_NORMAL);
+}
@@ -0,0 +1,58 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include <X11/Xlib.h>
+
+#include <gtk/gtk.h>
+
+#include "plasmastorm.h"
+
+
+// Most events handled per dispatch, the rest wait for the
+// next main loop iteration so timers aren't starved.
+#define X11_EVENT_BATCH_SIZE 64
+
+// Queue latency histogram, see X11_EVENT_LATENCY_LIMITS.
+#define X11_EVENT_LATENCY_BUCKETS 8
+
+typedef struct _X11EventStats {
+    unsigned long long events;
+    unsigned long long coalescedConfigures;
+    unsigned long long dispatches;
+    unsigned long long fullBatches;
+    double eventsPerSecond;
+    double peakEventsPerSecond;
+    unsigned long long latencyBuckets[X11_EVENT_LATENCY_BUCKETS];
+} X11EventStats;
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern guint addX11EventSourceToMainloop(gint priority,
+    GSourceFunc func);
+extern bool getNextX11Event(XEvent* event);
+
+extern void getX11EventStats(X11EventStats*);
+extern void logX11EventStats();
@@ -0,0 +1,170 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * Pointer button state from XInput2 raw events on the root window.
+ * Raw events arrive whichever window the pointer is over, and
+ * even during the window manager's move grab (XI 2.1+), so we know
+ * if a button is held without an XQueryPointer round trip.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+
+#include "plasmastorm.h"
+
+#include "ColorCodes.h"
+#include "x11InputHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_WINDOWS
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+#define X11_INPUT_BUTTON_COUNT 32
+
+static bool mIsXInput2Available = false;
+static int mXInput2Opcode = 0;
+
+// Press counts per button, from every master pointer.
+static int mButtonPressCount[X11_INPUT_BUTTON_COUNT];
+
+
+/** *********************************************************************
+ ** This method selects raw button events on the root window,
+ ** and seeds the button state with one XQueryPointer().
+ **/
+void initX11InputModule() {
+    memset(mButtonPressCount, 0, sizeof(mButtonPressCount));
+
+    int eventBase, errorBase;
+    if (!XQueryExtension(mGlobal.display, "XInputExtension",
+        &mXInput2Opcode, &eventBase, &errorBase)) {
+        printf("%splasmastorm: XInputExtension not available, "
+            "pointer buttons are queried.%s\n",
+            COLOR_YELLOW, COLOR_NORMAL);
+        return;
+    }
+
+    // 2.1 delivers raw events during grabs too.
+    int majorVersion = 2;
+    int minorVersion = 2;
+    if (XIQueryVersion(mGlobal.display, &majorVersion,
+        &minorVersion) != Success || (majorVersion == 2 &&
+        minorVersion < 1)) {
+        printf("%splasmastorm: XInput %d.%d is too old, "
+            "pointer buttons are queried.%s\n",
+            COLOR_YELLOW, majorVersion, minorVersion, COLOR_NORMAL);
+        return;
+    }
+
+    unsigned char mask[XIMaskLen(XI_LASTEVENT)];
+    memset(mask, 0, sizeof(mask));
+    XISetMask(mask, XI_RawButtonPress);
+    XISetMask(mask, XI_RawButtonRelease);
+
+    XIEventMask eventMask;
+    eventMask.deviceid = XIAllMasterDevices;
+    eventMask.mask_len = sizeof(mask);
+    eventMask.mask = mask;
+    XISelectEvents(mGlobal.display, DefaultRootWindow(mGlobal.display),
+        &eventMask, 1);
+
+    mIsXInput2Available = true;
+
+    // Seed, a button may be down already.
+    Window unusedWindow;
+    int unusedInt;
+    unsigned int pointerState;
+    if (XQueryPointer(mGlobal.display, DefaultRootWindow(mGlobal.display),
+        &unusedWindow, &unusedWindow, &unusedInt, &unusedInt,
+        &unusedInt, &unusedInt, &pointerState)) {
+        mButtonPressCount[1] = (pointerState & Button1Mask) ? 1 : 0;
+        mButtonPressCount[2] = (pointerState & Button2Mask) ? 1 : 0;
+        mButtonPressCount[3] = (pointerState & Button3Mask) ? 1 : 0;
+    }
+}
+
+/** *********************************************************************
+ ** This method checks if an event is one of our XInput2 events.
+ **/
+bool isX11InputEvent(XEvent* event) {
+    return mIsXInput2Available &&
+        event->xcookie.type == GenericEvent &&
+        event->xcookie.extension == mXInput2Opcode;
+}
+
+/** *********************************************************************
+ ** This method updates the button state from a raw event.
+ ** Returns true on a button 1 release.
+ **/
+bool handleX11InputEvent(XEvent* event) {
+    if (!isX11InputEvent(event) ||
+        !XGetEventData(mGlobal.display, &event->xcookie)) {
+        return false;
+    }
+
+    bool isPrimaryReleased = false;
+    const XIRawEvent* rawEvent = (XIRawEvent*) event->xcookie.data;
+    const int button = rawEvent->detail;
+
+    if (button > 0 && button < X11_INPUT_BUTTON_COUNT) {
+        switch (event->xcookie.evtype) {
+            case XI_RawButtonPress:
+                mButtonPressCount[button]++;
+                break;
+
+            case XI_RawButtonRelease:
+                if (mButtonPressCount[button] > 0) {
+                    mButtonPressCount[button]--;
+                }
+                isPrimaryReleased = (button == Button1);
+                break;
+        }
+    }
+
+    XFreeEventData(mGlobal.display, &event->xcookie);
+    return isPrimaryReleased;
+}
+
+/** *********************************************************************
+ ** This method decides if the primary button is held, locally
+ ** when XInput2 is available, else by XQueryPointer().
+ **/
+bool isX11PointerButtonHeld() {
+    if (mIsXInput2Available) {
+        return mButtonPressCount[Button1] > 0;
+    }
+
+    Window unusedWindow;
+    int unusedInt;
+    unsigned int pointerState;
+    return XQueryPointer(mGlobal.display,
+        DefaultRootWindow(mGlobal.display),
+        &unusedWindow, &unusedWindow, &unusedInt, &unusedInt,
+        &unusedInt, &unusedInt, &pointerState) &&
+        (pointerState & Button1Mask);
+}
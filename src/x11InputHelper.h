@@ -20,15 +20,19 @@
  */
 #pragma once
 
-int doXDOWindowSearch(const xdo_t* xdo, const xdo_search_t* search,
-    Window** windowlist_ret, unsigned int* nwindows_ret);
+#include <stdbool.h>
 
-int checkXDOWindowMatch(const xdo_t* xdo,
-    Window window, const xdo_search_t* search);
+#include <X11/Xlib.h>
 
-int initXDOSearchRegex(const char *pattern, regex_t *re);
+#include "plasmastorm.h"
 
-void findXDOWindowMatch(const xdo_t* xdo, Window window,
-    const xdo_search_t* search, Window** windowlist_ret,
-    unsigned int* nwindows_ret, unsigned int* windowlist_size,
-    int current_depth);
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void initX11InputModule();
+
+extern bool isX11InputEvent(XEvent*);
+extern bool handleX11InputEvent(XEvent*);
+
+extern bool isX11PointerButtonHeld();
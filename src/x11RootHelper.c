@@ -0,0 +1,278 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * Root window property cache. The window manager publishes the
+ * active window, current desktop, showing desktop flag and client
+ * list as root properties. We select PropertyChangeMask on the
+ * root and refetch each one only when its PropertyNotify arrives,
+ * so reading them costs no round trips.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "ColorCodes.h"
+#include "plasmastorm.h"
+#include "safeMalloc.h"
+#include "x11AtomHelper.h"
+#include "x11RootHelper.h"
+#include "x11WindowHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_WINDOWS
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+static bool mIsActiveWindowSupported = false;
+static Window mActiveWindow = None;
+
+static long mNetCurrentDesktop = -1;
+static long mWinWorkspace = -1;
+
+static bool mIsShowingDesktop = false;
+
+static Window* mClientWindows = NULL;
+static int mClientWindowCount = 0;
+
+
+/** *********************************************************************
+ ** This method fetches a single CARDINAL or WINDOW root property
+ ** value. Returns false if it's absent or of another type.
+ **/
+static bool fetchRootLong(X11AtomId property, Atom wantedType,
+    long* value) {
+    Atom type = None;
+    int format;
+    unsigned long itemCount, unusedBytes;
+    unsigned char* data = NULL;
+
+    XGetWindowProperty(mGlobal.display, mGlobal.Rootwindow,
+        getX11Atom(property), 0, 1, False, wantedType,
+        &type, &format, &itemCount, &unusedBytes, &data);
+
+    const bool isFound = (type == wantedType &&
+        format == 32 && itemCount > 0 && data);
+    if (isFound) {
+        *value = *(long*) (void*) data;
+    }
+    if (data) {
+        XFree(data);
+    }
+
+    return isFound;
+}
+
+/** *********************************************************************
+ ** This method refetches _NET_SUPPORTED, and decides if the
+ ** window manager keeps _NET_ACTIVE_WINDOW for us.
+ **/
+static void refreshSupported() {
+    Atom type = None;
+    int format;
+    unsigned long itemCount, unusedBytes;
+    unsigned char* data = NULL;
+
+    XGetWindowProperty(mGlobal.display, mGlobal.Rootwindow,
+        X11_ATOM(_NET_SUPPORTED), 0, 1000000, False, XA_ATOM,
+        &type, &format, &itemCount, &unusedBytes, &data);
+
+    const bool wasSupported = mIsActiveWindowSupported;
+    mIsActiveWindowSupported = false;
+    if (type == XA_ATOM && format == 32 && data) {
+        const Atom* atoms = (const Atom*) (void*) data;
+        for (unsigned long i = 0; i < itemCount; i++) {
+            if (atoms[i] == X11_ATOM(_NET_ACTIVE_WINDOW)) {
+                mIsActiveWindowSupported = true;
+                break;
+            }
+        }
+    }
+    if (data) {
+        XFree(data);
+    }
+
+    if (wasSupported && !mIsActiveWindowSupported) {
+        fprintf(stderr, "%splasmastorm: Your windowmanager no longer "
+            "supports _NET_ACTIVE_WINDOW.%s\n",
+            COLOR_YELLOW, COLOR_NORMAL);
+    }
+}
+
+/** *********************************************************************
+ ** These methods refetch one cached root property each.
+ **/
+static void refreshActiveWindow() {
+    long value;
+    mActiveWindow = (mIsActiveWindowSupported &&
+        fetchRootLong(X11_ATOM__NET_ACTIVE_WINDOW, XA_WINDOW,
+            &value)) ? (Window) value : None;
+}
+
+static void refreshCurrentDesktop() {
+    if (!fetchRootLong(X11_ATOM__NET_CURRENT_DESKTOP,
+        XA_CARDINAL, &mNetCurrentDesktop)) {
+        mNetCurrentDesktop = -1;
+    }
+}
+
+static void refreshWinWorkspace() {
+    if (!fetchRootLong(X11_ATOM__WIN_WORKSPACE,
+        XA_CARDINAL, &mWinWorkspace)) {
+        mWinWorkspace = -1;
+    }
+}
+
+static void refreshShowingDesktop() {
+    long value;
+    mIsShowingDesktop = fetchRootLong(
+        X11_ATOM__NET_SHOWING_DESKTOP, XA_CARDINAL, &value) &&
+        value == 1;
+}
+
+static void refreshClientWindows() {
+    Window* clients;
+    const int clientCount = getX11ClientWindows(&clients);
+
+    free(mClientWindows);
+    mClientWindows = NULL;
+    mClientWindowCount = 0;
+
+    if (clientCount > 0) {
+        mClientWindows = (Window*)
+            malloc(clientCount * sizeof(Window));
+        MALLOC_CHECK(mClientWindows);
+        memcpy(mClientWindows, clients,
+            clientCount * sizeof(Window));
+        mClientWindowCount = clientCount;
+    }
+    if (clients) {
+        XFree(clients);
+    }
+}
+
+/** *********************************************************************
+ ** This method adds PropertyChangeMask to our root event mask,
+ ** keeping whatever the caller selected before, and fills the cache.
+ **/
+void initX11RootCache() {
+    XWindowAttributes attributes;
+    long eventMask = 0;
+    if (XGetWindowAttributes(mGlobal.display,
+        mGlobal.Rootwindow, &attributes)) {
+        eventMask = attributes.your_event_mask;
+    }
+    XSelectInput(mGlobal.display, mGlobal.Rootwindow,
+        eventMask | PropertyChangeMask);
+
+    refreshX11RootCache();
+
+    if (!mIsActiveWindowSupported) {
+        fprintf(stderr, "%splasmastorm: Your windowmanager claims "
+            "not to support _NET_ACTIVE_WINDOW.%s\n",
+            COLOR_YELLOW, COLOR_NORMAL);
+    }
+}
+
+/** *********************************************************************
+ ** This method frees the cached client list.
+ **/
+void uninitX11RootCache() {
+    free(mClientWindows);
+    mClientWindows = NULL;
+    mClientWindowCount = 0;
+}
+
+/** *********************************************************************
+ ** This method refetches every cached root property.
+ **/
+void refreshX11RootCache() {
+    refreshSupported();
+    refreshActiveWindow();
+    refreshCurrentDesktop();
+    refreshWinWorkspace();
+    refreshShowingDesktop();
+    refreshClientWindows();
+}
+
+/** *********************************************************************
+ ** This method handles a root PropertyNotify. Returns true if
+ ** the property is one we cache, now refetched.
+ **/
+bool updateX11RootCache(Atom property) {
+    if (property == X11_ATOM(_NET_ACTIVE_WINDOW)) {
+        refreshActiveWindow();
+        return true;
+    }
+    if (property == X11_ATOM(_NET_CURRENT_DESKTOP)) {
+        refreshCurrentDesktop();
+        return true;
+    }
+    if (property == X11_ATOM(_WIN_WORKSPACE)) {
+        refreshWinWorkspace();
+        return true;
+    }
+    if (property == X11_ATOM(_NET_SHOWING_DESKTOP)) {
+        refreshShowingDesktop();
+        return true;
+    }
+    if (property == X11_ATOM(_NET_CLIENT_LIST) ||
+        property == X11_ATOM(_WIN_CLIENT_LIST)) {
+        refreshClientWindows();
+        return true;
+    }
+    if (property == X11_ATOM(_NET_SUPPORTED)) {
+        refreshSupported();
+        refreshActiveWindow();
+        return true;
+    }
+
+    return false;
+}
+
+/** *********************************************************************
+ ** These methods return the cached root values.
+ **/
+Window getCachedActiveX11Window() {
+    return mActiveWindow;
+}
+
+// _NET_CURRENT_DESKTOP, else GNOME's _WIN_WORKSPACE, else -1.
+long getCachedCurrentWorkspace() {
+    return (mNetCurrentDesktop >= 0) ?
+        mNetCurrentDesktop : mWinWorkspace;
+}
+
+bool isCachedShowingDesktop() {
+    return mIsShowingDesktop;
+}
+
+// Owned by the cache, valid until the next client list change.
+int getCachedX11ClientWindows(const Window** windows) {
+    (*windows) = mClientWindows;
+    return mClientWindowCount;
+}
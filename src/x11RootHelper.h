@@ -0,0 +1,42 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include <X11/Xlib.h>
+
+#include "plasmastorm.h"
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void initX11RootCache();
+extern void uninitX11RootCache();
+
+extern void refreshX11RootCache();
+extern bool updateX11RootCache(Atom property);
+
+extern Window getCachedActiveX11Window();
+extern long getCachedCurrentWorkspace();
+extern bool isCachedShowingDesktop();
+extern int getCachedX11ClientWindows(const Window** windows);
@@ -0,0 +1,206 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * Window list scan benchmark, run by x11ScanBenchmark.sh under Xvfb.
+ *
+ * Creates synthetic top level windows carrying the EWMH properties
+ * our probes read, then times the old serial Xlib probe against
+ * the pipelined scanX11WindowInfos().
+ *
+ * Usage: x11ScanBenchmark [windows] [rounds]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "plasmastorm.h"
+#include "x11AtomHelper.h"
+#include "x11ScanHelper.h"
+
+
+/** *********************************************************************
+ ** This method returns monotonic time in milliseconds.
+ **/
+static double getBenchmarkClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+/** *********************************************************************
+ ** This method fetches & frees one window property, serially.
+ **/
+static void fetchProperty(Display* display, Window window,
+    const char* name, bool getAtomNames) {
+
+    Atom type;
+    int format;
+    unsigned long nitems, unusedBytes;
+    unsigned char* properties = NULL;
+
+    XGetWindowProperty(display, window,
+        XInternAtom(display, name, False), 0, (~0L), False,
+        AnyPropertyType, &type, &format, &nitems,
+        &unusedBytes, &properties);
+
+    if (getAtomNames && format == 32) {
+        for (unsigned long i = 0; i < nitems; i++) {
+            char* nameString = XGetAtomName(display,
+                ((Atom*) (void*) properties) [i]);
+            XFree(nameString);
+        }
+    }
+
+    if (properties) {
+        XFree(properties);
+    }
+}
+
+/** *********************************************************************
+ ** This method replays the serial per window Xlib probe that
+ ** getFinishedWindowsList() used to make.
+ **/
+static void serialProbe(Display* display, Window root, Window window) {
+    fetchProperty(display, window, "_NET_WM_DESKTOP", false);
+    fetchProperty(display, window, "_NET_WM_STATE", true);
+    fetchProperty(display, window, "_NET_WM_WINDOW_TYPE", true);
+
+    XWindowAttributes windowAttributes;
+    XGetWindowAttributes(display, window, &windowAttributes);
+
+    fetchProperty(display, root, "_NET_SHOWING_DESKTOP", false);
+    fetchProperty(display, window, "_NET_WM_STATE", true);
+    fetchProperty(display, window, "WM_STATE", false);
+
+    int x, y;
+    Window child;
+    XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &child);
+    XTranslateCoordinates(display, window, root, 0, 0, &x, &y, &child);
+
+    fetchProperty(display, window, "_GTK_FRAME_EXTENTS", false);
+    fetchProperty(display, window, "_NET_FRAME_EXTENTS", false);
+}
+
+/** *********************************************************************
+ ** This method creates one mapped window with typical properties.
+ **/
+static Window createSyntheticWindow(Display* display, Window root,
+    int index) {
+
+    Window window = XCreateSimpleWindow(display, root,
+        (index * 37) % 1600, (index * 53) % 900, 320, 200, 0, 0, 0);
+
+    long desktop = index % 4;
+    XChangeProperty(display, window, X11_ATOM(_NET_WM_DESKTOP),
+        XA_CARDINAL, 32, PropModeReplace,
+        (unsigned char*) &desktop, 1);
+
+    Atom states[2] = { X11_ATOM(_NET_WM_STATE_ABOVE),
+        X11_ATOM(_NET_WM_STATE_STICKY) };
+    XChangeProperty(display, window, X11_ATOM(_NET_WM_STATE),
+        XA_ATOM, 32, PropModeReplace,
+        (unsigned char*) states, 1 + index % 2);
+
+    long extents[4] = { 1, 1, 24, 1 };
+    XChangeProperty(display, window, X11_ATOM(_NET_FRAME_EXTENTS),
+        XA_CARDINAL, 32, PropModeReplace,
+        (unsigned char*) extents, 4);
+
+    long wmState[2] = { NormalState, None };
+    XChangeProperty(display, window, X11_ATOM(WM_STATE),
+        X11_ATOM(WM_STATE), 32, PropModeReplace,
+        (unsigned char*) wmState, 2);
+
+    XMapWindow(display, window);
+    return window;
+}
+
+/** *********************************************************************
+ ** Benchmark main.
+ **/
+int main(int argc, char** argv) {
+    const int windowCount = (argc > 1) ? atoi(argv[1]) : 50;
+    const int roundCount = (argc > 2) ? atoi(argv[2]) : 20;
+
+    Display* display = XOpenDisplay(NULL);
+    if (!display) {
+        fprintf(stderr, "x11ScanBenchmark: no display.\n");
+        return 1;
+    }
+    initX11AtomTable(display);
+
+    const Window root = DefaultRootWindow(display);
+    WinInfo* winInfos = (WinInfo*) calloc(windowCount, sizeof(WinInfo));
+    WinInfo** winInfoItems = (WinInfo**)
+        malloc(windowCount * sizeof(WinInfo*));
+    bool* isAlive = (bool*) malloc(windowCount * sizeof(bool));
+
+    for (int i = 0; i < windowCount; i++) {
+        winInfos[i].window = createSyntheticWindow(display, root, i);
+        winInfoItems[i] = &winInfos[i];
+    }
+    XSync(display, False);
+
+    // Serial Xlib probe.
+    double start = getBenchmarkClock();
+    for (int round = 0; round < roundCount; round++) {
+        for (int i = 0; i < windowCount; i++) {
+            serialProbe(display, root, winInfos[i].window);
+        }
+    }
+    const double serialTime = (getBenchmarkClock() - start) / roundCount;
+
+    // Pipelined scan. Frames are found on the first round only,
+    // as they are for cached WinInfos.
+    start = getBenchmarkClock();
+    for (int round = 0; round < roundCount; round++) {
+        scanX11WindowInfos(display, root, root, false,
+            winInfoItems, windowCount, isAlive);
+    }
+    const double scanTime = (getBenchmarkClock() - start) / roundCount;
+
+    int aliveCount = 0;
+    for (int i = 0; i < windowCount; i++) {
+        aliveCount += isAlive[i];
+    }
+
+    printf("x11ScanBenchmark: %d windows, %d rounds.\n",
+        windowCount, roundCount);
+    printf("  serial Xlib probe : %8.3f ms / scan\n", serialTime);
+    printf("  pipelined scan    : %8.3f ms / scan (%d alive)\n",
+        scanTime, aliveCount);
+    printf("  speedup           : %8.1fx\n",
+        scanTime > 0 ? serialTime / scanTime : 0);
+
+    free(isAlive);
+    free(winInfoItems);
+    free(winInfos);
+    closeX11ScanConnection();
+    XCloseDisplay(display);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+# -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+#
+# Runs the window list scan benchmark on a private Xvfb server.
+#
+#   make x11ScanBenchmark && ./x11ScanBenchmark.sh [windows] [rounds]
+#
+# Xvfb is local, so round trips are cheap; add network latency
+# (e.g. DISPLAY over ssh) to see the full serial cost.
+
+XVFB_DISPLAY=:97
+
+Xvfb $XVFB_DISPLAY -screen 0 1920x1080x24 -nolisten tcp >/dev/null 2>&1 &
+XVFB_PID=$!
+trap 'kill $XVFB_PID 2>/dev/null' EXIT INT TERM
+sleep 1
+
+for windows in ${1:-10 50 200}; do
+    DISPLAY=$XVFB_DISPLAY ./x11ScanBenchmark $windows ${2:-20} || exit 1
+done
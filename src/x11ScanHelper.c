@@ -0,0 +1,448 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * Pipelined WinInfo scanner. All requests for all windows go
+ * out first, then the replies are collected, so a scan of n
+ * windows costs about one round trip instead of a dozen per window.
+ *
+ * Scans run on their own XCB connection to the same server, so
+ * they never take the Xlib display lock nor mix their replies
+ * and errors into the main connection.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+
+#include "plasmastorm.h"
+#include "safeMalloc.h"
+#include "x11AtomHelper.h"
+#include "x11ScanHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_WINDOWS
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+#define SCAN_ATOM_LIST_LENGTH 1024
+#define SCAN_REQUESTS_PER_WINDOW 11
+
+// Requests in flight for one window.
+typedef struct _X11ScanCookies {
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_geometry_cookie_t geometry;
+
+    xcb_get_property_cookie_t netDesktop;
+    xcb_get_property_cookie_t winWorkspace;
+    xcb_get_property_cookie_t netState;
+    xcb_get_property_cookie_t windowType;
+    xcb_get_property_cookie_t wmState;
+    xcb_get_property_cookie_t gtkExtents;
+    xcb_get_property_cookie_t netExtents;
+
+    xcb_translate_coordinates_cookie_t toRoot;
+    xcb_translate_coordinates_cookie_t toRelative;
+} X11ScanCookies;
+
+// Our own connection, opened on first scan. NULL while we
+// fall back to the one under the scanned Display.
+static xcb_connection_t* mScanConnection = NULL;
+static bool mIsScanConnectionTried = false;
+
+
+/** *********************************************************************
+ ** This method returns the connection to scan on, opening ours
+ ** on first use.
+ **/
+static xcb_connection_t* getScanConnection(Display* display) {
+    if (!mIsScanConnectionTried) {
+        mIsScanConnectionTried = true;
+
+        mScanConnection = xcb_connect(DisplayString(display), NULL);
+        if (xcb_connection_has_error(mScanConnection)) {
+            xcb_disconnect(mScanConnection);
+            mScanConnection = NULL;
+        }
+    }
+
+    if (mScanConnection) {
+        return mScanConnection;
+    }
+
+    // Xlib may have requests buffered, flush them ahead of ours.
+    XFlush(display);
+    return XGetXCBConnection(display);
+}
+
+/** *********************************************************************
+ ** This method closes our scan connection.
+ **/
+void closeX11ScanConnection() {
+    if (mScanConnection) {
+        xcb_disconnect(mScanConnection);
+        mScanConnection = NULL;
+    }
+    mIsScanConnectionTried = false;
+}
+
+/** *********************************************************************
+ ** This method sends one property request.
+ **/
+static xcb_get_property_cookie_t requestProperty(
+    xcb_connection_t* connection, Window window,
+    X11AtomId property, uint32_t length) {
+
+    return xcb_get_property(connection, 0, window,
+        getX11Atom(property), XCB_GET_PROPERTY_TYPE_ANY, 0, length);
+}
+
+/** *********************************************************************
+ ** This method collects one property reply, NULL if the property
+ ** is missing or the window is gone.
+ **/
+static xcb_get_property_reply_t* collectProperty(
+    xcb_connection_t* connection, xcb_get_property_cookie_t cookie) {
+
+    xcb_generic_error_t* error = NULL;
+    xcb_get_property_reply_t* reply =
+        xcb_get_property_reply(connection, cookie, &error);
+    free(error);
+
+    if (reply && reply->type == XCB_NONE) {
+        free(reply);
+        return NULL;
+    }
+    return reply;
+}
+
+/** *********************************************************************
+ ** This method returns the first format 32 value of a property.
+ **/
+static bool getPropertyLong(xcb_get_property_reply_t* reply,
+    long* value) {
+
+    if (!reply || reply->format != 32 || reply->value_len < 1) {
+        return false;
+    }
+
+    *value = *(int32_t*) xcb_get_property_value(reply);
+    return true;
+}
+
+/** *********************************************************************
+ ** This method decodes WINDOW_STATE_* bits from the window's
+ ** _NET_WM_STATE & _NET_WM_WINDOW_TYPE atom lists.
+ **/
+static unsigned int decodeWindowState(
+    xcb_get_property_reply_t* netState,
+    xcb_get_property_reply_t* windowType) {
+    unsigned int state = 0;
+
+    if (netState && netState->type == XCB_ATOM_ATOM &&
+        netState->format == 32) {
+        const xcb_atom_t* atoms = (const xcb_atom_t*)
+            xcb_get_property_value(netState);
+        for (uint32_t i = 0; i < netState->value_len; i++) {
+            if (atoms[i] == X11_ATOM(_NET_WM_STATE_STICKY)) {
+                state |= WINDOW_STATE_STICKY;
+            } else if (atoms[i] == X11_ATOM(_NET_WM_STATE_HIDDEN)) {
+                state |= WINDOW_STATE_HIDDEN;
+            } else if (atoms[i] == X11_ATOM(_NET_WM_STATE_FULLSCREEN)) {
+                state |= WINDOW_STATE_FULLSCREEN;
+            } else if (atoms[i] == X11_ATOM(_NET_WM_STATE_ABOVE)) {
+                state |= WINDOW_STATE_ABOVE;
+            } else if (atoms[i] == X11_ATOM(_NET_WM_STATE_BELOW)) {
+                state |= WINDOW_STATE_BELOW;
+            }
+        }
+    }
+
+    if (windowType && windowType->type == XCB_ATOM_ATOM &&
+        windowType->format == 32) {
+        const xcb_atom_t* atoms = (const xcb_atom_t*)
+            xcb_get_property_value(windowType);
+        for (uint32_t i = 0; i < windowType->value_len; i++) {
+            if (atoms[i] == X11_ATOM(_NET_WM_WINDOW_TYPE_DOCK)) {
+                state |= WINDOW_STATE_DOCK;
+                break;
+            }
+        }
+    }
+
+    return state;
+}
+
+/** *********************************************************************
+ ** This method applies _GTK_FRAME_EXTENTS (client side decorations,
+ ** shrink) or else _NET_FRAME_EXTENTS (WM frame, grow).
+ **/
+static bool applyFrameExtents(WinInfo* winInfoItem,
+    xcb_get_property_reply_t* gtkExtents,
+    xcb_get_property_reply_t* netExtents) {
+
+    const bool isGtk = gtkExtents && gtkExtents->value_len == 4;
+    xcb_get_property_reply_t* extents = isGtk ?
+        gtkExtents : netExtents;
+    if (!extents || extents->value_len != 4 ||
+        extents->format != 32) {
+        return false;
+    }
+
+    const int32_t* frameExtent = (const int32_t*)
+        xcb_get_property_value(extents);
+    if (isGtk) {
+        winInfoItem->x += frameExtent[0];
+        winInfoItem->y += frameExtent[2];
+        winInfoItem->w -= (frameExtent[0] + frameExtent[1]);
+        winInfoItem->h -= (frameExtent[2] + frameExtent[3]);
+    } else {
+        winInfoItem->x -= frameExtent[0];
+        winInfoItem->y -= frameExtent[2];
+        winInfoItem->w += frameExtent[0] + frameExtent[1];
+        winInfoItem->h += frameExtent[2] + frameExtent[3];
+    }
+
+    return true;
+}
+
+/** *********************************************************************
+ ** This method finds the top level ancestor (WM frame) of every
+ ** window that lacks one, one pipelined XQueryTree per tree level.
+ **/
+static void resolveFrameWindows(xcb_connection_t* connection,
+    WinInfo** winInfoItems, int count, const bool* isAlive) {
+
+    Window* nodes = (Window*) malloc(count * sizeof(Window));
+    MALLOC_CHECK(nodes);
+    xcb_query_tree_cookie_t* cookies = (xcb_query_tree_cookie_t*)
+        malloc(count * sizeof(xcb_query_tree_cookie_t));
+    MALLOC_CHECK(cookies);
+
+    int pending = 0;
+    for (int i = 0; i < count; i++) {
+        nodes[i] = (isAlive[i] && winInfoItems[i]->frame == None) ?
+            winInfoItems[i]->window : None;
+        if (nodes[i] != None) {
+            pending++;
+        }
+    }
+
+    while (pending > 0) {
+        for (int i = 0; i < count; i++) {
+            if (nodes[i] != None) {
+                cookies[i] = xcb_query_tree(connection, nodes[i]);
+            }
+        }
+        countX11Calls(X11_STATS_MODULE,
+            X11_STATS_CALL_XcbRequest, pending);
+        countX11Calls(X11_STATS_MODULE,
+            X11_STATS_CALL_XcbRoundTrip, 1);
+
+        for (int i = 0; i < count; i++) {
+            if (nodes[i] == None) {
+                continue;
+            }
+
+            xcb_generic_error_t* error = NULL;
+            xcb_query_tree_reply_t* reply = xcb_query_tree_reply(
+                connection, cookies[i], &error);
+            free(error);
+            if (!reply || reply->parent == XCB_NONE) {
+                nodes[i] = None;
+                pending--;
+            } else if (reply->parent == reply->root) {
+                winInfoItems[i]->frame = nodes[i];
+                nodes[i] = None;
+                pending--;
+            } else {
+                nodes[i] = reply->parent;
+            }
+            free(reply);
+        }
+    }
+
+    free(cookies);
+    free(nodes);
+}
+
+/** *********************************************************************
+ ** This method fills in all WinInfo attributes for count windows.
+ ** isAlive[i] is set false for any window that has gone away.
+ **
+ ** Positions are relative to relativeWindow, actual positions
+ ** (xa, ya) to rootWindow. isShowingDesktop is the root's
+ ** _NET_SHOWING_DESKTOP, which hides every window.
+ **/
+void scanX11WindowInfos(Display* display, Window rootWindow,
+    Window relativeWindow, bool isShowingDesktop,
+    WinInfo** winInfoItems, int count, bool* isAlive) {
+    if (count <= 0) {
+        return;
+    }
+
+    xcb_connection_t* connection = getScanConnection(display);
+
+    X11ScanCookies* cookies = (X11ScanCookies*)
+        malloc(count * sizeof(X11ScanCookies));
+    MALLOC_CHECK(cookies);
+
+    // Send everything.
+    for (int i = 0; i < count; i++) {
+        const Window window = winInfoItems[i]->window;
+        X11ScanCookies* cookie = &cookies[i];
+
+        cookie->attributes = xcb_get_window_attributes(
+            connection, window);
+        cookie->geometry = xcb_get_geometry(connection, window);
+
+        cookie->netDesktop = requestProperty(connection, window,
+            X11_ATOM__NET_WM_DESKTOP, 1);
+        cookie->winWorkspace = requestProperty(connection, window,
+            X11_ATOM__WIN_WORKSPACE, 1);
+        cookie->netState = requestProperty(connection, window,
+            X11_ATOM__NET_WM_STATE, SCAN_ATOM_LIST_LENGTH);
+        cookie->windowType = requestProperty(connection, window,
+            X11_ATOM__NET_WM_WINDOW_TYPE, SCAN_ATOM_LIST_LENGTH);
+        cookie->wmState = requestProperty(connection, window,
+            X11_ATOM_WM_STATE, 1);
+        cookie->gtkExtents = requestProperty(connection, window,
+            X11_ATOM__GTK_FRAME_EXTENTS, 4);
+        cookie->netExtents = requestProperty(connection, window,
+            X11_ATOM__NET_FRAME_EXTENTS, 4);
+
+        cookie->toRoot = xcb_translate_coordinates(connection,
+            window, rootWindow, 0, 0);
+        cookie->toRelative = xcb_translate_coordinates(connection,
+            window, relativeWindow, 0, 0);
+    }
+    xcb_flush(connection);
+    countX11Calls(X11_STATS_MODULE, X11_STATS_CALL_XcbRequest,
+        (unsigned long long) count * SCAN_REQUESTS_PER_WINDOW);
+    countX11Calls(X11_STATS_MODULE, X11_STATS_CALL_XcbRoundTrip, 1);
+
+    // Collect everything, in order.
+    const bool isDesktopVisible = !isShowingDesktop;
+    for (int i = 0; i < count; i++) {
+        WinInfo* winInfoItem = winInfoItems[i];
+        X11ScanCookies* cookie = &cookies[i];
+
+        // Errors are taken with the replies, a window gone
+        // mid scan must not reach the Xlib error handler.
+        xcb_generic_error_t* errors[4] = { NULL, NULL, NULL, NULL };
+
+        xcb_get_window_attributes_reply_t* attributes =
+            xcb_get_window_attributes_reply(connection,
+                cookie->attributes, &errors[0]);
+        xcb_get_geometry_reply_t* geometry =
+            xcb_get_geometry_reply(connection, cookie->geometry,
+                &errors[1]);
+
+        xcb_get_property_reply_t* netDesktop =
+            collectProperty(connection, cookie->netDesktop);
+        xcb_get_property_reply_t* winWorkspace =
+            collectProperty(connection, cookie->winWorkspace);
+        xcb_get_property_reply_t* netState =
+            collectProperty(connection, cookie->netState);
+        xcb_get_property_reply_t* windowType =
+            collectProperty(connection, cookie->windowType);
+        xcb_get_property_reply_t* wmState =
+            collectProperty(connection, cookie->wmState);
+        xcb_get_property_reply_t* gtkExtents =
+            collectProperty(connection, cookie->gtkExtents);
+        xcb_get_property_reply_t* netExtents =
+            collectProperty(connection, cookie->netExtents);
+
+        xcb_translate_coordinates_reply_t* toRoot =
+            xcb_translate_coordinates_reply(connection,
+                cookie->toRoot, &errors[2]);
+        xcb_translate_coordinates_reply_t* toRelative =
+            xcb_translate_coordinates_reply(connection,
+                cookie->toRelative, &errors[3]);
+        for (int e = 0; e < 4; e++) {
+            free(errors[e]);
+        }
+
+        isAlive[i] = attributes && geometry && toRoot && toRelative;
+        if (!isAlive[i]) {
+            winInfoItem->state |= WINDOW_STATE_HIDDEN;
+        } else {
+            // Set WinInfo "workspace" attribute.
+            winInfoItem->ws = 0;
+            if (!(netDesktop && netDesktop->type == XCB_ATOM_CARDINAL &&
+                getPropertyLong(netDesktop, &winInfoItem->ws))) {
+                getPropertyLong(winWorkspace, &winInfoItem->ws);
+            }
+
+            // Set WinInfo "state" attribute. Sticky
+            // workspace -1 is needed in KDE and LXDE.
+            winInfoItem->state = decodeWindowState(netState,
+                windowType);
+            if (winInfoItem->ws == -1) {
+                winInfoItem->state |= WINDOW_STATE_STICKY;
+            }
+
+            long wmStateValue;
+            if (!isDesktopVisible ||
+                attributes->map_state != XCB_MAP_STATE_VIEWABLE ||
+                (getPropertyLong(wmState, &wmStateValue) &&
+                    wmStateValue != NormalState)) {
+                winInfoItem->state |= WINDOW_STATE_HIDDEN;
+            }
+
+            // Set WinInfo "W / H", and position attributes.
+            winInfoItem->w = geometry->width;
+            winInfoItem->h = geometry->height;
+
+            winInfoItem->xa = toRoot->dst_x - geometry->x;
+            winInfoItem->ya = toRoot->dst_y - geometry->y;
+
+            winInfoItem->x = toRelative->dst_x;
+            winInfoItem->y = toRelative->dst_y;
+            if (!applyFrameExtents(winInfoItem,
+                gtkExtents, netExtents)) {
+                winInfoItem->x = geometry->x;
+                winInfoItem->y = geometry->y;
+            }
+        }
+
+        free(attributes);
+        free(geometry);
+        free(netDesktop);
+        free(winWorkspace);
+        free(netState);
+        free(windowType);
+        free(wmState);
+        free(gtkExtents);
+        free(netExtents);
+        free(toRoot);
+        free(toRelative);
+    }
+
+    free(cookies);
+
+    resolveFrameWindows(connection, winInfoItems, count, isAlive);
+}
@@ -0,0 +1,36 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include <X11/Xlib.h>
+
+#include "plasmastorm.h"
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void scanX11WindowInfos(Display* display, Window rootWindow,
+    Window relativeWindow, bool isShowingDesktop,
+    WinInfo** winInfoItems, int count, bool* isAlive);
+extern void closeX11ScanConnection();
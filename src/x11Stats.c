@@ -0,0 +1,176 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xlib.h>
+
+#include "ColorCodes.h"
+#include "x11Stats.h"
+
+
+/** *********************************************************************
+ ** Module globals and consts.
+ **/
+unsigned long long mX11StatsCounts
+    [X11_STATS_MODULE_COUNT][X11_STATS_CALL_COUNT];
+
+static const char* X11_STATS_MODULE_LABELS[] = {
+    #define MODULE(id, label) label,
+    X11_STATS_MODULE_LIST
+    #undef MODULE
+};
+
+static const char* X11_STATS_CALL_NAMES[] = {
+    #define CALL(name, cost) #name,
+    X11_STATS_CALL_LIST
+    #undef CALL
+};
+
+static const int X11_STATS_CALL_COSTS[] = {
+    #define CALL(name, cost) cost,
+    X11_STATS_CALL_LIST
+    #undef CALL
+};
+
+// Main thread display lock waits, see sampleX11DisplayLockStall().
+#define X11_STATS_CONTENDED_LOCK_TIME 20e-6
+
+static unsigned long long mLockSamples = 0;
+static unsigned long long mContendedLockSamples = 0;
+static double mLockStallTime = 0;
+static double mMaxLockStallTime = 0;
+
+// Previous dump, for the rates since then.
+static double mX11StatsStartTime = 0;
+static double mX11StatsLastDumpTime = 0;
+static unsigned long long mX11StatsLastCounts
+    [X11_STATS_MODULE_COUNT][X11_STATS_CALL_COUNT];
+
+
+/** *********************************************************************
+ ** This method returns a monotonic time in seconds.
+ **/
+static double getX11StatsClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/** *********************************************************************
+ ** This method starts the clock for the per second rates.
+ **/
+void initX11Stats() {
+    mX11StatsStartTime = getX11StatsClock();
+    mX11StatsLastDumpTime = mX11StatsStartTime;
+}
+
+/** *********************************************************************
+ ** This method times taking the display lock, as the main thread's
+ ** next Xlib call would. Any wait is a stall behind another
+ ** thread's use of the same Display. Main thread only.
+ **/
+void sampleX11DisplayLockStall(Display* display) {
+    const double start = getX11StatsClock();
+    XLockDisplay(display);
+    const double stall = getX11StatsClock() - start;
+    XUnlockDisplay(display);
+
+    mLockSamples++;
+    if (stall >= X11_STATS_CONTENDED_LOCK_TIME) {
+        mContendedLockSamples++;
+        mLockStallTime += stall;
+        if (stall > mMaxLockStallTime) {
+            mMaxLockStallTime = stall;
+        }
+    }
+}
+
+/** *********************************************************************
+ ** This method logs requests, round trips and flushes per module,
+ ** in total and per second since the previous dump, then the
+ ** counts per call.
+ **/
+void logX11Stats() {
+    const double now = getX11StatsClock();
+    const double interval = (now > mX11StatsLastDumpTime) ?
+        now - mX11StatsLastDumpTime : 1.0;
+
+    unsigned long long counts
+        [X11_STATS_MODULE_COUNT][X11_STATS_CALL_COUNT];
+    for (int module = 0; module < X11_STATS_MODULE_COUNT; module++) {
+        for (int call = 0; call < X11_STATS_CALL_COUNT; call++) {
+            counts[module][call] = __atomic_load_n(
+                &mX11StatsCounts[module][call], __ATOMIC_RELAXED);
+        }
+    }
+
+    printf("%splasmastorm: X11 traffic over %.1f s, rates for the "
+        "%.1f s since the previous dump:%s\n", COLOR_BLUE,
+        now - mX11StatsStartTime, interval, COLOR_NORMAL);
+    printf("%s  %-12s %10s %10s %10s %10s %8s%s\n", COLOR_BLUE,
+        "module", "requests", "req/s", "trips", "trips/s",
+        "flushes", COLOR_NORMAL);
+
+    for (int module = 0; module < X11_STATS_MODULE_COUNT; module++) {
+        unsigned long long requests = 0, trips = 0, flushes = 0;
+        unsigned long long newRequests = 0, newTrips = 0;
+
+        for (int call = 0; call < X11_STATS_CALL_COUNT; call++) {
+            const unsigned long long count = counts[module][call];
+            const unsigned long long delta = count -
+                mX11StatsLastCounts[module][call];
+
+            if (X11_STATS_CALL_COSTS[call] & X11_STATS_REQUEST) {
+                requests += count;
+                newRequests += delta;
+            }
+            if (X11_STATS_CALL_COSTS[call] & X11_STATS_ROUND_TRIP) {
+                trips += count;
+                newTrips += delta;
+            }
+            if (call == X11_STATS_CALL_XFlush) {
+                flushes += count;
+            }
+        }
+
+        printf("%s  %-12s %10llu %10.1f %10llu %10.1f %8llu%s\n",
+            COLOR_BLUE, X11_STATS_MODULE_LABELS[module],
+            requests, newRequests / interval,
+            trips, newTrips / interval, flushes, COLOR_NORMAL);
+
+        for (int call = 0; call < X11_STATS_CALL_COUNT; call++) {
+            if (counts[module][call] > 0) {
+                printf("      %-24s %10llu\n",
+                    X11_STATS_CALL_NAMES[call], counts[module][call]);
+            }
+        }
+    }
+
+    printf("%splasmastorm: Main thread display lock: %llu samples, "
+        "%llu contended, %.3f ms stalled, %.3f ms worst.%s\n",
+        COLOR_BLUE, mLockSamples, mContendedLockSamples,
+        mLockStallTime * 1e3, mMaxLockStallTime * 1e3, COLOR_NORMAL);
+
+    memcpy(mX11StatsLastCounts, counts, sizeof(counts));
+    mX11StatsLastDumpTime = now;
+}
@@ -0,0 +1,150 @@
+/* -copyright-
+#-# 
+#-# plasmastorm: Storms of drifting items: snow, leaves, rain.
+#-# 
+#-# Copyright (C) 2024 Mark Capella
+#-# 
+#-# This program is free software: you can redistribute it and/or modify
+#-# it under the terms of the GNU General Public License as published by
+#-# the Free Software Foundation, either version 3 of the License, or
+#-# (at your option) any later version.
+#-# 
+#-# This program is distributed in the hope that it will be useful,
+#-# but WITHOUT ANY WARRANTY; without even the implied warranty of
+#-# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#-# GNU General Public License for more details.
+#-# 
+#-# You should have received a copy of the GNU General Public License
+#-# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#-# 
+ */
+/*
+ * X11 request accounting, per calling module.
+ *
+ * A module opts in by naming itself, then including this header
+ * LAST, after every X11 and project header (the wrappers below
+ * would otherwise rewrite their prototypes):
+ *
+ *     #define X11_STATS_MODULE X11_STATS_FALLEN
+ *     #include "x11Stats.h"
+ *
+ * Each wrapped call costs one relaxed atomic increment, cheap
+ * enough to leave on. logX11Stats() dumps the counts, on SIGUSR1
+ * and at exit.
+ */
+#pragma once
+
+#include <stdbool.h>
+
+#include <X11/Xlib.h>
+
+
+/***********************************************************
+ * Calling modules.
+ */
+#define X11_STATS_MODULE_LIST \
+    MODULE(APPLICATION, "Application") \
+    MODULE(WINDOWS, "Windows") \
+    MODULE(FALLEN, "Fallen") \
+    MODULE(STORM, "Storm") \
+    MODULE(STARS, "Stars") \
+    MODULE(XDO, "xdo") \
+    MODULE(ATOMS, "Atoms")
+
+typedef enum {
+    #define MODULE(id, label) X11_STATS_##id,
+    X11_STATS_MODULE_LIST
+    #undef MODULE
+    X11_STATS_MODULE_COUNT
+} X11StatsModule;
+
+/***********************************************************
+ * Counted calls, and what each costs: a request on the
+ * wire, a blocking round trip, or neither (a flush).
+ */
+#define X11_STATS_REQUEST 1
+#define X11_STATS_ROUND_TRIP 2
+
+#define X11_STATS_CALL_LIST \
+    CALL(XGetWindowProperty, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XQueryTree, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XGetWindowAttributes, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XTranslateCoordinates, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XQueryPointer, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XInternAtom, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XInternAtoms, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XInternAtomsPipelined, X11_STATS_REQUEST) \
+    CALL(XGetAtomName, X11_STATS_REQUEST | X11_STATS_ROUND_TRIP) \
+    CALL(XClearArea, X11_STATS_REQUEST) \
+    CALL(XFlush, 0) \
+    CALL(XcbRequest, X11_STATS_REQUEST) \
+    CALL(XcbRoundTrip, X11_STATS_ROUND_TRIP)
+
+typedef enum {
+    #define CALL(name, cost) X11_STATS_CALL_##name,
+    X11_STATS_CALL_LIST
+    #undef CALL
+    X11_STATS_CALL_COUNT
+} X11StatsCall;
+
+extern unsigned long long mX11StatsCounts
+    [X11_STATS_MODULE_COUNT][X11_STATS_CALL_COUNT];
+
+
+/***********************************************************
+ * Module Method stubs.
+ */
+extern void initX11Stats();
+extern void logX11Stats();
+
+extern void sampleX11DisplayLockStall(Display*);
+
+/** *********************************************************************
+ ** This method counts calls made by a module.
+ **/
+static inline void countX11Calls(X11StatsModule module,
+    X11StatsCall call, unsigned long long count) {
+    __atomic_fetch_add(&mX11StatsCounts[module][call],
+        count, __ATOMIC_RELAXED);
+}
+
+/***********************************************************
+ * Wrappers. XInternAtoms() sends one request per name but waits
+ * once, so it is one round trip plus count - 1 pipelined
+ * requests. Our own clearStormWindow() and
+ * sanelyCheckAndClearDisplayArea() are counted for their caller.
+ */
+#ifdef X11_STATS_MODULE
+    #define X11_STATS_COUNTED(name, call) \
+        (countX11Calls(X11_STATS_MODULE, \
+            X11_STATS_CALL_##name, 1), call)
+
+    #define XGetWindowProperty(...) X11_STATS_COUNTED( \
+        XGetWindowProperty, XGetWindowProperty(__VA_ARGS__))
+    #define XQueryTree(...) X11_STATS_COUNTED( \
+        XQueryTree, XQueryTree(__VA_ARGS__))
+    #define XGetWindowAttributes(...) X11_STATS_COUNTED( \
+        XGetWindowAttributes, XGetWindowAttributes(__VA_ARGS__))
+    #define XTranslateCoordinates(...) X11_STATS_COUNTED( \
+        XTranslateCoordinates, XTranslateCoordinates(__VA_ARGS__))
+    #define XQueryPointer(...) X11_STATS_COUNTED( \
+        XQueryPointer, XQueryPointer(__VA_ARGS__))
+    #define XInternAtom(...) X11_STATS_COUNTED( \
+        XInternAtom, XInternAtom(__VA_ARGS__))
+    #define XInternAtoms(display, names, count, onlyIfExists, atoms) \
+        (countX11Calls(X11_STATS_MODULE, \
+            X11_STATS_CALL_XInternAtomsPipelined, (count) - 1), \
+        X11_STATS_COUNTED(XInternAtoms, XInternAtoms(display, \
+            names, count, onlyIfExists, atoms)))
+    #define XGetAtomName(...) X11_STATS_COUNTED( \
+        XGetAtomName, XGetAtomName(__VA_ARGS__))
+    #define XClearArea(...) X11_STATS_COUNTED( \
+        XClearArea, XClearArea(__VA_ARGS__))
+    #define XFlush(...) X11_STATS_COUNTED( \
+        XFlush, XFlush(__VA_ARGS__))
+
+    #define sanelyCheckAndClearDisplayArea(...) X11_STATS_COUNTED( \
+        XClearArea, sanelyCheckAndClearDisplayArea(__VA_ARGS__))
+    #define clearStormWindow() X11_STATS_COUNTED(XFlush, \
+        X11_STATS_COUNTED(XClearArea, clearStormWindow()))
+#endif
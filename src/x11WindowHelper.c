@@ -44,11 +44,19 @@
 #include "rootWindowHelper.h"
 #include "safeMalloc.h"
 #include "Windows.h"
+#include "x11AtomHelper.h"
+#include "x11RootHelper.h"
+#include "x11ScanHelper.h"
 #include "x11WindowHelper.h"
 
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_WINDOWS
+#include "x11Stats.h"
+
 
 /** *********************************************************************
- ** This method ...
+ ** This method gets a fully probed winInfoList, one
+ ** entry per client window.
  **/
 void getX11WindowsList(WinInfo** winInfoList, int* numberOfWindows) {
     (*numberOfWindows) = 0;
@@ -59,493 +67,110 @@ void getX11WindowsList(WinInfo** winInfoList, int* numberOfWindows) {
 }
 
 /** *********************************************************************
- ** This method gets our initial winInfoList list from 1 of 3 places.
+ ** This method gets the client window ids from 1 of 3 places.
+ ** Caller XFree()s the result.
  **/
-void getRawWindowsList(WinInfo** winInfoList, int* numberOfWindows) {
-
-    // #1 Look for list in NET_CLIENT.
+int getX11ClientWindows(Window** windows) {
     Atom type;
     int format;
     long unsigned int nchildren;
     unsigned long unusedBytes;
-    Window* children;
-
-    XGetWindowProperty(mGlobal.display, DefaultRootWindow(mGlobal.display),
-        XInternAtom(mGlobal.display, "_NET_CLIENT_LIST", False),
-        0, 1000000, False, AnyPropertyType, &type,
-        &format, &nchildren, &unusedBytes, (unsigned char **) &children);
-
-    if (type == XA_WINDOW && nchildren > 0) {
-        (*winInfoList) = (WinInfo*) malloc(nchildren* sizeof(WinInfo));
-        (*numberOfWindows) = nchildren;
-
-        WinInfo* addWinInfo = *winInfoList;
-        Window* addWindow = children;
-        for (long unsigned int i = 0; i <= nchildren; i++) {
-            addWinInfo->window = *addWindow;
-            addWinInfo++;
-            addWindow++;
-        }
-
-        XFree(children);
-        children = NULL;
-        return;
-    }
+    Window* children = NULL;
 
-    if (children) {
-        XFree(children);
-        children = NULL;
-    }
-
-    // #2, Else look for list in WIN_CLIENT.
-    XGetWindowProperty(mGlobal.display, DefaultRootWindow(mGlobal.display),
-        XInternAtom(mGlobal.display, "_WIN_CLIENT_LIST", False),
-        0, 1000000, False, AnyPropertyType, &type,
-        &format, &nchildren, &unusedBytes, (unsigned char **) &children);
-
-    if (type == XA_WINDOW && nchildren > 0) {
-        (*winInfoList) = (WinInfo*) malloc(nchildren* sizeof(WinInfo));
-        (*numberOfWindows) = nchildren;
-
-        WinInfo* addWinInfo = *winInfoList;
-        Window* addWindow = children;
-        for (long unsigned int i = 0; i <= nchildren; i++) {
-            addWinInfo->window = *addWindow;
-            addWinInfo++;
-            addWindow++;
+    // #1 Look for list in NET_CLIENT, #2 Else in WIN_CLIENT.
+    const X11AtomId CLIENT_LIST_ATOMS[] = {
+        X11_ATOM__NET_CLIENT_LIST, X11_ATOM__WIN_CLIENT_LIST };
+    for (int i = 0; i < 2; i++) {
+        XGetWindowProperty(mGlobal.display,
+            DefaultRootWindow(mGlobal.display),
+            getX11Atom(CLIENT_LIST_ATOMS[i]),
+            0, 1000000, False, AnyPropertyType, &type,
+            &format, &nchildren, &unusedBytes,
+            (unsigned char **) &children);
+
+        if (type == XA_WINDOW && nchildren > 0) {
+            (*windows) = children;
+            return nchildren;
         }
 
-        XFree(children);
-        children = NULL;
-        return;
-    }
-
-    if (children) {
-        XFree(children);
-        children = NULL;
+        if (children) {
+            XFree(children);
+            children = NULL;
+        }
     }
 
     // #3, Finally, use Query tree.
     Window unused;
-    unsigned int queryChildrenCount;
+    unsigned int queryChildrenCount = 0;
 
     XQueryTree(mGlobal.display, DefaultRootWindow(mGlobal.display),
         &unused, &unused, &children, &queryChildrenCount);
 
     if (queryChildrenCount > 0) {
-        (*winInfoList) = (WinInfo*)
-            malloc(queryChildrenCount* sizeof(WinInfo));
-        (*numberOfWindows) = queryChildrenCount;
-
-        WinInfo* addWinInfo = *winInfoList;
-        Window* addWindow = children;
-        for (long unsigned int i = 0; i <= nchildren; i++) {
-            addWinInfo->window = *addWindow;
-            addWinInfo++;
-            addWindow++;
-        }
+        (*windows) = children;
+        return queryChildrenCount;
     }
 
     if (children) {
         XFree(children);
-        children = NULL;
-    }
-}
-
-/** *********************************************************************
- ** This method ...
- **/
-void getFinishedWindowsList(WinInfo** winInfoList,
-    int* numberOfWindows) {
-
-    WinInfo *winInfoItem = (*winInfoList);
-    for (int i = 0; i < *numberOfWindows; i++) {
-        // Set WinInfo "workspace", "sticky", and "dock" attributes.
-        winInfoItem->ws = getWindowWorkspace(winInfoItem->window);
-        winInfoItem->sticky = isWindow_Sticky(winInfoItem->ws,
-            winInfoItem);
-        winInfoItem->dock = isWindow_Dock(winInfoItem);
-
-        // Set WinInfo "X pos", "Y pos", and "hidden" attribute.
-        XWindowAttributes windowAttributes;
-        XGetWindowAttributes(mGlobal.display, winInfoItem->window,
-            &windowAttributes);
-        winInfoItem->w = windowAttributes.width;
-        winInfoItem->h = windowAttributes.height;
-        winInfoItem->hidden = isWindow_Hidden(winInfoItem->window,
-            windowAttributes.map_state);
-
-        // Save for later frame extent calculations.
-        int initialWinAttr_XPos = windowAttributes.x;
-        int initialWinAttr_YPos = windowAttributes.y;
-
-        // Set WinInfo "X / Y actual" attributes.
-        int xr, yr;
-        Window child_return;
-        XTranslateCoordinates(mGlobal.display, winInfoItem->window,
-            mGlobal.Rootwindow, 0, 0, &xr, &yr, &child_return);
-        winInfoItem->xa = xr - initialWinAttr_XPos;
-        winInfoItem->ya = yr - initialWinAttr_YPos;
-
-        // Set WinInfo "X / Y position" attributes.
-        XTranslateCoordinates(mGlobal.display, winInfoItem->window,
-            mGlobal.StormWindow, 0, 0, &(winInfoItem->x),
-            &(winInfoItem->y), &child_return);
-
-        // Apply WinInfo frame extent adjustments.
-        enum { NET, GTK };
-        int wintype = GTK;
-
-        Atom type;
-        int format;
-        unsigned long nitems = 0;
-        unsigned long unusedBytes;
-        unsigned char* properties;
-
-        XGetWindowProperty(mGlobal.display, winInfoItem->window,
-            XInternAtom(mGlobal.display, "_GTK_FRAME_EXTENTS", False),
-            0, 4, False, AnyPropertyType, &type, &format,
-            &nitems, &unusedBytes, &properties);
-
-        if (nitems != 4) {
-            if (properties) {
-                XFree(properties);
-            }
-            properties = NULL;
-            wintype = NET;
-            XGetWindowProperty(mGlobal.display, winInfoItem->window,
-                XInternAtom(mGlobal.display, "_NET_FRAME_EXTENTS", False),
-                0, 4, False, AnyPropertyType, &type, &format,
-                &nitems, &unusedBytes, &properties);
-        }
-
-        if (nitems == 4 && format == 32 && type) {
-            long* frameExtent;
-            frameExtent = (long *) (void *) properties;
-            switch (wintype) {
-                case NET:
-                    winInfoItem->x -= frameExtent[0];
-                    winInfoItem->y -= frameExtent[2];
-                    winInfoItem->w += frameExtent[0] + frameExtent[1];
-                    winInfoItem->h += frameExtent[2] + frameExtent[3];
-                    break;
-                case GTK:
-                    winInfoItem->x += frameExtent[0];
-                    winInfoItem->y += frameExtent[2];
-                    winInfoItem->w -= (frameExtent[0] + frameExtent[1]);
-                    winInfoItem->h -= (frameExtent[2] + frameExtent[3]);
-                    break;
-            }
-        } else {
-            winInfoItem->x = initialWinAttr_XPos;
-            winInfoItem->y = initialWinAttr_YPos;
-        }
-
-        // Free resources, bump pointer, loop.
-        if (properties) {
-            XFree(properties);
-        }
-        winInfoItem++;
-    }
-
-    return;
-}
-
-/** *********************************************************************
- ** This method determines if a window is visible on a workspace.
- **/
-long int getWindowWorkspace(Window window) {
-    long int result = 0;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char *properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, window,
-        XInternAtom(mGlobal.display, "_NET_WM_DESKTOP", False),
-        0, 1, False, AnyPropertyType, &type, &format, &nitems,
-        &unusedBytes, &properties);
-
-    if (type != XA_CARDINAL) {
-        if (properties) {
-            XFree(properties);
-        }
-        properties = NULL;
-        XGetWindowProperty(mGlobal.display, window,
-            XInternAtom(mGlobal.display, "_WIN_WORKSPACE", False),
-            0, 1, False, AnyPropertyType, &type, &format, &nitems,
-            &unusedBytes, &properties);
-    }
-
-    if (properties) {
-        result = *(long *) (void *) properties;
-        if (properties) {
-            XFree(properties);
-        }
-    }
-
-    return result;
-}
-
-/** *********************************************************************
- ** This method has the x-y coordinates of the desktop/workspace,
- ** which we hash into a comparable result.
- **/
-long int getCurrentWorkspace() {
-    int resultCode = -1;
-
-    Atom type;
-    int format;
-    unsigned long unusedNumber, unusedBytes;
-
-    // The index of the current desktop. This is always
-    // an integer between 0 and _NET_NUMBER_OF_DESKTOPS - 1.
-
-    unsigned char* properties = NULL;
-    XGetWindowProperty(mGlobal.display, DefaultRootWindow(mGlobal.display),
-        XInternAtom(mGlobal.display, "_NET_CURRENT_DESKTOP", False),
-        0, 1, False, AnyPropertyType, &type, &format,
-        &unusedNumber, &unusedBytes,
-        &properties);
-
-    if (type == XA_CARDINAL) {
-        resultCode = *(long*) (void*) properties;
-        if (properties) {
-            XFree(properties);
-        }
-        return resultCode;
-    }
-    if (properties) {
-        XFree(properties);
-    }
-
-    // Are we GNOME ? _WIN_WORKSPACE
-
-    unsigned char* propertiesWin = NULL;
-    XGetWindowProperty(mGlobal.display, DefaultRootWindow(mGlobal.display),
-        XInternAtom(mGlobal.display, "_WIN_WORKSPACE", False),
-        0, 1, False, AnyPropertyType, &type, &format,
-        &unusedNumber, &unusedBytes,
-        &propertiesWin);
-
-    if (type == XA_CARDINAL) {
-        resultCode = *(long*) (void*) propertiesWin;
-        if (propertiesWin) {
-            XFree(propertiesWin);
-        }
-        return resultCode;
-    }
-    if (propertiesWin) {
-        XFree(propertiesWin);
-    }
-
-    return resultCode;
-}
-
-/** *********************************************************************
- ** This method ...
- **/
-bool isDesktop_Visible() {
-    bool result = true;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char *properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, mGlobal.Rootwindow,
-        XInternAtom(mGlobal.display, "_NET_SHOWING_DESKTOP", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
-
-    if (format == 32 && nitems >= 1) {
-        if (*(long *) (void *) properties == 1) {
-            result = false;
-        }
-    }
-
-    if (properties) {
-        XFree(properties);
     }
-
-    return result;
-}
-
-/** *********************************************************************
- ** This method determines if a window state is hidden.
- **/
-bool isWindow_Hidden(Window window, int windowMapState) {
-    if (!isDesktop_Visible()) {
-        return true;
-    }
-    if (windowMapState != IsViewable) {
-        return true;
-    }
-
-    if (is_NET_WM_STATE_Hidden(window)) {
-        return true;
-    }
-    if (is_WM_STATE_Hidden(window)) {
-        return true;
-    }
-
-    return false;
+    (*windows) = NULL;
+    return 0;
 }
 
 /** *********************************************************************
- ** This method checks "_NET_WM_STATE" for window HIDDEN attribute.
+ ** This method gets our initial winInfoList list.
  **/
-bool is_NET_WM_STATE_Hidden(Window window) {
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char *properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, window,
-        XInternAtom(mGlobal.display, "_NET_WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
-
-    if (format == 32) {
-        for (unsigned long i = 0; i < nitems; i++) {
-            char *nameString = XGetAtomName(mGlobal.display,
-                ((Atom *) (void *) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_STATE_HIDDEN") == 0) {
-                result = true;
-                if (nameString) {
-                    XFree(nameString);
-                }
-                break;
-            }
-
-            if (nameString) {
-                XFree(nameString);
-            }
-        }
-    }
-
-    if (properties) {
-        XFree(properties);
+void getRawWindowsList(WinInfo** winInfoList, int* numberOfWindows) {
+    const Window* children;
+    const int nchildren = getCachedX11ClientWindows(&children);
+    if (nchildren == 0) {
+        return;
     }
 
-    return result;
-}
-
-/** *********************************************************************
- ** This method checks "WM_STATE" for window HIDDEN attribute.
- **/
-bool is_WM_STATE_Hidden(Window window) {
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char *properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, window,
-        XInternAtom(mGlobal.display, "WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
-
-    if (format == 32 && nitems >= 1) {
-        if (* (long*) (void*) properties != NormalState) {
-            result = true;
-        }
-    }
+    (*winInfoList) = (WinInfo*) calloc(nchildren, sizeof(WinInfo));
+    MALLOC_CHECK(*winInfoList);
+    (*numberOfWindows) = nchildren;
 
-    if (properties) {
-        XFree(properties);
+    for (int i = 0; i < nchildren; i++) {
+        (*winInfoList)[i].window = children[i];
     }
-
-    return result;
 }
 
 /** *********************************************************************
- ** This method determines if a window state is sticky.
+ ** This method probes every window of the list in one pipelined
+ ** scan, dropping any that went away meanwhile.
  **/
-bool isWindow_Sticky(long workSpace, WinInfo* winInfoItem) {
-    // Needed in KDE and LXDE.
-    if (workSpace == -1) {
-        return true;
+void getFinishedWindowsList(WinInfo** winInfoList,
+    int* numberOfWindows) {
+    const int count = *numberOfWindows;
+    if (count == 0) {
+        return;
     }
 
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, winInfoItem->window,
-        XInternAtom(mGlobal.display, "_NET_WM_STATE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
-
-    if (type == XA_ATOM) {
-        for (unsigned long int i = 0; i < nitems; i++) {
-            char* nameString = XGetAtomName(mGlobal.display,
-                ((Atom*) (void*) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_STATE_STICKY") == 0) {
-                result = true;
-                if (nameString) {
-                    XFree(nameString);
-                }
-                break;
-            }
-            if (nameString) {
-                XFree(nameString);
-            }
-        }
-    }
+    WinInfo** winInfoItems = (WinInfo**)
+        malloc(count * sizeof(WinInfo*));
+    MALLOC_CHECK(winInfoItems);
+    bool* isAlive = (bool*) malloc(count * sizeof(bool));
+    MALLOC_CHECK(isAlive);
 
-    if (properties) {
-        XFree(properties);
+    for (int i = 0; i < count; i++) {
+        winInfoItems[i] = &(*winInfoList)[i];
     }
+    scanX11WindowInfos(mGlobal.display, mGlobal.Rootwindow,
+        mGlobal.StormWindow, isCachedShowingDesktop(),
+        winInfoItems, count, isAlive);
 
-    return result;
-}
-
-/** *********************************************************************
- ** This method ...
- **/
-bool isWindow_Dock(WinInfo* winInfoItem) {
-    bool result = false;
-
-    Atom type;
-    int format;
-    unsigned long nitems, unusedBytes;
-    unsigned char* properties = NULL;
-
-    XGetWindowProperty(mGlobal.display, winInfoItem->window,
-        XInternAtom(mGlobal.display, "_NET_WM_WINDOW_TYPE", False),
-        0, (~0L), False, AnyPropertyType, &type, &format,
-        &nitems, &unusedBytes, &properties);
-
-    if (format == 32) {
-        for (int i = 0; (unsigned long)i < nitems; i++) {
-            char* nameString = XGetAtomName(mGlobal.display,
-                ((Atom*) (void*) properties) [i]);
-            if (strcmp(nameString, "_NET_WM_WINDOW_TYPE_DOCK") == 0) {
-                result = true;
-                if (nameString) {
-                    XFree(nameString);
-                }
-                break;
-            }
-            if (nameString) {
-                XFree(nameString);
-            }
+    int aliveCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (isAlive[i]) {
+            (*winInfoList)[aliveCount++] = (*winInfoList)[i];
         }
     }
+    (*numberOfWindows) = aliveCount;
 
-    if (properties) {
-        XFree(properties);
-    }
-
-    return result;
+    free(isAlive);
+    free(winInfoItems);
 }
 
 /** *********************************************************************
@@ -578,8 +203,8 @@ Window getWindowMatchName(char* name) {
 /* get array of windows */
 unsigned long
 getX11StackedWindowsList(Window** wins) {
-    return getRootWindowProperty(XInternAtom(mGlobal.display,
-        "_NET_CLIENT_LIST_STACKING", False), wins);
+    return getRootWindowProperty(
+        X11_ATOM(_NET_CLIENT_LIST_STACKING), wins);
 }
 
 /** *********************************************************************
@@ -604,11 +229,10 @@ logWindow(Window window) {
         char resultMsg[1024];
         snprintf(resultMsg, sizeof(resultMsg),
             "[0x%08lx par: 0x%08lx] ws:%3ld w:%6d h:%6d   "
-            "st:%d dk:%d hd:%d  %s\n",
+            "state:0x%02x  %s\n",
             window, parentWindow, winInfoItem->ws,
             winInfoItem->w, winInfoItem->h,
-            winInfoItem->sticky, winInfoItem->dock,
-            winInfoItem->hidden, titleBarName.value);
+            winInfoItem->state, titleBarName.value);
         fprintf(stdout, "%s", resultMsg);
 
         if (childrenWindow) {
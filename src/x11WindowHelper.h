@@ -29,9 +29,6 @@
 /***********************************************************
  * Module Method stubs.
  */
-extern long int getCurrentWorkspace();
-long int getWindowWorkspace(Window window);
-
 extern WinInfo* findWinInfoByWindowId(Window id);
 
 Window getWindowMatchName(char* name);
@@ -43,14 +40,8 @@ extern void logAllWindowsStackedTopToBottom();
 unsigned long getRootWindowProperty(Atom prop, Window **wins);
 extern void getX11WindowsList(WinInfo** winInfolist, int *listCount);
 
+int getX11ClientWindows(Window** windows);
+
 void getRawWindowsList(WinInfo** winInfolist, int *listCount);
 void getFinishedWindowsList(WinInfo** winInfolist, int *listCount);
 
-bool isWindow_Hidden(Window window, int windowMapState);
-extern bool is_NET_WM_STATE_Hidden(Window window);
-extern bool is_WM_STATE_Hidden(Window window);
-
-bool isDesktop_Visible();
-
-bool isWindow_Sticky(long workSpace, WinInfo*);
-bool isWindow_Dock(WinInfo*);
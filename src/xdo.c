@@ -46,7 +46,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <poll.h>
 #include <sys/select.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <X11/XKBlib.h>
@@ -64,6 +66,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "XDOSymbolMap.h"
 
 #include "ColorCodes.h"
+#include "x11AtomHelper.h"
+
+// Count our X11 calls, keep last.
+#define X11_STATS_MODULE X11_STATS_XDO
+#include "x11Stats.h"
 
 #define DEFAULT_DELAY 12
 
@@ -205,20 +212,107 @@ int xdo_wait_for_window_map_state_orig(
     return 0;
 }
 
-// wv:
+/** *********************************************************************
+ ** Map state wait helpers.
+ **
+ ** Predicate for XCheckIfEvent() that only peeks: it notes whether a
+ ** MapNotify / UnmapNotify / VisibilityNotify for the watched window
+ ** is queued and always returns False, so the event stays on the
+ ** queue for the application's own dispatcher.
+ **/
+typedef struct {
+    Window wid;
+    Bool seen;
+} map_wait_t;
+
+static Bool _xdo_peek_map_event(Display *dpy, XEvent *event, XPointer arg) {
+    (void) dpy;
+    map_wait_t *wait = (map_wait_t *) arg;
+
+    switch (event->type) {
+        case MapNotify:
+            wait->seen |= event->xmap.window == wait->wid;
+            break;
+        case UnmapNotify:
+            wait->seen |= event->xunmap.window == wait->wid;
+            break;
+        case VisibilityNotify:
+            wait->seen |= event->xvisibility.window == wait->wid;
+            break;
+    }
+    return False;
+}
+
+static long _xdo_monotonic_msecs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
+
+/** *********************************************************************
+ ** Wait for wid to reach map_state, driven by StructureNotify events
+ ** instead of sleeping between XGetWindowAttributes polls.
+ **
+ ** Blocks in poll() on the connection fd until a map related event
+ ** for wid arrives or MAP_WAIT_TIMEOUT_MSECS elapses, then confirms
+ ** the state with a single XGetWindowAttributes. The window's own
+ ** event mask is restored before returning.
+ **/
+#define MAP_WAIT_TIMEOUT_MSECS 4000
+
 int xdo_wait_for_window_map_state(const xdo_t *xdo, Window wid, int map_state) {
+    Display *dpy = xdo->xdpy;
+
     XWindowAttributes attr;
-    attr.map_state = IsUnmapped;
-    useconds_t usecs = 20000;
-    useconds_t sumusecs = 0;
-    while (sumusecs < 4000000 && attr.map_state != map_state) {
-        XGetWindowAttributes(xdo->xdpy, wid, &attr);
-        usecs *= 1.5;
-        usleep(usecs);
-        sumusecs += usecs;
+    if (!XGetWindowAttributes(dpy, wid, &attr)) {
+        return XDO_ERROR;
     }
-    // printf("xdo_wait_for_window_map_state: usecs: %d\n",usecs);
-    return 0;
+    if (attr.map_state == map_state) {
+        return XDO_SUCCESS;
+    }
+
+    const long savedEventMask = attr.your_event_mask;
+    XSelectInput(dpy, wid, savedEventMask |
+        StructureNotifyMask | VisibilityChangeMask);
+
+    // Re-check after selecting, the change may have landed in between.
+    XGetWindowAttributes(dpy, wid, &attr);
+
+    const long deadline = _xdo_monotonic_msecs() + MAP_WAIT_TIMEOUT_MSECS;
+    while (attr.map_state != map_state) {
+        map_wait_t wait = { wid, False };
+        XEvent unused;
+        XCheckIfEvent(dpy, &unused, _xdo_peek_map_event, (XPointer) &wait);
+        const int scannedLength = XQLength(dpy);
+        if (wait.seen) {
+            if (!XGetWindowAttributes(dpy, wid, &attr) ||
+                attr.map_state == map_state) {
+                break;
+            }
+        }
+
+        const long remaining = deadline - _xdo_monotonic_msecs();
+        if (remaining <= 0) {
+            break;
+        }
+
+        // The confirming round trip may have queued more events.
+        if (XQLength(dpy) != scannedLength) {
+            continue;
+        }
+
+        // Nothing queued for us yet, sleep on the socket.
+        XFlush(dpy);
+        struct pollfd pfd = { ConnectionNumber(dpy), POLLIN, 0 };
+        if (poll(&pfd, 1, (int) remaining) > 0) {
+            XEventsQueued(dpy, QueuedAfterReading);
+        }
+    }
+
+    XSelectInput(dpy, wid, savedEventMask);
+    XFlush(dpy);
+
+    return attr.map_state == map_state ? XDO_SUCCESS : XDO_ERROR;
 }
 
 int xdo_map_window(const xdo_t *xdo, Window wid) {
@@ -449,9 +543,9 @@ int xdo_set_window_property(
     strcat(netwm_property, property);
 
     // Change the property
-    ret =
-        XChangeProperty(xdo->xdpy, wid, XInternAtom(xdo->xdpy, property, False),
-            XInternAtom(xdo->xdpy, "STRING", False), 8, PropModeReplace,
+    ret = XChangeProperty(xdo->xdpy, wid,
+        getX11AtomByName(xdo->xdpy, property),
+            X11_ATOM(STRING), 8, PropModeReplace,
             (unsigned char *)value, strlen(value));
     if (ret == 0) {
         return printMsgIfConditionTrue("XChangeProperty", ret == 0, xdo);
@@ -459,8 +553,8 @@ int xdo_set_window_property(
 
     // Change _NET_<property> just in case for simpler NETWM compliance?
     ret = XChangeProperty(xdo->xdpy, wid,
-        XInternAtom(xdo->xdpy, netwm_property, False),
-        XInternAtom(xdo->xdpy, "STRING", False), 8, PropModeReplace,
+        getX11AtomByName(xdo->xdpy, netwm_property),
+        X11_ATOM(STRING), 8, PropModeReplace,
         (unsigned char *)value, strlen(value));
     return printMsgIfConditionTrue("XChangeProperty", ret == 0, xdo);
 }
@@ -536,8 +630,7 @@ int xdo_activate_window(const xdo_t *xdo, Window wid) {
     xev.type = ClientMessage;
     xev.xclient.display = xdo->xdpy;
     xev.xclient.window = wid;
-    xev.xclient.message_type = XInternAtom(xdo->xdpy,
-        "_NET_ACTIVE_WINDOW", False);
+    xev.xclient.message_type = X11_ATOM(_NET_ACTIVE_WINDOW);
     xev.xclient.format = 32;
     xev.xclient.data.l[0] = 2L; /* 2 == Message from a window pager */
     xev.xclient.data.l[1] = CurrentTime;
@@ -573,8 +666,7 @@ int xdo_set_number_of_desktops(const xdo_t *xdo, long ndesktops) {
     xev.type = ClientMessage;
     xev.xclient.display = xdo->xdpy;
     xev.xclient.window = root;
-    xev.xclient.message_type =
-        XInternAtom(xdo->xdpy, "_NET_NUMBER_OF_DESKTOPS", False);
+    xev.xclient.message_type = X11_ATOM(_NET_NUMBER_OF_DESKTOPS);
     xev.xclient.format = 32;
     xev.xclient.data.l[0] = ndesktops;
 
@@ -600,7 +692,7 @@ int xdo_get_number_of_desktops(const xdo_t *xdo, long *ndesktops) {
         return XDO_ERROR;
     }
 
-    request = XInternAtom(xdo->xdpy, "_NET_NUMBER_OF_DESKTOPS", False);
+    request = X11_ATOM(_NET_NUMBER_OF_DESKTOPS);
     root = XDefaultRootWindow(xdo->xdpy);
 
     data = xdo_get_window_property_by_atom(
@@ -636,8 +728,7 @@ int xdo_set_current_desktop(const xdo_t *xdo, long desktop) {
     xev.type = ClientMessage;
     xev.xclient.display = xdo->xdpy;
     xev.xclient.window = root;
-    xev.xclient.message_type =
-        XInternAtom(xdo->xdpy, "_NET_CURRENT_DESKTOP", False);
+    xev.xclient.message_type = X11_ATOM(_NET_CURRENT_DESKTOP);
     xev.xclient.format = 32;
     xev.xclient.data.l[0] = desktop;
     xev.xclient.data.l[1] = CurrentTime;
@@ -664,7 +755,7 @@ int xdo_get_current_desktop(const xdo_t *xdo, long *desktop) {
         return XDO_ERROR;
     }
 
-    request = XInternAtom(xdo->xdpy, "_NET_CURRENT_DESKTOP", False);
+    request = X11_ATOM(_NET_CURRENT_DESKTOP);
     root = XDefaultRootWindow(xdo->xdpy);
 
     data = xdo_get_window_property_by_atom(
@@ -699,7 +790,7 @@ int xdo_set_desktop_for_window(const xdo_t *xdo, Window wid, long desktop) {
     xev.type = ClientMessage;
     xev.xclient.display = xdo->xdpy;
     xev.xclient.window = wid;
-    xev.xclient.message_type = XInternAtom(xdo->xdpy, "_NET_WM_DESKTOP", False);
+    xev.xclient.message_type = X11_ATOM(_NET_WM_DESKTOP);
     xev.xclient.format = 32;
     xev.xclient.data.l[0] = desktop;
     xev.xclient.data.l[1] = 2; /* indicate we are messaging from a pager */
@@ -726,7 +817,7 @@ int xdo_get_desktop_for_window(const xdo_t *xdo, Window wid, long *desktop) {
         return XDO_ERROR;
     }
 
-    request = XInternAtom(xdo->xdpy, "_NET_WM_DESKTOP", False);
+    request = X11_ATOM(_NET_WM_DESKTOP);
     data = xdo_get_window_property_by_atom(xdo, wid,
         request, &nitems, &type, &size);
 
@@ -757,8 +848,7 @@ int getActiveWindowFromXDO(const xdo_t* xdo, Window* window_ret) {
     }
 
     Window root = XDefaultRootWindow(xdo->xdpy);
-    Atom request = XInternAtom(xdo->xdpy,
-        "_NET_ACTIVE_WINDOW", False);
+    Atom request = X11_ATOM(_NET_ACTIVE_WINDOW);
 
     long nitems;
     Atom type;
@@ -1302,7 +1392,7 @@ int xdo_find_window_client(
     /* for XQueryTree */
     Window dummy, parent, *children = NULL;
     unsigned int nchildren;
-    Atom atom_wmstate = XInternAtom(xdo->xdpy, "WM_STATE", False);
+    Atom atom_wmstate = X11_ATOM(WM_STATE);
 
     int done = False;
     while (!done) {
@@ -1563,7 +1653,7 @@ int xdo_get_window_property(const xdo_t *xdo, Window window,
     const char *property, unsigned char **value, long *nitems, Atom *type,
     int *size) {
     *value = xdo_get_window_property_by_atom(xdo, window,
-        XInternAtom(xdo->xdpy, property, False), nitems, type, size);
+        getX11AtomByName(xdo->xdpy, property), nitems, type, size);
     if (*value == NULL) {
         return XDO_ERROR;
     }
@@ -1628,14 +1718,15 @@ int _xdo_ewmh_is_supported(const xdo_t *xdo, const char *feature) {
     Atom request;
     Atom feature_atom;
 
-    request = XInternAtom(xdo->xdpy, "_NET_SUPPORTED", False);
-    feature_atom = XInternAtom(xdo->xdpy, feature, False);
+    request = X11_ATOM(_NET_SUPPORTED);
+    feature_atom = getX11AtomByName(xdo->xdpy, feature);
     root = XDefaultRootWindow(xdo->xdpy);
 
     results = (Atom *)(void *)xdo_get_window_property_by_atom(
         xdo, root, request, &nitems, &type, &size);
     for (long i = 0L; i < nitems; i++) {
         if (results[i] == feature_atom) {
+            free(results);
             return True;
         }
     }
@@ -1912,8 +2003,7 @@ int xdo_set_active_modifiers(const xdo_t *xdo, Window window,
 
 int xdo_get_pid_window(const xdo_t* xdo, Window window) {
     if (atom_NET_WM_PID == (Atom) - 1) {
-        atom_NET_WM_PID = XInternAtom(xdo->xdpy,
-            "_NET_WM_PID", False);
+        atom_NET_WM_PID = X11_ATOM(_NET_WM_PID);
     }
 
     long nitems = 0;
@@ -1976,7 +2066,7 @@ int xdo_get_desktop_viewport(const xdo_t *xdo, int *x_ret, int *y_ret) {
     int size;
     long nitems;
     unsigned char *data;
-    Atom request = XInternAtom(xdo->xdpy, "_NET_DESKTOP_VIEWPORT", False);
+    Atom request = X11_ATOM(_NET_DESKTOP_VIEWPORT);
     Window root = RootWindow(xdo->xdpy, 0);
     data = xdo_get_window_property_by_atom(
         xdo, root, request, &nitems, &type, &size);
@@ -2011,8 +2101,7 @@ int xdo_set_desktop_viewport(const xdo_t *xdo, int x, int y) {
     xev.type = ClientMessage;
     xev.xclient.display = xdo->xdpy;
     xev.xclient.window = root;
-    xev.xclient.message_type =
-        XInternAtom(xdo->xdpy, "_NET_DESKTOP_VIEWPORT", False);
+    xev.xclient.message_type = X11_ATOM(_NET_DESKTOP_VIEWPORT);
     xev.xclient.format = 32;
     xev.xclient.data.l[0] = x;
     xev.xclient.data.l[1] = y;
@@ -2041,16 +2130,16 @@ int xdo_close_window(const xdo_t *xdo, Window window) {
 int xdo_get_window_name(const xdo_t *xdo, Window window,
     unsigned char **name_ret, int *name_len_ret, int *name_type) {
     if (atom_NET_WM_NAME == (Atom)-1) {
-        atom_NET_WM_NAME = XInternAtom(xdo->xdpy, "_NET_WM_NAME", False);
+        atom_NET_WM_NAME = X11_ATOM(_NET_WM_NAME);
     }
     if (atom_WM_NAME == (Atom)-1) {
-        atom_WM_NAME = XInternAtom(xdo->xdpy, "WM_NAME", False);
+        atom_WM_NAME = X11_ATOM(WM_NAME);
     }
     if (atom_STRING == (Atom)-1) {
-        atom_STRING = XInternAtom(xdo->xdpy, "STRING", False);
+        atom_STRING = X11_ATOM(STRING);
     }
     if (atom_UTF8_STRING == (Atom)-1) {
-        atom_UTF8_STRING = XInternAtom(xdo->xdpy, "UTF8_STRING", False);
+        atom_UTF8_STRING = X11_ATOM(UTF8_STRING);
     }
 
     Atom type;
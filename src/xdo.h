@@ -134,56 +134,9 @@ typedef struct xdo {
 
 } xdo_t;
 
-#define SEARCH_TITLE (1UL << 0)
-#define SEARCH_CLASS (1UL << 1)
-#define SEARCH_NAME (1UL << 2)
-#define SEARCH_PID (1UL << 3)
-#define SEARCH_ONLYVISIBLE (1UL << 4)
-#define SEARCH_SCREEN (1UL << 5)
-#define SEARCH_CLASSNAME (1UL << 6)
-#define SEARCH_DESKTOP (1UL << 7)
-
-/**
- * The window search query structure.
- *
- * @see doXDOWindowSearch
- */
-typedef struct xdo_search {
-        const char *title;        /** pattern to test against a window title */
-        const char *winclass;     /** pattern to test against a window class */
-        const char *winclassname; /** pattern to test against a window class */
-        const char *winname;      /** pattern to test against a window name */
-        int pid;          /** window pid (From window atom _NET_WM_PID) */
-        long max_depth;   /** depth of search. 1 means only toplevel windows */
-        int only_visible; /** boolean; set true to search only visible windows
-                           */
-        int screen; /** what screen to search, if any. If none given, search
-          all screens */
-
-        /** Should the tests be 'and' or 'or' ? If 'and', any failure will skip
-         * the window. If 'or', any success will keep the window in search
-         * results. */
-        // enum { SEARCH_ANY, SEARCH_ALL } require;
-        unsigned int require; // wv
-
-        /** bitmask of things you are searching for, such as SEARCH_NAME, etc.
-         * @see SEARCH_NAME, SEARCH_CLASS, SEARCH_PID, SEARCH_CLASSNAME, etc
-         */
-        unsigned int searchmask;
-
-        /** What desktop to search, if any. If none given, search all screens.
-         */
-        long desktop;
-
-        /** How many results to return? If 0, return all. */
-        unsigned int limit;
-} xdo_search_t;
-
-
 #define XDO_SUCCESS 0
 #define XDO_ERROR 1
 
-enum { SEARCH_ANY, SEARCH_ALL };
 
 /**
  * Create a new xdo_t instance.
@@ -692,17 +645,6 @@ int xdo_set_desktop_for_window(const xdo_t *xdo, Window wid, long desktop);
  */
 int xdo_get_desktop_for_window(const xdo_t *xdo, Window wid, long *desktop);
 
-/**
- * Search for windows.
- *
- * @param search the search query.
- * @param windowlist_ret the list of matching windows to return
- * @param nwindows_ret the number of windows (length of windowlist_ret)
- * @see xdo_search_t
- */
-int doXDOWindowSearch(const xdo_t *xdo, const xdo_search_t *search,
-    Window **windowlist_ret, unsigned int *nwindows_ret);
-
 /**
  * Generic property fetch.
  *